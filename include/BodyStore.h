@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Scalar.h"
+#include "Constants.h"
+
+class StateWriter;
+class StateReader;
+
+/**
+ * Stable ID of a planet (generation in the upper 16 bits, slot in the lower 16 bits)
+ * Stays valid while the planet exists, however the arrays are reordered
+ */
+typedef uint32_t BodyId;
+
+/**
+ * BodyStore Class
+ * Structure-of-arrays container for the hot physics state of planets
+ * (position, velocity, mass and color are kept in contiguous arrays so force
+ * kernels stream through them without touching trail history).
+ * Planets are addressed by dense index for iteration and by BodyId from
+ * outside: a fixed-capacity slot table maps IDs to indices, and removal moves
+ * the last planet into the hole (swap and pop), so both add and remove are O(1).
+ */
+class BodyStore {
+public:
+    static constexpr BodyId INVALID_ID = 0xFFFFFFFF;  // ID that never refers to a planet
+
+    /**
+     * Reserve space for planets (the slot table grows to the capacity and never shrinks)
+     * @param capacity Number of planets
+     */
+    void reserve(size_t capacity);
+
+    /**
+     * Append a planet
+     * @param x Initial X coordinate
+     * @param y Initial Y coordinate
+     * @param vx Initial X velocity (pixels per step)
+     * @param vy Initial Y velocity (pixels per step)
+     * @param gm G * M of the planet (pixels^3 per step^2)
+     * @param radius Radius (pixels)
+     * @param color Planet color
+     * @return ID of the new planet (INVALID_ID if every slot is in use)
+     */
+    BodyId add(Real x, Real y, Real vx, Real vy, Real gm, float radius, uint16_t color);
+
+    /**
+     * Remove a planet by moving the last planet into its place
+     * (only the last planet changes its index; IDs of all remaining planets stay valid)
+     * @param index Index of the planet to remove
+     */
+    void remove(size_t index);
+
+    /**
+     * Remove all planets
+     */
+    void clear();
+
+    /**
+     * Get the number of planets
+     * @return Number of planets
+     */
+    size_t size() const { return x.size(); }
+
+    /**
+     * Check if there are no planets
+     * @return true if empty
+     */
+    bool empty() const { return x.empty(); }
+
+    /**
+     * Get the maximum number of planets (number of slots)
+     * @return Capacity
+     */
+    size_t capacity() const { return slotIndex.size(); }
+
+    /**
+     * Find the current index of a planet
+     * @param id ID of the planet
+     * @return Index of the planet, or -1 if the planet no longer exists
+     */
+    int indexOf(BodyId id) const;
+
+    /**
+     * Find the planet added first
+     * @return Index of the oldest planet (0 if empty)
+     */
+    size_t oldest() const;
+
+    /**
+     * Hash the state of every planet (bit-exact, for comparing runs)
+     * @return FNV-1a hash of positions, velocities, masses, radii, colors and IDs
+     */
+    uint32_t checksum() const;
+
+    /**
+     * Write the state to a state file
+     * @param writer Writer
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Replace the state with one written by saveState
+     * @param reader Reader
+     * @param maxCount Largest number of planets accepted (the slot table may hold up to MAX_SLOTS)
+     * @return false if the data is invalid (the store is then empty)
+     */
+    bool loadState(StateReader& reader, size_t maxCount);
+
+    /**
+     * Get the number of bytes stored per planet
+     * @return Bytes per planet
+     */
+    static constexpr size_t bytesPerBody() {
+        return 7 * sizeof(Real) + sizeof(float) + sizeof(uint16_t) + sizeof(BodyId) + sizeof(uint32_t);
+    }
+
+    // Hot state (one entry per planet, in pixels and steps)
+    std::vector<Real> x, y;         // Position
+    std::vector<Real> vx, vy;       // Velocity
+    std::vector<Real> prevX, prevY; // Position before the last step (for render interpolation)
+    std::vector<Real> gm;           // G * M (pixels^3 per step^2)
+    std::vector<float> radius;      // Radius (pixels)
+    std::vector<uint16_t> color;    // Color
+
+    // Identity (one entry per planet)
+    std::vector<BodyId> id;         // Stable ID
+    std::vector<uint32_t> serial;   // Order of addition (for evicting the oldest planet)
+
+private:
+    static constexpr uint16_t FREE_SLOT = 0xFFFF;  // Slot index of an unused slot
+    static constexpr size_t MAX_SLOTS = PlanetConstants::MAX_LIMIT;  // Largest slot table (a planet limit can exceed any solver's)
+    static_assert(MAX_SLOTS >= BarnesHutConstants::MAX_PLANET_COUNT && MAX_SLOTS < FREE_SLOT,
+                  "the slot table must hold every planet and keep FREE_SLOT unused");
+
+    std::vector<uint16_t> slotIndex;       // Dense index of the planet in each slot
+    std::vector<uint16_t> slotGeneration;  // Incremented each time a slot is freed
+    std::vector<uint16_t> freeSlots;       // Unused slots (stack)
+    uint32_t nextSerial = 0;               // Serial of the next planet
+};
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <M5Unified.h>
+#include "Hal.h"
 #include <cstdint>
+#include "PhysicsConstants.h"
 
 // Tone settings for feedback sound
 namespace ToneConstants {
@@ -11,36 +12,29 @@ namespace ToneConstants {
     const uint32_t TONE_DURATION = 50U;
 }
 
-// Constants related to physics simulation
-namespace PhysicsConstants {
-    // Gravitational constant
-    constexpr double G = 6.67430e-11;
-    // Time scale (to speed up simulation)
-    constexpr double TIME_SCALE = 2.0e10;
-    // Distance scale (to adjust display)
-    constexpr double DISTANCE_SCALE = 1.0e9;
-    // Minimum distance (to prevent collision)
-    constexpr double MIN_DISTANCE = 3.0;
-    // Skip gravity calculation between planets beyond this distance (to reduce processing load)
-    constexpr double MAX_FORCE_DISTANCE = 100.0;
-    // Velocity factor
-    constexpr double SPEED_FACTOR = 2.0e-14;
-    
-    // Pre-computed constants for optimization
-    constexpr double MAX_FORCE_DISTANCE_SQUARED = MAX_FORCE_DISTANCE * MAX_FORCE_DISTANCE;
-    constexpr double MIN_DISTANCE_SQUARED = MIN_DISTANCE * MIN_DISTANCE;
+// Constants related to the cell-list force solver
+namespace CellListConstants {
+    // Cell width (pixels); pairs within the force cutoff are always in neighbouring cells
+    constexpr double CELL_SIZE = PhysicsConstants::MAX_FORCE_DISTANCE;
+    // Half width of the gridded area around the sun (bodies outside are clamped to edge cells)
+    constexpr double HALF_EXTENT = 200.0;
+    // Maximum number of planets when the cell-list solver is selected
+    constexpr int MAX_PLANET_COUNT = 100;
 }
 
 // Constants related to the sun
 namespace SunConstants {
-    // Sun's mass
-    constexpr double MASS = 3.33e5;
+    // Sun's mass is defined in PhysicsConstants.h
     // Sun's radius (pixels)
     constexpr int RADIUS = 10;
     // Sun's base color
     constexpr uint16_t BASE_COLOR = TFT_ORANGE;
     // Intensity of sun's brightness fluctuation
     constexpr float BRIGHTNESS_FLUCTUATION = 0.1f;  // Brightness fluctuation range (0-1)
+    // Pre-rendered ray patterns the sun cycles through at random
+    constexpr int FRAME_COUNT = 16;
+    // Interval between changes of the sun's brightness (milliseconds)
+    constexpr unsigned long COLOR_UPDATE_INTERVAL = 100;
     
     // Pre-computed constants for optimization
     constexpr double RADIUS_SQUARED = RADIUS * RADIUS;
@@ -48,24 +42,150 @@ namespace SunConstants {
 
 // Constants related to planets
 namespace PlanetConstants {
-    // Planet's mass
-    constexpr double MASS = 30000;
+    // Planet's mass is defined in PhysicsConstants.h
     // Planet's radius (pixels)
     constexpr int RADIUS = 2;
+    // Maximum radius of merged planets (pixels)
+    constexpr float MAX_RADIUS = 6.0f;
     // Maximum number of planets
     constexpr int MAX_COUNT = 10;
-    // Number of trail points (increased for longer, beautiful light tails)
+    // Largest planet limit that may override the solver limits in headless runs (BodyStore slots are 16-bit)
+    constexpr int MAX_LIMIT = 50000;
+    // Maximum number of trail points per planet (increased for longer, beautiful light tails)
     constexpr int TRAIL_LENGTH = 35;
 }
 
+// Constants related to the shared trail pool
+namespace TrailConstants {
+    // Trail points shared by all planets (int16 x/y, 16 KB); trails shorten as planets are added
+    constexpr size_t POOL_POINTS = 4096;
+    // Largest pool a raised planet limit may grow to (1 MB, copied into every published snapshot):
+    // full trails up to about 7500 planets, shorter ones beyond
+    constexpr size_t MAX_POOL_POINTS = 262144;
+}
+
+// Constants related to the Barnes-Hut force solver
+namespace BarnesHutConstants {
+    // Default opening angle (node size / distance below which a node is approximated)
+    constexpr double DEFAULT_OPENING_ANGLE = 0.5;
+    // Maximum quadtree depth (bodies closer than this are kept in the same leaf)
+    constexpr int MAX_DEPTH = 16;
+    // Maximum number of planets when the Barnes-Hut solver is selected
+    constexpr int MAX_PLANET_COUNT = 1000;
+}
+
+// Constants related to the simulation clock
+namespace ClockConstants {
+    // Wall time simulated by one base step (microseconds); a physics step lasts STEP_MICROS * time step
+    constexpr uint32_t STEP_MICROS = 1000;
+    // Maximum steps run to catch up in one advance (further lag is dropped, slowing the sim)
+    constexpr int MAX_CATCH_UP_STEPS = 10;
+}
+
+// Constants related to the integrator
+namespace IntegratorConstants {
+    // Default simulated time per physics step (base steps); block timesteps subdivide it
+    // down to 1/2^MAX_LEVEL for planets passing close to the sun
+    constexpr double DEFAULT_TIME_STEP = 16.0;
+}
+
+// Constants related to block timesteps (per-planet power-of-two substeps)
+namespace BlockStepConstants {
+    // Finest level; a planet's substep is the time step / 2^level
+    constexpr int MAX_LEVEL = 6;
+    // Substep as a fraction of the local dynamical time sqrt(r / |a|)
+    constexpr double ACCURACY = 0.01;
+}
+
+// Constants related to the physics / render pipeline
+namespace PipelineConstants {
+    // Core the physics task is pinned to (the Arduino loop runs on core 1)
+    constexpr int PHYSICS_TASK_CORE = 0;
+    // Stack size of the physics task (bytes)
+    constexpr uint32_t PHYSICS_TASK_STACK_SIZE = 8192;
+    // Priority of the physics task
+    constexpr int PHYSICS_TASK_PRIORITY = 1;
+    // Sleep between polls of the simulation clock (milliseconds)
+    constexpr unsigned long PHYSICS_POLL_INTERVAL = 1;
+    // Maximum number of planet spawn requests waiting for the physics task
+    constexpr size_t SPAWN_QUEUE_SIZE = 16;
+    // Maximum number of effects waiting for the render side
+    constexpr size_t MAX_PENDING_EVENTS = 64;
+}
+
+// Constants related to the host thread pool
+namespace ParallelConstants {
+    // Planets per chunk of a parallel force pass (fewer planets run on one thread)
+    constexpr size_t FORCE_GRAIN = 64;
+}
+
+// Constants related to the render-loop scheduler
+namespace SchedulerConstants {
+    // Maximum number of periodic jobs
+    constexpr int MAX_JOBS = 8;
+    // A job starting later than this after its deadline is counted as late (microseconds)
+    constexpr uint32_t LATE_TOLERANCE = 2000;
+    // Interval between polls of the buttons, touch panel and serial port (milliseconds)
+    constexpr unsigned long INPUT_INTERVAL = 10;
+    // Job priorities (higher runs first when several jobs are due)
+    constexpr int INPUT_PRIORITY = 3;
+    constexpr int FRAME_PRIORITY = 2;
+    constexpr int EFFECT_PRIORITY = 1;
+    constexpr int SAVE_PRIORITY = 0;
+}
+
 // Constants related to rendering
 namespace RenderConstants {
     // Drawing update interval (milliseconds)
     constexpr unsigned long DRAW_INTERVAL = 70;
-    // Trail update interval (milliseconds)
+    // Trail update interval (milliseconds of simulated time)
     constexpr unsigned long TRAIL_UPDATE_INTERVAL = 35;
+    // Trail update interval (base steps)
+    constexpr uint32_t TRAIL_UPDATE_STEPS = TRAIL_UPDATE_INTERVAL * 1000 / ClockConstants::STEP_MICROS;
     // Margin to determine off-screen (pixels)
     constexpr int SCREEN_MARGIN = 20;
+    // Maximum number of dirty rectangles per frame (more are merged)
+    constexpr int MAX_DIRTY_RECTS = 16;
+    // Bytes per pixel transmitted to the display (RGB565)
+    constexpr int BYTES_PER_PIXEL = 2;
+    // Largest disc drawn from a precomputed span mask (larger ones go through the canvas)
+    constexpr int MAX_DISC_RADIUS = 8;
+}
+
+// Constants related to the stage profiler
+namespace ProfilerConstants {
+    // Samples kept per stage (older samples are overwritten)
+    constexpr uint32_t HISTORY_SIZE = 128;
+    // A drawn frame taking longer than this is counted as slow (microseconds, half the draw interval)
+    constexpr uint32_t SLOW_FRAME_MICROS = RenderConstants::DRAW_INTERVAL * 1000 / 2;
+}
+
+// Constants related to saving and restoring the session
+namespace StateConstants {
+    // Session state in storage (restored at boot unless button B is held)
+    constexpr const char* FILE_NAME = "state.bin";
+    // Interval between automatic saves (milliseconds)
+    constexpr uint32_t SAVE_INTERVAL = 60000;
+}
+
+// Constants related to input recording and replay
+namespace InputLogConstants {
+    // Session log in storage (overwritten at every boot unless it is being replayed)
+    constexpr const char* FILE_NAME = "session.rec";
+    // Steps between planet-state checksums in the log
+    constexpr uint32_t CHECKPOINT_STEPS = 256;
+}
+
+// Constants related to the serial telemetry stream
+namespace TelemetryConstants {
+    // Minimum time between frames (milliseconds)
+    constexpr uint32_t INTERVAL = 100;
+    // Average bytes per second (half the serial line rate, the rest is left for text)
+    constexpr float BYTES_PER_SECOND = hal::SERIAL_BAUD_RATE / 10 / 2;
+    // Largest burst above the average (bytes); larger frames are always dropped
+    constexpr uint32_t BURST_BYTES = 2048;
+    // Frames sent between keyframes (a decoder that joins late syncs at the next one)
+    constexpr uint32_t KEYFRAME_INTERVAL = 50;
 }
 
 // Constants related to collision effects
@@ -74,8 +194,10 @@ namespace CollisionConstants {
     constexpr int COLLISION_EFFECT_RADIUS = 4;
     // Color of collision effect
     constexpr uint16_t COLLISION_EFFECT_COLOR = TFT_YELLOW;
-    // Duration of collision effect (milliseconds)
+    // Duration of collision effect (milliseconds of simulated time)
     constexpr unsigned long COLLISION_EFFECT_DURATION = 105;
+    // Duration of collision effect (base steps)
+    constexpr uint32_t COLLISION_EFFECT_STEPS = COLLISION_EFFECT_DURATION * 1000 / ClockConstants::STEP_MICROS;
 }
 
 // Constants related to firework effects
@@ -88,8 +210,12 @@ namespace FireworkConstants {
     constexpr int PARTICLE_LIFETIME = 10;
     // Gravity applied to particles (pixels per frame squared)
     constexpr double PARTICLE_GRAVITY = 1.0;
-    // Maximum number of firework effects
-    constexpr int MAX_EFFECTS = 5;
+    // Capacity of the particle pool (the oldest particles are recycled beyond it)
+    constexpr int MAX_PARTICLES = 4096;
+    // Entries of the precomputed spawn velocity table
+    constexpr int VELOCITY_TABLE_SIZE = 64;
+    // Fractional bits of particle positions and velocities (int16, so positions span +-512 pixels)
+    constexpr int PARTICLE_FRACTION_BITS = 6;
 }
 
 // Constants related to ripple effects
@@ -105,3 +231,24 @@ namespace RippleConstants {
     // Initial ripple radius (pixels)
     constexpr int INITIAL_RADIUS = 2;
 }
+
+// Constants related to the headless native build
+namespace NativeConstants {
+    // Default run length (milliseconds)
+    constexpr uint32_t RUN_DURATION = 10000;
+    // Interval between scripted touches (milliseconds)
+    constexpr uint32_t FLING_INTERVAL = 1500;
+    // How long each scripted touch is held while dragging (milliseconds)
+    constexpr uint32_t FLING_HOLD = 300;
+    // Distance of scripted touch start points from the screen center (pixels)
+    constexpr int FLING_RADIUS = 70;
+    // Length of scripted drags (pixels)
+    constexpr int FLING_LENGTH = 25;
+    // Simulated display transfer time (nanoseconds per pixel: 16 bits over a 40 MHz SPI bus)
+    constexpr uint32_t TRANSFER_NANOS = 400;
+    // Innermost and outermost orbits of the planets added by --bodies (pixels)
+    constexpr int MIN_ORBIT = 30;
+    constexpr int MAX_ORBIT = 110;
+    // Mass of those planets relative to a touched one (small and light, so the crowd rarely merges)
+    constexpr double ORBIT_MASS_SCALE = 0.001;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include "Constants.h"
+
+/**
+ * Screen rectangle (pixels)
+ */
+struct DirtyRect {
+    int left;    // Leftmost column
+    int top;     // Topmost row
+    int right;   // Column one past the rightmost
+    int bottom;  // Row one past the bottommost
+
+    /**
+     * Get the area of the rectangle
+     * @return Area (pixels)
+     */
+    int area() const { return (right - left) * (bottom - top); }
+};
+
+/**
+ * DirtyRegion Class
+ * Small set of screen rectangles covering everything drawn in a frame.
+ * Overlapping rectangles are merged; when the set is full, the new rectangle
+ * is merged into the one whose bounding box grows the least.
+ */
+class DirtyRegion {
+public:
+    /**
+     * Constructor
+     * @param width Screen width (rectangles are clipped to the screen)
+     * @param height Screen height
+     */
+    DirtyRegion(int width = 0, int height = 0);
+
+    /**
+     * Set the screen size and clear the region
+     * @param width Screen width
+     * @param height Screen height
+     */
+    void setBounds(int width, int height);
+
+    /**
+     * Remove all rectangles
+     */
+    void clear();
+
+    /**
+     * Add a rectangle
+     * @param x X coordinate of the top-left corner
+     * @param y Y coordinate of the top-left corner
+     * @param w Width
+     * @param h Height
+     */
+    void add(int x, int y, int w, int h);
+
+    /**
+     * Add a rectangle around a circle
+     * @param x X coordinate of the center
+     * @param y Y coordinate of the center
+     * @param radius Radius
+     */
+    void addCircle(int x, int y, int radius);
+
+    /**
+     * Add a rectangle around a line
+     * @param x0 X coordinate of the start point
+     * @param y0 Y coordinate of the start point
+     * @param x1 X coordinate of the end point
+     * @param y1 Y coordinate of the end point
+     * @param margin Extra pixels on every side
+     */
+    void addLine(int x0, int y0, int x1, int y1, int margin = 0);
+
+    /**
+     * Add every rectangle of another region
+     * @param other Region to add
+     */
+    void add(const DirtyRegion& other);
+
+    /**
+     * Add the whole screen
+     */
+    void addAll();
+
+    /**
+     * Get the number of rectangles
+     * @return Number of rectangles
+     */
+    int getCount() const;
+
+    /**
+     * Get a rectangle
+     * @param index Index of the rectangle
+     * @return Rectangle
+     */
+    const DirtyRect& getRect(int index) const;
+
+    /**
+     * Get the total area of the rectangles
+     * @return Area (pixels)
+     */
+    int getArea() const;
+
+private:
+    /**
+     * Add a clipped, non-empty rectangle, merging it with overlapping ones
+     * @param rect Rectangle
+     */
+    void insert(DirtyRect rect);
+
+    int width, height;  // Screen size
+    DirtyRect rects[RenderConstants::MAX_DIRTY_RECTS];  // Disjoint-ish rectangles
+    int count;  // Number of rectangles
+};
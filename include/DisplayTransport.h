@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include "Hal.h"
+#include "DirtyRegion.h"
+
+/**
+ * DisplayTransport Class
+ * Sends rectangles of a sprite to the display in the background. push()
+ * starts the transfer and returns; the sprite must not be drawn into until
+ * wait() (the completion fence) has returned, and only one transfer runs at
+ * a time, so push() waits for the previous one first. On device the
+ * rectangles go out through M5GFX's DMA path and the SPI bus stays held
+ * until the fence. The native build simulates the link: the framebuffer is
+ * updated only when the transfer completes, after the display's
+ * getTransferNanos() per pixel, so drawing into a sprite before its fence shows up as a torn frame
+ * (and is counted), and the overlap gained can be measured on the host.
+ */
+class DisplayTransport {
+public:
+    /**
+     * Constructor
+     * @param display Display the rectangles are sent to
+     */
+    explicit DisplayTransport(hal::Display& display);
+
+    /**
+     * Start sending rectangles of a sprite (waits for the previous transfer first)
+     * @param canvas Sprite (same size as the display, untouched until wait() returns)
+     * @param region Rectangles to send
+     */
+    void push(hal::Canvas& canvas, const DirtyRegion& region);
+
+    /**
+     * Check whether a transfer is still running
+     * @return true if busy
+     */
+    bool isBusy();
+
+    /**
+     * Wait until the running transfer (if any) has completed
+     */
+    void wait();
+
+    /**
+     * Check whether a sprite may be drawn into (no transfer is reading it)
+     * @param canvas Sprite
+     * @return true if the sprite is free
+     */
+    bool isFree(const hal::Canvas& canvas);
+
+    /**
+     * Get the time spent blocked in wait() so far
+     * @return Microseconds
+     */
+    uint64_t getWaitMicros() const { return waitMicros; }
+
+    /**
+     * Get the number of transfers started so far
+     * @return Number of transfers
+     */
+    uint32_t getTransferCount() const { return transferCount; }
+
+#if !defined(ARDUINO)
+    /**
+     * Get the simulated time of all transfers so far
+     * @return Microseconds
+     */
+    uint64_t getTransferMicros() const { return transferMicros; }
+
+    /**
+     * Get the number of transfers whose sprite changed before they completed
+     * @return Number of torn transfers
+     */
+    uint32_t getTornCount() const { return tornCount; }
+#endif
+
+private:
+    /**
+     * Finish the running transfer
+     */
+    void complete();
+
+    hal::Display& display;         // Display the rectangles are sent to
+    hal::Canvas* source;           // Sprite being sent (nullptr when idle)
+    uint64_t waitMicros;           // Time blocked in wait()
+    uint32_t transferCount;        // Transfers started
+#if !defined(ARDUINO)
+    DirtyRegion pending;           // Rectangles of the running transfer
+    uint32_t startMicros;          // Start of the running transfer
+    uint32_t durationMicros;       // Simulated duration of the running transfer
+    uint32_t checksum;             // Checksum of the rectangles when the transfer started
+    uint64_t transferMicros;       // Simulated time of all transfers
+    uint32_t tornCount;            // Transfers whose sprite changed before completion
+
+    /**
+     * Checksum of the pending rectangles of the source sprite
+     * @return Checksum
+     */
+    uint32_t checksumPending() const;
+#endif
+};
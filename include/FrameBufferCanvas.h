@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// RGB565 colors the shared code uses (same values as M5GFX)
+constexpr uint16_t TFT_BLACK = 0x0000;
+constexpr uint16_t TFT_WHITE = 0xFFFF;
+constexpr uint16_t TFT_YELLOW = 0xFFE0;
+constexpr uint16_t TFT_ORANGE = 0xFDA0;
+constexpr uint16_t BLACK = TFT_BLACK;
+constexpr uint16_t WHITE = TFT_WHITE;
+constexpr uint16_t YELLOW = TFT_YELLOW;
+
+/**
+ * FrameBufferDisplay Class
+ * In-memory RGB565 screen for the native build (stands in for M5GFX)
+ */
+class FrameBufferDisplay {
+public:
+    /**
+     * Constructor
+     * @param width Width (pixels)
+     * @param height Height (pixels)
+     */
+    FrameBufferDisplay(int width, int height);
+
+    int width() const { return screenWidth; }
+    int height() const { return screenHeight; }
+
+    /**
+     * Begin a transfer (no-op, kept for the M5GFX interface)
+     */
+    void startWrite() {}
+
+    /**
+     * End a transfer (no-op, kept for the M5GFX interface)
+     */
+    void endWrite() {}
+
+    /**
+     * Restrict later pushes to a rectangle
+     * @param x Left edge
+     * @param y Top edge
+     * @param w Width
+     * @param h Height
+     */
+    void setClipRect(int x, int y, int w, int h);
+
+    /**
+     * Remove the clip rectangle
+     */
+    void clearClipRect();
+
+    /**
+     * Copy pixels into the framebuffer (clipped to the screen and clip rectangle)
+     * @param x Left edge of the image
+     * @param y Top edge of the image
+     * @param w Image width
+     * @param h Image height
+     * @param pixels Image pixels (row-major RGB565)
+     */
+    void pushImage(int x, int y, int w, int h, const uint16_t* pixels);
+
+    /**
+     * Get the framebuffer
+     * @return Pixels (row-major RGB565)
+     */
+    const uint16_t* getBuffer() const { return pixels.data(); }
+
+    /**
+     * Get the number of pixels written by pushes so far (what would go over SPI)
+     * @return Pixel count
+     */
+    uint64_t getPushedPixels() const { return pushedPixels; }
+
+    /**
+     * Set the simulated transfer time of the link to the panel (used by DisplayTransport)
+     * @param nanos Nanoseconds per pixel (0 transfers instantly)
+     */
+    void setTransferNanos(uint32_t nanos) { transferNanos = nanos; }
+
+    /**
+     * Get the simulated transfer time of the link to the panel
+     * @return Nanoseconds per pixel
+     */
+    uint32_t getTransferNanos() const { return transferNanos; }
+
+private:
+    int screenWidth, screenHeight;  // Resolution
+    int clipLeft, clipTop, clipRight, clipBottom;  // Clip rectangle (right and bottom exclusive)
+    std::vector<uint16_t> pixels;   // Framebuffer
+    uint64_t pushedPixels;          // Pixels written by pushes
+    uint32_t transferNanos;         // Simulated transfer time per pixel
+};
+
+/**
+ * FrameBufferCanvas Class
+ * In-memory RGB565 sprite for the native build, implementing the subset of
+ * M5Canvas the renderer uses with the same rasterization rules (midpoint
+ * circles, Bresenham lines, scanline triangles). Text is measured with the
+ * default 6x8 font metrics but not rasterized.
+ */
+class FrameBufferCanvas {
+public:
+    /**
+     * Constructor
+     * @param parent Display the sprite is pushed to
+     */
+    explicit FrameBufferCanvas(FrameBufferDisplay* parent);
+
+    /**
+     * Allocate the sprite
+     * @param w Width (pixels)
+     * @param h Height (pixels)
+     * @return Pixel buffer
+     */
+    void* createSprite(int w, int h);
+
+    /**
+     * Set the color depth (only 16 bits are supported)
+     * @param bits Bits per pixel
+     */
+    void setColorDepth(int bits) { (void)bits; }
+
+    /**
+     * Choose external PSRAM for the pixels (host memory is all one kind)
+     * @param enabled Whether createSprite allocates in PSRAM
+     */
+    void setPsram(bool enabled) { (void)enabled; }
+
+    int width() const { return spriteWidth; }
+    int height() const { return spriteHeight; }
+    void* getBuffer() { return pixels.data(); }
+
+    // Drawing primitives (clipped to the sprite)
+    void fillScreen(uint16_t color);
+    void drawPixel(int x, int y, uint16_t color);
+    void fillRect(int x, int y, int w, int h, uint16_t color);
+    void drawCircle(int x, int y, int r, uint16_t color);
+    void fillCircle(int x, int y, int r, uint16_t color);
+    void drawLine(int x0, int y0, int x1, int y1, uint16_t color);
+    void fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color);
+
+    // Text (metrics of the default font)
+    void setCursor(int x, int y) { cursorX = x; cursorY = y; }
+    void setTextColor(uint16_t color) { textColor = color; }
+    void print(const char* text);
+    int textWidth(const char* text) const;
+    int fontHeight() const { return FONT_HEIGHT; }
+
+    /**
+     * Copy the sprite to the parent display
+     * @param x Left edge on the display
+     * @param y Top edge on the display
+     */
+    void pushSprite(int x, int y);
+
+private:
+    static constexpr int FONT_WIDTH = 6;   // Default font glyph advance (pixels)
+    static constexpr int FONT_HEIGHT = 8;  // Default font height (pixels)
+
+    /**
+     * Draw a horizontal span (clipped)
+     */
+    void drawSpan(int x0, int x1, int y, uint16_t color);
+
+    FrameBufferDisplay* parent;      // Display the sprite is pushed to
+    int spriteWidth, spriteHeight;   // Size
+    std::vector<uint16_t> pixels;    // Sprite pixels
+    int cursorX, cursorY;            // Text cursor
+    uint16_t textColor;              // Text color
+};
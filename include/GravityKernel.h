@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "PhysicsConstants.h"
+#include "Scalar.h"
+
+/**
+ * Gravity kernels in simulation units (pixels and steps) for each scalar type
+ */
+template <typename T>
+struct GravityKernel {
+    /**
+     * Calculate acceleration towards a mass at offset (dx, dy)
+     * a = G * M * d / r^3 (no cutoff, no clamp; used for the sun)
+     * @param dx X offset to the mass
+     * @param dy Y offset to the mass
+     * @param gm G * M of the mass (pixels^3 per step^2)
+     * @param ax X component of acceleration (accumulated)
+     * @param ay Y component of acceleration (accumulated)
+     */
+    static void attract(T dx, T dy, T gm, T& ax, T& ay) {
+        T r2 = dx*dx + dy*dy;
+        T r = std::sqrt(r2);
+        T factor = gm / (r * r2);  // 1/r^3 using only one sqrt
+        ax += factor * dx;
+        ay += factor * dy;
+    }
+
+    /**
+     * Calculate acceleration between planets at offset (dx, dy)
+     * Skipped beyond MAX_FORCE_DISTANCE, distance clamped to MIN_DISTANCE
+     * @param dx X offset to the other planet
+     * @param dy Y offset to the other planet
+     * @param gm G * M of the other planet (pixels^3 per step^2)
+     * @param ax X component of acceleration (output)
+     * @param ay Y component of acceleration (output)
+     * @return false if the pair is beyond the force cutoff
+     */
+    static bool pair(T dx, T dy, T gm, T& ax, T& ay) {
+        T r2 = dx*dx + dy*dy;
+
+        // Skip calculation if distance is too far (to reduce processing load)
+        if (r2 > static_cast<T>(PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED)) {
+            return false;
+        }
+
+        // Apply minimum distance (to prevent collision)
+        if (r2 < static_cast<T>(PhysicsConstants::MIN_DISTANCE_SQUARED)) {
+            r2 = static_cast<T>(PhysicsConstants::MIN_DISTANCE_SQUARED);
+        }
+
+        T r = std::sqrt(r2);
+        T factor = gm / (r * r2);  // 1/r^3 using only one sqrt
+        ax = factor * dx;
+        ay = factor * dy;
+        return true;
+    }
+
+    /**
+     * Calculate the accelerations of both planets of a pair at offset (dx, dy) from i to j
+     * Skipped beyond MAX_FORCE_DISTANCE, distance clamped to MIN_DISTANCE
+     * @param dx X offset from planet i to planet j
+     * @param dy Y offset from planet i to planet j
+     * @param gmI G * M of planet i
+     * @param gmJ G * M of planet j
+     * @param axI X component of acceleration of planet i (output)
+     * @param ayI Y component of acceleration of planet i (output)
+     * @param axJ X component of acceleration of planet j (output)
+     * @param ayJ Y component of acceleration of planet j (output)
+     * @return false if the pair is beyond the force cutoff
+     */
+    static bool mutual(T dx, T dy, T gmI, T gmJ, T& axI, T& ayI, T& axJ, T& ayJ) {
+        T r2 = dx*dx + dy*dy;
+
+        // Skip calculation if distance is too far (to reduce processing load)
+        if (r2 > static_cast<T>(PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED)) {
+            return false;
+        }
+
+        // Apply minimum distance (to prevent collision)
+        if (r2 < static_cast<T>(PhysicsConstants::MIN_DISTANCE_SQUARED)) {
+            r2 = static_cast<T>(PhysicsConstants::MIN_DISTANCE_SQUARED);
+        }
+
+        T r = std::sqrt(r2);
+        T invR3 = T(1) / (r * r2);  // 1/r^3 shared by both planets
+        T factorI = gmJ * invR3;
+        T factorJ = gmI * invR3;
+        axI = factorI * dx;
+        ayI = factorI * dy;
+        axJ = -factorJ * dx;
+        ayJ = -factorJ * dy;
+        return true;
+    }
+};
+
+/**
+ * Fixed-point kernels
+ * Squares of pixel offsets overflow 32-bit storage, so r^2 is kept in 64 bits
+ * with 2 * FRAC_BITS fraction bits and 1/r^3 is built up with extra precision
+ */
+template <int FRAC_BITS>
+struct GravityKernel<Fixed<FRAC_BITS>> {
+    using T = Fixed<FRAC_BITS>;
+
+    // Fraction bits of intermediates (1/r in Q.30, G * M / r^3 in Q.42)
+    static constexpr int INV_R_BITS = 30;
+    static constexpr int INV_R3_BITS = 40;
+    static constexpr int GM_INV_R3_BITS = FRAC_BITS + INV_R3_BITS - 20;
+
+    /**
+     * Integer square root of a 64-bit value
+     * @param value Value
+     * @return floor(sqrt(value))
+     */
+    static int64_t isqrt(uint64_t value) {
+        if (value == 0) {
+            return 0;
+        }
+        // Single-precision estimate refined by one Newton step, then corrected exactly
+        uint64_t result = static_cast<uint64_t>(sqrtf(static_cast<float>(value)));
+        if (result == 0) {
+            result = 1;
+        }
+        result = (result + value / result) / 2;
+        while (result * result > value) result--;
+        while ((result + 1) * (result + 1) <= value) result++;
+        return static_cast<int64_t>(result);
+    }
+
+    /**
+     * 1/r^3 in Q.INV_R3_BITS from a raw squared distance (0 if r is 0)
+     */
+    static int64_t inverseCube(uint64_t r2) {
+        int64_t r = isqrt(r2);  // Q.FRAC_BITS
+        if (r == 0) {
+            return 0;
+        }
+        int64_t invR = T::roundedDivide(int64_t(1) << (FRAC_BITS + INV_R_BITS), r);
+        int64_t invR2 = (invR * invR + (int64_t(1) << (INV_R_BITS - 1))) >> INV_R_BITS;
+        return (invR2 * invR + (int64_t(1) << (2 * INV_R_BITS - INV_R3_BITS - 1))) >> (2 * INV_R_BITS - INV_R3_BITS);
+    }
+
+    /**
+     * Acceleration from a raw offset and 1/r^3
+     */
+    static void apply(int64_t dx, int64_t dy, int64_t invR3, T gm, T& ax, T& ay) {
+        int64_t gmInvR3 = (static_cast<int64_t>(gm.getRaw()) * invR3 + (int64_t(1) << 19)) >> 20;
+        ax += T::fromRaw(static_cast<int32_t>(T::roundedDivide(gmInvR3 * dx, int64_t(1) << GM_INV_R3_BITS)));
+        ay += T::fromRaw(static_cast<int32_t>(T::roundedDivide(gmInvR3 * dy, int64_t(1) << GM_INV_R3_BITS)));
+    }
+
+    /**
+     * Acceleration from offset and squared distance (both raw)
+     */
+    static void accelerate(int64_t dx, int64_t dy, uint64_t r2, T gm, T& ax, T& ay) {
+        apply(dx, dy, inverseCube(r2), gm, ax, ay);
+    }
+
+    static void attract(T dx, T dy, T gm, T& ax, T& ay) {
+        // Clamp to 1 pixel so G * M / r^2 cannot overflow (the sun removes planets long before)
+        static const uint64_t MIN_R2 = static_cast<uint64_t>(T::ONE) * static_cast<uint64_t>(T::ONE);
+
+        int64_t x = dx.getRaw();
+        int64_t y = dy.getRaw();
+        uint64_t r2 = static_cast<uint64_t>(x * x) + static_cast<uint64_t>(y * y);
+        if (r2 < MIN_R2) {
+            r2 = MIN_R2;
+        }
+        accelerate(x, y, r2, gm, ax, ay);
+    }
+
+    static bool pair(T dx, T dy, T gm, T& ax, T& ay) {
+        static const uint64_t MAX_R2 = static_cast<uint64_t>(
+            PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED * static_cast<double>(T::ONE) * static_cast<double>(T::ONE));
+        static const uint64_t MIN_R2 = static_cast<uint64_t>(
+            PhysicsConstants::MIN_DISTANCE_SQUARED * static_cast<double>(T::ONE) * static_cast<double>(T::ONE));
+
+        int64_t x = dx.getRaw();
+        int64_t y = dy.getRaw();
+        uint64_t r2 = static_cast<uint64_t>(x * x) + static_cast<uint64_t>(y * y);
+
+        // Skip calculation if distance is too far (to reduce processing load)
+        if (r2 > MAX_R2) {
+            return false;
+        }
+
+        // Apply minimum distance (to prevent collision)
+        if (r2 < MIN_R2) {
+            r2 = MIN_R2;
+        }
+
+        ax = T();
+        ay = T();
+        accelerate(x, y, r2, gm, ax, ay);
+        return true;
+    }
+
+    static bool mutual(T dx, T dy, T gmI, T gmJ, T& axI, T& ayI, T& axJ, T& ayJ) {
+        static const uint64_t MAX_R2 = static_cast<uint64_t>(
+            PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED * static_cast<double>(T::ONE) * static_cast<double>(T::ONE));
+        static const uint64_t MIN_R2 = static_cast<uint64_t>(
+            PhysicsConstants::MIN_DISTANCE_SQUARED * static_cast<double>(T::ONE) * static_cast<double>(T::ONE));
+
+        int64_t x = dx.getRaw();
+        int64_t y = dy.getRaw();
+        uint64_t r2 = static_cast<uint64_t>(x * x) + static_cast<uint64_t>(y * y);
+
+        // Skip calculation if distance is too far (to reduce processing load)
+        if (r2 > MAX_R2) {
+            return false;
+        }
+
+        // Apply minimum distance (to prevent collision)
+        if (r2 < MIN_R2) {
+            r2 = MIN_R2;
+        }
+
+        // 1/r^3 shared by both planets
+        int64_t invR3 = inverseCube(r2);
+        axI = T();
+        ayI = T();
+        axJ = T();
+        ayJ = T();
+        apply(x, y, invR3, gmJ, axI, ayI);
+        apply(-x, -y, invR3, gmI, axJ, ayJ);
+        return true;
+    }
+};
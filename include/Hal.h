@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#if defined(ARDUINO)
+#include <M5Unified.h>
+#include <LittleFS.h>
+#else
+#include "FrameBufferCanvas.h"
+#endif
+
+/**
+ * Hardware abstraction layer
+ * The only place that talks to M5Unified and the Arduino core. On device every
+ * function forwards inline to M5Unified (files live on LittleFS); the native
+ * build (no ARDUINO) backs them with a host clock, a seeded RNG, a silent audio
+ * sink, scripted touch and button input, stdout as the serial port, files in
+ * the working directory and in-memory RGB565 framebuffers, so the simulation,
+ * renderer and touch handling run headless with the same code.
+ */
+namespace hal {
+    constexpr uint32_t SERIAL_BAUD_RATE = 115200;  // Serial line rate (matches monitor_speed)
+    constexpr size_t SERIAL_TX_BUFFER_SIZE = 2048;  // Serial transmit buffer (bytes)
+
+    /**
+     * State of the touch panel
+     */
+    struct TouchPoint {
+        bool touched;  // Whether a touch point is reported
+        bool pressed;  // Whether the touch point is held down
+        int x;         // X coordinate (last known position after release)
+        int y;         // Y coordinate (last known position after release)
+    };
+
+    /**
+     * Buttons below the screen
+     */
+    enum class Button : uint8_t {
+        A,  // Left
+        B,  // Middle
+        C   // Right
+    };
+
+#if defined(ARDUINO)
+    typedef M5GFX Display;    // Screen the canvas is pushed to
+    typedef M5Canvas Canvas;  // Off-screen RGB565 sprite
+
+    // Clock
+    inline uint32_t millis() { return ::millis(); }
+    inline uint32_t micros() { return ::micros(); }
+    inline void delay(uint32_t ms) { ::delay(ms); }
+    inline void sleepUntil(uint32_t deadlineMicros) {
+        // Whole RTOS ticks, rounded up (the wake-up is at most one tick late, and other tasks run meanwhile)
+        int32_t remaining = static_cast<int32_t>(deadlineMicros - ::micros());
+        if (remaining > 0) {
+            const int32_t tickMicros = portTICK_PERIOD_MS * 1000;
+            TickType_t wake = xTaskGetTickCount();
+            vTaskDelayUntil(&wake, (remaining + tickMicros - 1) / tickMicros);
+        }
+    }
+
+    // Random numbers
+    inline long random(long max) { return ::random(max); }
+    inline long random(long min, long max) { return ::random(min, max); }
+    inline void randomSeed(uint32_t seed) { ::randomSeed(seed); }
+
+    // Audio sink
+    inline void setVolume(uint8_t volume) { M5.Speaker.setVolume(volume); }
+    inline void tone(float frequency, uint32_t durationMs) { M5.Speaker.tone(frequency, durationMs); }
+
+    // Touch source
+    inline TouchPoint readTouch() {
+        auto detail = M5.Touch.getDetail();
+        TouchPoint touch = {M5.Touch.getCount() > 0, detail.isPressed(), detail.x, detail.y};
+        return touch;
+    }
+
+    // Buttons
+    inline bool wasButtonPressed(Button button) {
+        switch (button) {
+            case Button::A: return M5.BtnA.wasPressed();
+            case Button::B: return M5.BtnB.wasPressed();
+            default: return M5.BtnC.wasPressed();
+        }
+    }
+
+    inline bool isButtonPressed(Button button) {
+        switch (button) {
+            case Button::A: return M5.BtnA.isPressed();
+            case Button::B: return M5.BtnB.isPressed();
+            default: return M5.BtnC.isPressed();
+        }
+    }
+
+    // Serial port
+    inline void print(const char* text) { Serial.print(text); }
+    inline int readSerial() { return Serial.available() > 0 ? Serial.read() : -1; }
+    inline size_t serialWritable() { return Serial.availableForWrite(); }
+    inline void writeSerial(const uint8_t* data, size_t size) { Serial.write(data, size); }
+
+    // Storage (stdio files on the LittleFS flash partition, mounted at /littlefs)
+    inline bool beginStorage() { return LittleFS.begin(true); }
+    inline FILE* openFile(const char* name, const char* mode) {
+        char path[64];
+        snprintf(path, sizeof(path), "/littlefs/%s", name);
+        return fopen(path, mode);
+    }
+    inline bool renameFile(const char* from, const char* to) {
+        char fromPath[64];
+        char toPath[64];
+        snprintf(fromPath, sizeof(fromPath), "/littlefs/%s", from);
+        snprintf(toPath, sizeof(toPath), "/littlefs/%s", to);
+        return rename(fromPath, toPath) == 0;
+    }
+
+    // Board
+    inline void begin() {
+        auto cfg = M5.config();
+        cfg.serial_baudrate = SERIAL_BAUD_RATE;
+        Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE);  // Before M5.begin opens the port
+        M5.begin(cfg);
+    }
+    inline void update() { M5.update(); }
+    inline Display& getDisplay() { return M5.Display; }
+    inline bool hasPsram() { return psramFound(); }
+
+    // Sprite pixel format (M5Canvas keeps RGB565 big-endian, ready to send over SPI)
+    inline uint16_t toCanvasColor(uint16_t color) { return static_cast<uint16_t>((color << 8) | (color >> 8)); }
+    inline uint16_t fromCanvasColor(uint16_t pixel) { return static_cast<uint16_t>((pixel << 8) | (pixel >> 8)); }
+#else
+    typedef FrameBufferDisplay Display;
+    typedef FrameBufferCanvas Canvas;
+
+    /**
+     * Get milliseconds since start (host steady clock)
+     * @return Milliseconds
+     */
+    uint32_t millis();
+
+    /**
+     * Get microseconds since start (host steady clock)
+     * @return Microseconds
+     */
+    uint32_t micros();
+
+    /**
+     * Sleep the calling thread
+     * @param ms Milliseconds
+     */
+    void delay(uint32_t ms);
+
+    /**
+     * Sleep the calling thread until a time
+     * @param deadlineMicros Time to wake up (micros() clock; returns at once if it has passed)
+     */
+    void sleepUntil(uint32_t deadlineMicros);
+
+    /**
+     * Get a random number in [0, max) (same contract as Arduino's random)
+     * @param max Upper bound (exclusive)
+     * @return Random number (0 if max is not positive)
+     */
+    long random(long max);
+
+    /**
+     * Get a random number in [min, max)
+     * @param min Lower bound (inclusive)
+     * @param max Upper bound (exclusive)
+     * @return Random number (min if the range is empty)
+     */
+    long random(long min, long max);
+
+    /**
+     * Seed the random number generator (runs are reproducible for a given seed)
+     * @param seed Seed
+     */
+    void randomSeed(uint32_t seed);
+
+    /**
+     * Set the speaker volume (recorded only)
+     * @param volume Volume (0-255)
+     */
+    void setVolume(uint8_t volume);
+
+    /**
+     * Play a tone (recorded only)
+     * @param frequency Frequency (Hz)
+     * @param durationMs Duration (milliseconds)
+     */
+    void tone(float frequency, uint32_t durationMs);
+
+    /**
+     * Get the number of tones played so far
+     * @return Number of tones
+     */
+    uint32_t getToneCount();
+
+    /**
+     * Read the touch panel (the state last set by setTouch)
+     * @return Touch state
+     */
+    TouchPoint readTouch();
+
+    /**
+     * Set the touch state reported by readTouch (drives the scripted touch source)
+     * @param touch Touch state
+     */
+    void setTouch(const TouchPoint& touch);
+
+    /**
+     * Check whether a button was pressed since the last call (set by pressButton)
+     * @param button Button
+     * @return true if pressed
+     */
+    bool wasButtonPressed(Button button);
+
+    /**
+     * Check whether a button is held down (never on host)
+     * @param button Button
+     * @return true if held
+     */
+    bool isButtonPressed(Button button);
+
+    /**
+     * Press a button (drives the scripted input source)
+     * @param button Button
+     */
+    void pressButton(Button button);
+
+    /**
+     * Write text to the serial port (stdout on host)
+     * @param text Text
+     */
+    void print(const char* text);
+
+    /**
+     * Read a character from the serial port (no input on host)
+     * @return Character, or -1 if none is available
+     */
+    int readSerial();
+
+    /**
+     * Get the free space of the serial transmit buffer (host: a buffer drained at the line rate)
+     * @return Bytes that can be written without blocking
+     */
+    size_t serialWritable();
+
+    /**
+     * Write bytes to the serial port (stdout on host)
+     * @param data Bytes
+     * @param size Number of bytes
+     */
+    void writeSerial(const uint8_t* data, size_t size);
+
+    /**
+     * Send the serial output to a file instead of stdout (e.g. a pseudo-terminal in tests)
+     * @param file Output (nullptr restores stdout)
+     */
+    void setSerialOutput(FILE* file);
+
+    /**
+     * Prepare file storage (the working directory on host)
+     * @return true if files can be opened
+     */
+    bool beginStorage();
+
+    /**
+     * Open a file in storage
+     * @param name File name
+     * @param mode fopen mode
+     * @return File (nullptr on failure)
+     */
+    FILE* openFile(const char* name, const char* mode);
+
+    /**
+     * Rename a file in storage, replacing an existing file of the new name
+     * @param from Current name
+     * @param to New name
+     * @return true if renamed
+     */
+    bool renameFile(const char* from, const char* to);
+
+    /**
+     * Initialize the board (no-op on host)
+     */
+    void begin();
+
+    /**
+     * Poll inputs (no-op on host)
+     */
+    void update();
+
+    /**
+     * Get the display (a framebuffer with the device's resolution)
+     * @return Display
+     */
+    Display& getDisplay();
+
+    /**
+     * Check whether the board has external PSRAM for large buffers (none on host)
+     * @return true if sprites can be allocated in PSRAM
+     */
+    inline bool hasPsram() { return false; }
+
+    /**
+     * Convert an RGB565 color to the byte order of canvas pixels (framebuffers use native order)
+     * @param color RGB565 color
+     * @return Pixel value
+     */
+    inline uint16_t toCanvasColor(uint16_t color) { return color; }
+
+    /**
+     * Convert a canvas pixel back to an RGB565 color
+     * @param pixel Pixel value
+     * @return RGB565 color
+     */
+    inline uint16_t fromCanvasColor(uint16_t pixel) { return pixel; }
+#endif
+}
+
+#if !defined(ARDUINO)
+// Arduino core helpers used by the shared code
+#ifndef DEG_TO_RAD
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#endif
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+#endif
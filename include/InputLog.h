@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Hal.h"
+#include <cstdio>
+#include <vector>
+#include "PhysicsEngine.h"
+#include "SimulationPipeline.h"
+#include "TouchHandler.h"
+#include "StateFile.h"
+
+/**
+ * Kinds of events in an input log
+ */
+enum class InputEventType : uint8_t {
+    TOUCH_BEGIN,  // Touch pressed (value: x in the low 16 bits, y in the high 16 bits)
+    TOUCH_END,    // Touch released (value: x in the low 16 bits, y in the high 16 bits)
+    CHECKPOINT    // Planet state at the step (value: BodyStore::checksum)
+};
+
+/**
+ * One event of an input log (stored as 9 little-endian bytes: step, type, value)
+ */
+struct InputEvent {
+    uint32_t step;        // Physics step count when the event takes effect
+    InputEventType type;  // Kind of event
+    uint32_t value;       // Payload
+};
+
+/**
+ * Settings a session was recorded with (stored after the magic and version)
+ */
+struct InputLogHeader {
+    uint32_t seed;                   // Seed of hal::random and the planet color sequence
+    ForceSolver forceSolver;         // Force solver of the engine
+    Integrator integrator;           // Integrator of the engine
+    double timeStep;                 // Time step of the engine
+    bool startsFromState;            // Whether the session was resumed from a saved state (stored after the header)
+    PairwiseKernel pairwiseKernel;   // Path the pairwise forces were summed on
+    bool fastMath;                   // Whether the recording build used -ffast-math
+};
+
+/**
+ * Input Recorder Class
+ * Logs the touch gestures that added planets, stamped with the physics step
+ * that applied them, plus the seed and periodic planet-state checksums, to a
+ * compact binary file. The header also holds the scalar type and the path
+ * the pairwise forces were summed on. Replaying the file in lockstep on a
+ * build with the same scalar type and floating-point options reproduces the
+ * planet state bit for bit.
+ */
+class InputRecorder {
+public:
+    /**
+     * Constructor
+     */
+    InputRecorder();
+
+    /**
+     * Destructor (closes the file)
+     */
+    ~InputRecorder();
+
+    /**
+     * Start recording (before the pipeline starts)
+     * @param name File name in storage
+     * @param seed Seed the session runs with
+     * @param engine Physics engine (its settings are stored)
+     * @param pipeline Simulation pipeline (set to report applied planet requests)
+     * @param startState State the session was resumed from, stored in the log (nullptr for a fresh session)
+     * @return false if the file could not be created
+     */
+    bool open(const char* name, uint32_t seed, const PhysicsEngine& engine, SimulationPipeline& pipeline,
+              const StateFile* startState = nullptr);
+
+    /**
+     * Log the gestures applied since the last call and a checkpoint if one is due
+     * (render side, after acquiring a snapshot)
+     * @param pipeline Simulation pipeline
+     */
+    void update(SimulationPipeline& pipeline);
+
+    /**
+     * Log what is left, a final checkpoint of the current snapshot, and close the file
+     * @param pipeline Simulation pipeline
+     */
+    void close(SimulationPipeline& pipeline);
+
+    /**
+     * Check whether a recording is in progress
+     * @return true if recording
+     */
+    bool isOpen() const;
+
+private:
+    /**
+     * Append an event
+     * @param event Event
+     */
+    void write(const InputEvent& event);
+
+    /**
+     * Append a checkpoint of a snapshot
+     * @param snapshot Snapshot
+     */
+    void writeCheckpoint(const SimulationSnapshot& snapshot);
+
+    FILE* file;                   // Output file (nullptr if not recording)
+    uint32_t nextCheckpointStep;  // Step count at which the next checkpoint is due
+    uint32_t lastCheckpointStep;  // Step count of the last checkpoint
+};
+
+/**
+ * Input Replay Class
+ * Feeds a recorded input log back through the touch handler in lockstep with
+ * the physics steps, and compares the planet state with the recorded
+ * checkpoints. Logs of another scalar type are rejected. A log recorded with
+ * other floating-point options (-ffast-math on the device, not on the host)
+ * replays the same touches, but its checkpoints are not compared, since the
+ * sums round differently.
+ */
+class InputReplay {
+public:
+    /**
+     * Constructor
+     */
+    InputReplay();
+
+    /**
+     * Load a log (before the pipeline starts)
+     * @param name File name in storage
+     * @param state Session restored from the log's start state, if it has one
+     * @return false if the file is missing, not a supported log, or recorded with another scalar type
+     */
+    bool open(const char* name, StateFile* state = nullptr);
+
+    /**
+     * Check whether a log is loaded
+     * @return true if loaded
+     */
+    bool isOpen() const;
+
+    /**
+     * Get the settings the log was recorded with
+     * @return Header
+     */
+    const InputLogHeader& getHeader() const;
+
+    /**
+     * Apply the recorded engine settings and force the recorded pairwise kernel (before the
+     * pipeline starts; a log that starts from a state already restored the other settings)
+     * @param engine Physics engine
+     * @return false if the engine cannot run the recorded kernel (the log is then unloaded)
+     */
+    bool configure(PhysicsEngine& engine);
+
+    /**
+     * Deliver the events due at the engine's current step count (call before running the step);
+     * prints a summary once the last event is consumed
+     * @param engine Physics engine (checked against checkpoints)
+     * @param touchHandler Touch handler the touches are fed to
+     * @return true if touch is active
+     */
+    bool feed(const PhysicsEngine& engine, TouchHandler& touchHandler);
+
+    /**
+     * Check whether every event has been delivered
+     * @return true if finished
+     */
+    bool isFinished() const;
+
+    /**
+     * Get the number of checkpoints that did not match
+     * @return Number of mismatches
+     */
+    uint32_t getMismatchCount() const;
+
+private:
+    /**
+     * Print the checkpoint results and the replay speed
+     * @param step Step count at the end
+     */
+    void report(uint32_t step) const;
+
+    bool loaded;                     // Whether a log is loaded
+    InputLogHeader header;           // Recorded settings
+    std::vector<InputEvent> events;  // Recorded events (in file order)
+    size_t nextEvent;                // Index of the next event to deliver
+    hal::TouchPoint touch;           // Touch state being replayed
+    uint32_t matched;                // Checkpoints that matched
+    uint32_t mismatched;             // Checkpoints that did not match
+    uint32_t uncompared;             // Checkpoints skipped (recorded with other floating-point options)
+    bool started;                    // Whether feed has been called
+    uint32_t startMillis;            // Time of the first feed
+    uint32_t startStep;              // Step count at the first feed
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Constants.h"
+
+class StateWriter;
+class StateReader;
+
+/**
+ * ParticleSystem Class
+ * Firework particles as a structure of arrays of int16 fixed-point values
+ * (FRACTION_BITS fractional bits) in one pool of fixed capacity. Every
+ * particle lives for PARTICLE_LIFETIME frames, so particles die in the order
+ * they were spawned and the pool is a ring: spawns append at the head, the
+ * dead are dropped from the tail, and when the pool is full the oldest
+ * particles are recycled instead of new ones being lost. Spawn velocities
+ * come from a table computed once (golden-angle directions with spread-out
+ * speeds), so a firework costs one random number instead of trigonometry per
+ * particle. Drawing and advancing share a single pass.
+ */
+class ParticleSystem {
+public:
+    /**
+     * Constructor
+     * @param capacity Maximum number of live particles
+     */
+    ParticleSystem(size_t capacity = FireworkConstants::MAX_PARTICLES);
+
+    /**
+     * Spawn a burst of particles (the oldest particles are recycled when the pool is full)
+     * @param x X coordinate (relative to center)
+     * @param y Y coordinate (relative to center)
+     * @param color Particle color
+     * @param count Number of particles
+     * @param seed Rotation of the burst in the velocity table
+     */
+    void spawn(double x, double y, uint16_t color, int count, uint32_t seed);
+
+    /**
+     * Visit every particle at its current position, then advance it one frame
+     * (velocity, gravity and lifetime) and drop the particles that expired
+     * @param visit Callback taking (x, y, color, remaining lifetime) with x and y in whole pixels
+     */
+    template <typename Visitor>
+    void drawAndAdvance(Visitor&& visit);
+
+    /**
+     * Remove all particles
+     */
+    void clear();
+
+    /**
+     * Get the number of live particles
+     * @return Number of particles
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Get the number of particles recycled before their lifetime ended (pool full)
+     * @return Number of recycled particles
+     */
+    uint32_t getRecycledCount() const { return recycledCount; }
+
+    /**
+     * Write the live particles to a state file (oldest first)
+     * @param writer State writer
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Read the live particles from a state file
+     * @param reader State reader
+     * @return false if the data is invalid (the pool is then empty)
+     */
+    bool loadState(StateReader& reader);
+
+private:
+    /**
+     * Append a particle at the head (recycling the oldest when full)
+     * @return Slot of the particle
+     */
+    size_t allocate();
+
+    /**
+     * Advance a contiguous run of slots
+     * @param begin First slot
+     * @param end One past the last slot
+     * @param visit Callback of drawAndAdvance
+     */
+    template <typename Visitor>
+    void advanceRange(size_t begin, size_t end, Visitor& visit);
+
+    static constexpr int FRACTION_BITS = FireworkConstants::PARTICLE_FRACTION_BITS;
+    static constexpr int ONE = 1 << FRACTION_BITS;  // 1 pixel in fixed point
+
+    size_t capacity;             // Size of the ring
+    size_t tail;                 // Slot of the oldest particle
+    size_t count;                // Number of live particles
+    uint32_t recycledCount;      // Particles overwritten while still alive
+    std::vector<int16_t> x;      // X position (relative to center)
+    std::vector<int16_t> y;      // Y position (relative to center)
+    std::vector<int16_t> vx;     // X velocity (per frame)
+    std::vector<int16_t> vy;     // Y velocity (per frame)
+    std::vector<uint16_t> color; // Particle color
+    std::vector<uint8_t> life;   // Remaining lifetime (frames)
+    std::vector<int16_t> tableX; // Spawn velocities (X)
+    std::vector<int16_t> tableY; // Spawn velocities (Y)
+};
+
+template <typename Visitor>
+void ParticleSystem::drawAndAdvance(Visitor&& visit) {
+    // The live particles are at most two contiguous runs of the ring
+    size_t end = tail + count;
+    if (end <= capacity) {
+        advanceRange(tail, end, visit);
+    } else {
+        advanceRange(tail, capacity, visit);
+        advanceRange(0, end - capacity, visit);
+    }
+
+    // Particles expire in spawn order, so the dead ones are all at the tail
+    while (count > 0 && life[tail] == 0) {
+        tail = tail + 1 == capacity ? 0 : tail + 1;
+        count--;
+    }
+}
+
+template <typename Visitor>
+void ParticleSystem::advanceRange(size_t begin, size_t end, Visitor& visit) {
+    const int16_t gravity = static_cast<int16_t>(FireworkConstants::PARTICLE_GRAVITY * ONE);
+    for (size_t i = begin; i < end; i++) {
+        visit(x[i] >> FRACTION_BITS, y[i] >> FRACTION_BITS, color[i], life[i]);
+        x[i] += vx[i];
+        y[i] += vy[i];
+        vy[i] += gravity;
+        life[i]--;
+    }
+}
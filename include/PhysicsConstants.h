@@ -0,0 +1,50 @@
+#pragma once
+
+// Physics constants (kept free of device headers so host tools can use them)
+
+// Constants related to physics simulation
+namespace PhysicsConstants {
+    // Gravitational constant
+    constexpr double G = 6.67430e-11;
+    // Time scale (to speed up simulation)
+    constexpr double TIME_SCALE = 2.0e10;
+    // Distance scale (to adjust display)
+    constexpr double DISTANCE_SCALE = 1.0e9;
+    // Minimum distance (to prevent collision)
+    constexpr double MIN_DISTANCE = 3.0;
+    // Skip gravity calculation between planets beyond this distance (to reduce processing load)
+    constexpr double MAX_FORCE_DISTANCE = 100.0;
+    // Velocity factor
+    constexpr double SPEED_FACTOR = 2.0e-14;
+
+    // Pre-computed constants for optimization
+    constexpr double MAX_FORCE_DISTANCE_SQUARED = MAX_FORCE_DISTANCE * MAX_FORCE_DISTANCE;
+    constexpr double MIN_DISTANCE_SQUARED = MIN_DISTANCE * MIN_DISTANCE;
+}
+
+// Constants related to the sun
+namespace SunConstants {
+    // Sun's mass
+    constexpr double MASS = 3.33e5;
+}
+
+// Constants related to planets
+namespace PlanetConstants {
+    // Planet's mass
+    constexpr double MASS = 30000;
+}
+
+// Simulation units used by the engine: pixels and steps (one step = TIME_SCALE seconds).
+// G * MASS / DISTANCE_SCALE^2 is around 1e-23 and underflows single precision once
+// divided by r^3, so the scales are folded into G * M once here instead of per pair.
+namespace StepUnits {
+    // Converts a velocity in pixels per second to pixels per step
+    constexpr double VELOCITY = PhysicsConstants::TIME_SCALE;
+    // Converts G * M to pixels^3 per step^2
+    constexpr double GRAVITY = PhysicsConstants::G * PhysicsConstants::TIME_SCALE * PhysicsConstants::TIME_SCALE /
+                               (PhysicsConstants::DISTANCE_SCALE * PhysicsConstants::DISTANCE_SCALE);
+    // G * M of the sun (about 8.9e-3 pixels^3 per step^2)
+    constexpr double SUN_GM = GRAVITY * SunConstants::MASS;
+    // G * M of a planet (about 8.0e-4 pixels^3 per step^2)
+    constexpr double PLANET_GM = GRAVITY * PlanetConstants::MASS;
+}
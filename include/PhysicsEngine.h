@@ -1,11 +1,73 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include "Planet.h"
+#include "BodyStore.h"
+#include "TrailPool.h"
+#include "QuadTree.h"
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
+#include "Scalar.h"
+#include "SimulationSnapshot.h"
 #include "Constants.h"
 
-// Forward declaration
-class Renderer;
+class ThreadPool;
+
+/**
+ * Algorithm used to calculate gravity between planets
+ */
+enum class ForceSolver {
+    PAIRWISE,    // Exact O(N^2) pairwise loop
+    BARNES_HUT,  // Approximate O(N log N) quadtree
+    CELL_LIST    // Exact within the force cutoff, only visits pairs in neighbouring cells
+};
+
+/**
+ * Scheme used to advance positions and velocities by one step
+ */
+enum class Integrator {
+    SEMI_IMPLICIT_EULER,  // Kick then drift, 1st order (1 force evaluation per step)
+    LEAPFROG,             // Kick-drift-kick, 2nd order (1 evaluation, reuses the previous step's)
+    VELOCITY_VERLET,      // Position/velocity form of leapfrog, 2nd order (1 evaluation, reused)
+    YOSHIDA4,             // Yoshida composition of three leapfrog steps, 4th order (3 evaluations)
+    BLOCK_LEAPFROG        // Leapfrog with per-planet power-of-two substeps (forces only for planets ending one)
+};
+
+/**
+ * How the pairwise solver sums planet gravity (each path rounds differently,
+ * so a session only reproduces bit for bit on the path it was recorded with)
+ */
+enum class PairwiseKernel : uint8_t {
+    SYMMETRIC,  // Scalar loop over each pair once (no thread pool, no vector kernel; the device)
+    ROWS,       // Scalar rows, each pair from both sides (thread pool without a vector kernel)
+    ROWS_SSE2,  // Vector rows of SimdGravity on SSE2
+    ROWS_AVX2   // Vector rows of SimdGravity on AVX2
+};
+
+/**
+ * Conserved quantities of the planets and their drift from a baseline, which is taken by the
+ * first measurement after planets are added, removed or merged
+ * (per unit of PlanetConstants::MASS; pair potentials follow the same cutoff and clamp as the forces)
+ */
+struct ConservationReport {
+    double energy;                // Total energy (pixels^2 per step^2)
+    double angularMomentum;       // Total angular momentum about the sun (pixels^2 per step)
+    double energyDrift;           // |E - E0| / |E0|
+    double angularMomentumDrift;  // |L - L0| / |L0|
+    uint32_t steps;               // Steps since the baseline
+    uint32_t forceEvaluations;    // Planet force evaluations since the baseline (one per planet per evaluation)
+};
+
+/**
+ * Error of a force solver against the exact pairwise kernel
+ * (errors are relative to the RMS magnitude of the exact accelerations)
+ */
+struct ForceErrorReport {
+    size_t planetCount;        // Number of planets compared
+    double rmsRelativeError;   // RMS of the acceleration error
+    double maxRelativeError;   // Maximum acceleration error
+};
 
 /**
  * Physics Engine Class
@@ -15,26 +77,133 @@ class PhysicsEngine {
 public:
     /**
      * Constructor
-     * @param renderer Reference to renderer for firework effects
      */
-    PhysicsEngine(Renderer& renderer);
+    PhysicsEngine();
 
     /**
-     * Add a planet
+     * Add a planet (the oldest planet is dropped when the solver's limit is reached)
      * @param x Initial X coordinate
      * @param y Initial Y coordinate
-     * @param vx Initial X velocity
-     * @param vy Initial Y velocity
+     * @param vx Initial X velocity (pixels per second)
+     * @param vy Initial Y velocity (pixels per second)
      * @param color Planet color
+     * @param mass Planet mass
+     * @return Stable ID of the new planet (BodyStore::INVALID_ID if no slot was free; nothing is added)
+     */
+    BodyId addPlanet(double x, double y, double vx, double vy, uint16_t color,
+                   double mass = PlanetConstants::MASS);
+
+    /**
+     * Select the algorithm for gravity between planets
+     * @param solver Force solver
+     */
+    void setForceSolver(ForceSolver solver);
+
+    /**
+     * Get the selected force solver
+     * @return Force solver
+     */
+    ForceSolver getForceSolver() const;
+
+    /**
+     * Select the integration scheme
+     * @param integrator Integrator
+     */
+    void setIntegrator(Integrator integrator);
+
+    /**
+     * Get the selected integration scheme
+     * @return Integrator
      */
-    void addPlanet(double x, double y, double vx, double vy, uint16_t color);
+    Integrator getIntegrator() const;
 
     /**
-     * Update physics simulation
+     * Set the simulated time advanced by one step
+     * @param timeStep Time step in base steps (see StepUnits; 1 = the original fixed step)
+     */
+    void setTimeStep(double timeStep);
+
+    /**
+     * Get the simulated time advanced by one step
+     * @return Time step in base steps
+     */
+    double getTimeStep() const;
+
+    /**
+     * Measure energy and angular momentum and their drift from the baseline
+     * @return Conservation report
+     */
+    ConservationReport measureConservation();
+
+    /**
+     * Spread the force passes over a thread pool (host only)
+     * Each planet's acceleration is then summed by one thread in a fixed order,
+     * so results do not depend on the number of threads.
+     * @param pool Thread pool (nullptr to run on the calling thread)
+     */
+    void setThreadPool(ThreadPool* pool);
+
+    /**
+     * Get the path the pairwise solver sums gravity on (from the thread pool and SimdGravity)
+     * @return Pairwise kernel
+     */
+    PairwiseKernel getPairwiseKernel() const;
+
+    /**
+     * Force the path the pairwise solver sums gravity on (for replaying a recorded session)
+     * SYMMETRIC drops the thread pool; every path selects its SimdGravity instruction set.
+     * @param kernel Pairwise kernel
+     * @return false if this build or CPU cannot run it (ROWS also needs a thread pool)
+     */
+    bool setPairwiseKernel(PairwiseKernel kernel);
+
+    /**
+     * Set the Barnes-Hut opening angle
+     * @param theta Opening angle (0 = exact, larger = faster but less accurate)
+     */
+    void setOpeningAngle(double theta);
+
+    /**
+     * Measure the force error of the selected solver against the exact pairwise kernel
+     * for the current planet positions
+     * @return Error report
+     */
+    ForceErrorReport measureForceError();
+
+    /**
+     * Override the planet limits of the force solvers (headless load tests; the display
+     * and the state files of a device session assume the solver limits)
+     * The trail budget grows with the limit up to TrailConstants::MAX_POOL_POINTS, since the
+     * pool is copied into every published snapshot. Every planet gets the same trail length
+     * (shorter past about 7500 planets), so adding planets up to the limit never moves the others' trails.
+     * @param limit Maximum number of planets with any solver (0 = the solver's own, at most PlanetConstants::MAX_LIMIT)
+     */
+    void setPlanetLimit(size_t limit);
+
+    /**
+     * Get the maximum number of planets for the selected force solver (or the overriding limit)
+     * @return Maximum number of planets
+     */
+    size_t getMaxPlanetCount() const;
+
+    /**
+     * Advance the physics simulation by one fixed step
      * @return Whether trail positions were updated
      */
     bool update();
 
+    /**
+     * Get the number of steps simulated so far
+     * @return Number of steps
+     */
+    uint32_t getStepCount() const;
+
+    /**
+     * Merge planets that touch each other (inelastic: momentum is conserved,
+     * masses are combined and colors mixed by mass)
+     */
+    void mergeCollidingPlanets();
+
     /**
      * Remove planets that are out of bounds
      * @param maxX Maximum X coordinate of the screen
@@ -42,6 +211,12 @@ public:
      */
     void removeOutOfBoundsPlanets(int maxX, int maxY);
 
+    /**
+     * Reclaim the trail points of planets removed during this step
+     * (call once at the end of a step; removals themselves are O(1))
+     */
+    void compactPlanets();
+
     /**
      * Get the number of planets
      * @return Number of planets
@@ -49,11 +224,50 @@ public:
     size_t getPlanetCount() const;
 
     /**
-     * Get the collection of planets
-     * @return Collection of planets
+     * Get a view of a planet
+     * @param index Index of the planet
+     * @return Planet view (valid until planets are added or removed)
+     */
+    Planet getPlanet(size_t index) const;
+
+    /**
+     * Find the current index of a planet
+     * @param id Stable ID of the planet
+     * @return Index of the planet, or -1 if it no longer exists
+     */
+    int findPlanet(BodyId id) const;
+
+    /**
+     * Get the hot physics state of all planets
+     * @return Body store
+     */
+    const BodyStore& getBodies() const;
+
+    /**
+     * Get the trail history of all planets
+     * @return Trail history
      */
-    const std::vector<Planet>& getPlanets() const;
+    const TrailPool& getTrails() const;
     
+    /**
+     * Move effects triggered since the last call to a list
+     * @param events List to append the effects to
+     */
+    void takeEvents(std::vector<SimulationEvent>& events);
+
+    /**
+     * Write the simulation state (planets, trails, integrator state, settings) to a state file
+     * @param writer Writer
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Replace the simulation state with one written by saveState
+     * @param reader Reader
+     * @return false if the data is invalid (the engine is then left without planets)
+     */
+    bool loadState(StateReader& reader);
+
     /**
      * Check if there is an active collision effect
      * @return true if there is an active collision effect
@@ -73,20 +287,161 @@ public:
     double getCollisionEffectY() const;
 
 private:
+    friend struct BenchmarkAccess;  // Micro-benchmarks time the private force kernels (tools/Benchmark.cpp)
+
+    /**
+     * Remove a planet from bodies and trails (the last planet takes its index)
+     * @param index Index of the planet to remove
+     */
+    void removePlanet(size_t index);
+
+    /**
+     * Calculate the acceleration of every planet at the current positions
+     * into accelerationX / accelerationY
+     */
+    void calculateAccelerations();
+
+    /**
+     * Calculate the acceleration of the given planets only (all others act as sources)
+     * @param planets Indices of the planets
+     */
+    void calculateAccelerations(const std::vector<int>& planets);
+
+    /**
+     * Choose the block-timestep level of a planet from its acceleration and distance to the sun
+     * @param planetIndex Index of the planet
+     * @return Level (substep = time step / 2^level)
+     */
+    int chooseStepLevel(size_t planetIndex) const;
+
+    /**
+     * Update velocities from the current accelerations: v = v + a * h
+     * @param h Time step of the kick
+     */
+    void kick(Real h);
+
+    /**
+     * Update positions from the current velocities: p = p + v * h
+     * @param h Time step of the drift
+     */
+    void drift(Real h);
+
+    /**
+     * Advance one step with semi-implicit Euler
+     */
+    void integrateSemiImplicitEuler();
+
+    /**
+     * Advance one step with kick-drift-kick leapfrog
+     */
+    void integrateLeapfrog();
+
+    /**
+     * Advance one step with velocity Verlet
+     */
+    void integrateVelocityVerlet();
+
+    /**
+     * Advance one step with the 4th-order Yoshida scheme
+     */
+    void integrateYoshida4();
+
+    /**
+     * Advance one step with block timesteps: each planet kicks on its own power-of-two
+     * substep, all planets drift together between substep boundaries
+     */
+    void integrateBlockLeapfrog();
+
+    /**
+     * Record the current positions in the trail history
+     */
+    void recordTrails();
+
+    /**
+     * Merge planet j into planet i (j is removed by the caller)
+     * @param i Index of the surviving planet
+     * @param j Index of the absorbed planet
+     */
+    void mergePlanets(size_t i, size_t j);
+
+    /**
+     * Queue an effect for the render side
+     * @param type Event type
+     * @param x X position
+     * @param y Y position
+     * @param color Color of the planet involved
+     * @param body ID of the planet involved
+     */
+    void pushEvent(SimulationEventType type, double x, double y, uint16_t color, BodyId body);
+
+    /**
+     * Calculate energy and angular momentum per planet mass
+     * @param energy Total energy (output)
+     * @param angularMomentum Total angular momentum about the sun (output)
+     */
+    void calculateConservedQuantities(double& energy, double& angularMomentum) const;
+
     /**
      * Calculate gravity from the sun
      * @param planetIndex Index of the planet
      * @param ax Array of X components of acceleration
      * @param ay Array of Y components of acceleration
      */
-    void calculateSunGravity(size_t planetIndex, std::vector<double>& ax, std::vector<double>& ay);
+    void calculateSunGravity(size_t planetIndex, std::vector<Real>& ax, std::vector<Real>& ay);
 
     /**
      * Calculate gravity between planets
      * @param ax Array of X components of acceleration
      * @param ay Array of Y components of acceleration
      */
-    void calculatePlanetGravity(std::vector<double>& ax, std::vector<double>& ay);
+    void calculatePlanetGravity(std::vector<Real>& ax, std::vector<Real>& ay);
+
+    /**
+     * Calculate the gravity all other planets exert on a range of planets (one-sided)
+     * @param begin First planet
+     * @param end One past the last planet
+     * @param ax Array of X components of acceleration
+     * @param ay Array of Y components of acceleration
+     */
+    void calculatePlanetGravityRows(size_t begin, size_t end, std::vector<Real>& ax, std::vector<Real>& ay);
+
+    /**
+     * Calculate gravity between planets using the Barnes-Hut quadtree
+     * @param ax Array of X components of acceleration
+     * @param ay Array of Y components of acceleration
+     */
+    void calculatePlanetGravityBarnesHut(std::vector<Real>& ax, std::vector<Real>& ay);
+
+    /**
+     * Calculate gravity between planets using the cell list
+     * @param ax Array of X components of acceleration
+     * @param ay Array of Y components of acceleration
+     */
+    void calculatePlanetGravityCellList(std::vector<Real>& ax, std::vector<Real>& ay);
+
+    /**
+     * Calculate gravity between a pair of planets (skipped beyond the force cutoff)
+     * @param i Index of the first planet
+     * @param j Index of the second planet
+     * @param ax Array of X components of acceleration
+     * @param ay Array of Y components of acceleration
+     */
+    void calculatePairGravity(size_t i, size_t j, std::vector<Real>& ax, std::vector<Real>& ay);
+
+    /**
+     * Calculate gravity between planets with the given solver
+     * @param solver Force solver
+     * @param ax Array of X components of acceleration
+     * @param ay Array of Y components of acceleration
+     */
+    void calculatePlanetGravity(ForceSolver solver, std::vector<Real>& ax, std::vector<Real>& ay);
+
+    /**
+     * Run body over [0, count) in chunks, on the thread pool if one is set
+     * @param count Number of indices
+     * @param body Function called with each chunk's [begin, end)
+     */
+    void forEachChunk(size_t count, const std::function<void(size_t, size_t)>& body);
 
     /**
      * Determine if trail positions need to be updated
@@ -94,18 +449,44 @@ private:
      */
     bool shouldUpdateTrails();
 
-    std::vector<Planet> planets;  // Collection of planets
-    unsigned long lastTrailUpdateTime;  // Timer for trail updates
-    const double distanceScaleSquared;  // Square of distance scale (for optimization)
-    Renderer& renderer;  // Reference to renderer for firework effects
+    BodyStore bodies;  // Hot physics state of planets (structure of arrays)
+    TrailPool trails;  // Past positions of planets (kept apart from the hot state)
+    ForceSolver forceSolver;  // Algorithm for gravity between planets
+    size_t planetLimit;       // Planet limit overriding the solver's (0 = the solver's own)
+    QuadTree quadTree;  // Barnes-Hut quadtree (rebuilt every step)
+    SpatialGrid spatialGrid;  // Cell list (updated incrementally every step)
+    ThreadPool* threadPool;  // Pool for the force passes (nullptr = calling thread only)
+    bool planetsReordered;  // Whether planet indices changed since the last cell-list update
+    SweepAndPrune contactSweep;  // Broadphase for planet contacts
+    bool contactsReordered;  // Whether planet indices changed since the last contact search
+    std::vector<std::pair<int, int>> contacts;  // Touching planet pairs (reused buffer)
+    std::vector<uint8_t> mergeState;  // Per planet: 0 = untouched, 1 = grew this step, 2 = absorbed
+    Integrator integrator;  // Scheme used to advance one step
+    Real timeStep;  // Simulated time per step (base steps)
+    double timeStepValue;  // Simulated time per step as double (for timing)
+    bool accelerationsValid;  // Whether accelerationX/Y match the current positions
+    uint32_t stepCount;  // Number of steps simulated
+    double simulationTime;  // Simulated time in base steps (drives trail and effect timing)
+    uint32_t lastTrailSlot;  // Trail interval of the last recorded trail positions
+    uint32_t forceEvaluationCount;  // Number of planet force evaluations so far
+    std::vector<uint8_t> stepLevels;  // Block-timestep level of each planet
+    std::vector<int> activePlanets;  // Planets ending a substep (reused buffer)
+
+    // Conservation monitor baseline (taken after the planet set changes)
+    bool conservationBaselineValid;  // Whether the baseline matches the current planet set
+    double baselineEnergy;           // Energy at the baseline
+    double baselineAngularMomentum;  // Angular momentum at the baseline
+    uint32_t baselineStep;           // Step count at the baseline
+    uint32_t baselineForceEvaluations;  // Force evaluation count at the baseline
+    std::vector<SimulationEvent> pendingEvents;  // Effects not yet handed to the render side
     
     // Collision effect variables
     bool collisionEffectActive;  // Whether there is an active collision effect
     double collisionEffectX;     // X coordinate of the collision effect
     double collisionEffectY;     // Y coordinate of the collision effect
-    unsigned long collisionEffectStartTime;  // Start time of the collision effect
+    double collisionEffectStartTime;  // Simulated time at which the collision effect started
     
     // Reusable acceleration arrays (for optimization)
-    std::vector<double> accelerationX;
-    std::vector<double> accelerationY;
+    std::vector<Real> accelerationX;
+    std::vector<Real> accelerationY;
 };
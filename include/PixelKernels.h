@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Hal.h"
+#include "Constants.h"
+
+/**
+ * Pixel kernels for the tiny primitives most frames consist of (planet
+ * discs, trail pixels and particles). They write straight into the sprite's
+ * RGB565 buffer instead of going through the canvas's clipping and dispatch
+ * for every call: discs up to MAX_DISC_RADIUS come from span masks computed
+ * once with the same midpoint rule as fillCircle, and each row is one clipped
+ * run. Colors are converted to the canvas byte order once per primitive.
+ * Shapes that are expensive to rasterize but repeat (sun frames, HUD text)
+ * are captured once as stencils and then filled run by run in any color.
+ */
+namespace pixel {
+    /**
+     * Sprite buffer the kernels draw into
+     */
+    struct Target {
+        /**
+         * Constructor
+         * @param canvas Sprite (an unallocated sprite gives an empty target)
+         */
+        explicit Target(hal::Canvas& canvas)
+            : canvas(canvas),
+              pixels(static_cast<uint16_t*>(canvas.getBuffer())),
+              width(pixels != nullptr ? canvas.width() : 0),
+              height(pixels != nullptr ? canvas.height() : 0) {}
+
+        /**
+         * Check whether a pixel lies inside the sprite
+         * @param x X coordinate
+         * @param y Y coordinate
+         * @return true if inside
+         */
+        bool contains(int x, int y) const {
+            return static_cast<unsigned>(x) < static_cast<unsigned>(width) &&
+                   static_cast<unsigned>(y) < static_cast<unsigned>(height);
+        }
+
+        hal::Canvas& canvas;  // Sprite (used for discs larger than the masks)
+        uint16_t* pixels;     // Pixels in canvas byte order (row-major)
+        int width;            // Width (pixels)
+        int height;           // Height (pixels)
+    };
+
+    /**
+     * Horizontal run of a stencil
+     */
+    struct Span {
+        int16_t x;       // Left end (relative to the stencil origin)
+        int16_t y;       // Row (relative to the stencil origin)
+        int16_t length;  // Pixels
+    };
+
+    /**
+     * Pixels of a pre-rendered shape as runs relative to its origin
+     */
+    struct Stencil {
+        /**
+         * Replace the runs with the non-black pixels of a sprite
+         * @param canvas Sprite holding the shape on black
+         * @param originX X coordinate of the origin in the sprite
+         * @param originY Y coordinate of the origin in the sprite
+         */
+        void capture(hal::Canvas& canvas, int originX, int originY);
+
+        std::vector<Span> spans;  // Runs (top to bottom, left to right)
+    };
+
+    /**
+     * Saturating per-channel sum of two RGB565 colors
+     * @param a First color
+     * @param b Second color
+     * @return Sum
+     */
+    inline uint16_t addColors(uint16_t a, uint16_t b) {
+        // Spread green into the upper half so every channel has headroom for its carry
+        uint32_t sum = ((a | (uint32_t(a) << 16)) & 0x07E0F81Fu) + ((b | (uint32_t(b) << 16)) & 0x07E0F81Fu);
+
+        // Channels that overflowed are filled with ones (carries at bits 5, 16 and 27)
+        uint32_t redBlue = sum & 0x00010020u;
+        uint32_t green = sum & 0x08000000u;
+        sum = (sum | (redBlue - (redBlue >> 5)) | (green - (green >> 6))) & 0x07E0F81Fu;
+        return static_cast<uint16_t>(sum | (sum >> 16));
+    }
+
+    /**
+     * Write one pixel (clipped)
+     * @param target Sprite buffer
+     * @param x X coordinate
+     * @param y Y coordinate
+     * @param color RGB565 color
+     */
+    inline void drawPixel(Target& target, int x, int y, uint16_t color) {
+        if (target.contains(x, y)) {
+            target.pixels[y * target.width + x] = hal::toCanvasColor(color);
+        }
+    }
+
+    /**
+     * Add a color to one pixel (clipped, saturating per channel)
+     * @param target Sprite buffer
+     * @param x X coordinate
+     * @param y Y coordinate
+     * @param color RGB565 color
+     */
+    inline void addPixel(Target& target, int x, int y, uint16_t color) {
+        if (target.contains(x, y)) {
+            uint16_t& pixel = target.pixels[y * target.width + x];
+            pixel = hal::toCanvasColor(addColors(hal::fromCanvasColor(pixel), color));
+        }
+    }
+
+    /**
+     * Fill a disc (the pixels fillCircle would set)
+     * @param target Sprite buffer
+     * @param x Center X coordinate
+     * @param y Center Y coordinate
+     * @param radius Radius (pixels)
+     * @param color RGB565 color
+     */
+    void fillDisc(Target& target, int x, int y, int radius, uint16_t color);
+
+    /**
+     * Add a color to every pixel of a disc (saturating per channel)
+     * @param target Sprite buffer
+     * @param x Center X coordinate
+     * @param y Center Y coordinate
+     * @param radius Radius (pixels, at most MAX_DISC_RADIUS)
+     * @param color RGB565 color
+     */
+    void addDisc(Target& target, int x, int y, int radius, uint16_t color);
+
+    /**
+     * Fill every pixel of a stencil (clipped)
+     * @param target Sprite buffer
+     * @param stencil Stencil
+     * @param x X coordinate of the stencil origin
+     * @param y Y coordinate of the stencil origin
+     * @param color RGB565 color
+     */
+    void fillStencil(Target& target, const Stencil& stencil, int x, int y, uint16_t color);
+}
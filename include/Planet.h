@@ -1,39 +1,33 @@
 #pragma once
 
-#include <M5Unified.h>
+#include "Hal.h"
 #include "Constants.h"
+#include "BodyStore.h"
+#include "TrailPool.h"
+#include "Random.h"
 
 /**
  * Planet Class
- * Manages the physical properties and rendering information of planets
+ * Lightweight view of one planet stored in a BodyStore and TrailPool
  */
 class Planet {
 public:
     /**
      * Constructor
-     * @param x Initial X coordinate
-     * @param y Initial Y coordinate
-     * @param vx Initial X velocity
-     * @param vy Initial Y velocity
-     * @param color Planet color
+     * @param bodies Body store holding the planet
+     * @param trails Trail history of the planet
+     * @param index Index of the planet
      */
-    Planet(double x, double y, double vx, double vy, uint16_t color);
-
-    /**
-     * Update planet position
-     * @param ax Acceleration in X direction
-     * @param ay Acceleration in Y direction
-     * @param updateTrails Whether to update trail positions
-     */
-    void update(double ax, double ay, bool updateTrails);
+    Planet(const BodyStore& bodies, const TrailPool& trails, size_t index);
 
     /**
      * Draw the planet
      * @param canvas Canvas to draw on
      * @param centerX X coordinate of screen center
      * @param centerY Y coordinate of screen center
+     * @param alpha Interpolation factor between the previous and current position (0-1)
      */
-    void draw(M5Canvas& canvas, int centerX, int centerY) const;
+    void draw(hal::Canvas& canvas, int centerX, int centerY, float alpha = 1.0f) const;
 
     /**
      * Draw the trail
@@ -41,7 +35,16 @@ public:
      * @param centerX X coordinate of screen center
      * @param centerY Y coordinate of screen center
      */
-    void drawTrail(M5Canvas& canvas, int centerX, int centerY) const;
+    void drawTrail(hal::Canvas& canvas, int centerX, int centerY) const;
+
+    /**
+     * Get the bounding box of the trail (relative to the screen center)
+     * @param left Leftmost X coordinate (output)
+     * @param top Topmost Y coordinate (output)
+     * @param right Rightmost X coordinate (output)
+     * @param bottom Bottommost Y coordinate (output)
+     */
+    void getTrailBounds(int& left, int& top, int& right, int& bottom) const;
 
     /**
      * Determine if the planet is out of bounds
@@ -57,18 +60,46 @@ public:
      */
     bool isCollidedWithSun() const;
 
-    // Getters for position and velocity
-    double getX() const { return x; }
-    double getY() const { return y; }
-    double getVx() const { return vx; }
-    double getVy() const { return vy; }
-    uint16_t getColor() const { return color; }
+    // Getters for position, velocity and identity (pixels and pixels per step)
+    double getX() const { return toDouble(bodies.x[index]); }
+    double getY() const { return toDouble(bodies.y[index]); }
+    double getVx() const { return toDouble(bodies.vx[index]); }
+    double getVy() const { return toDouble(bodies.vy[index]); }
+    uint16_t getColor() const { return bodies.color[index]; }
+    float getRadius() const { return bodies.radius[index]; }
+    BodyId getId() const { return bodies.id[index]; }
+    double getMass() const { return toDouble(bodies.gm[index]) / StepUnits::GRAVITY; }
+
+    /**
+     * Get the position interpolated between the previous and current step
+     * @param alpha Interpolation factor (0 = previous, 1 = current)
+     * @param x Interpolated X coordinate (output)
+     * @param y Interpolated Y coordinate (output)
+     */
+    void getInterpolatedPosition(float alpha, double& x, double& y) const;
     
     /**
      * Generate a random vibrant color
+     * @param random Random number generator
      * @return Generated color
      */
-    static uint16_t randomPastelColor();
+    static uint16_t randomPastelColor(Random& random);
+
+    /**
+     * Calculate the radius of a planet from its mass (constant density, capped at MAX_RADIUS)
+     * @param gm G * M of the planet (pixels^3 per step^2)
+     * @return Radius (pixels)
+     */
+    static float radiusFor(double gm);
+
+    /**
+     * Mix two colors (per RGB565 channel)
+     * @param a First color
+     * @param b Second color
+     * @param weightB Weight of the second color (0-1)
+     * @return Mixed color
+     */
+    static uint16_t mixColors(uint16_t a, uint16_t b, float weightB);
 
 private:
     /**
@@ -78,14 +109,9 @@ private:
      * @param alpha Alpha value (0-255)
      * @return Blended color
      */
-    uint16_t alphaBlend(uint16_t fg, uint16_t bg, uint8_t alpha) const;
+    static uint16_t alphaBlend(uint16_t fg, uint16_t bg, uint8_t alpha);
 
-    double x, y;       // Position
-    double vx, vy;     // Velocity
-    uint16_t color;    // Color
-    
-    // Past positions (for trail effect) - using ring buffer
-    int trailX[PlanetConstants::TRAIL_LENGTH];
-    int trailY[PlanetConstants::TRAIL_LENGTH];
-    int trailIndex;    // Ring buffer index for optimization
+    const BodyStore& bodies;     // Hot physics state
+    const TrailPool& trails;  // Past positions (for trail effect)
+    size_t index;                // Index of the planet
 };
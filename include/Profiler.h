@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "Constants.h"
+
+/**
+ * Stages of the render loop and the physics task that are timed
+ */
+enum class ProfileStage : uint8_t {
+    INPUT,     // hal::update (buttons and touch panel polling)
+    TOUCH,     // TouchHandler::update
+    SNAPSHOT,  // Snapshot acquisition and effect events
+    DRAW,      // Canvas drawing
+    PUSH,      // Dirty-rectangle transfer to the display
+    SAVE,      // StateFile::save (including the wait for the physics task to pause)
+    TELEMETRY, // Telemetry::update (encoding and queueing a frame)
+    FRAME,     // Render-loop work of a drawn frame (the jobs run since the previous one)
+    PHYSICS,   // PhysicsEngine::update (physics task)
+    MERGE,     // PhysicsEngine::mergeCollidingPlanets (physics task)
+    CULL,      // Out-of-bounds removal and trail compaction (physics task)
+    COUNT
+};
+
+/**
+ * Summary of the recent samples of a stage (microseconds)
+ */
+struct ProfileStats {
+    uint32_t samples;  // Number of samples summarized (at most HISTORY_SIZE)
+    uint32_t min;      // Fastest sample
+    uint32_t p50;      // Median
+    uint32_t p99;      // 99th percentile
+    uint32_t max;      // Slowest sample
+};
+
+/**
+ * Profiler Class
+ * Per-stage timings in fixed-size ring buffers (the last HISTORY_SIZE samples
+ * of each stage), summarized on demand as min/p50/p99/max. Each stage has a
+ * single writer (the render loop or the physics task), so recording is
+ * lock-free. A drawn frame slower than SLOW_FRAME_MICROS is blamed on the
+ * render-loop stage that took longest in it.
+ */
+class Profiler {
+public:
+    /**
+     * Constructor
+     */
+    Profiler();
+
+    /**
+     * Record one sample (from the task that owns the stage)
+     * @param stage Stage
+     * @param micros Duration (microseconds)
+     */
+    void record(ProfileStage stage, uint32_t micros);
+
+    /**
+     * Close a render loop iteration (render loop only)
+     * @param drawn Whether the iteration drew a frame (others are not counted as frames)
+     */
+    void endFrame(bool drawn);
+
+    /**
+     * Summarize the recent samples of a stage
+     * @param stage Stage
+     * @return Statistics (all zero if there are no samples)
+     */
+    ProfileStats getStats(ProfileStage stage) const;
+
+    /**
+     * Get the number of drawn frames slower than the budget
+     * @return Number of slow frames
+     */
+    uint32_t getSlowFrameCount() const;
+
+    /**
+     * Get the stage blamed for the last slow frame
+     * @return Stage (COUNT if no frame was slow yet)
+     */
+    ProfileStage getLastSlowStage() const;
+
+    /**
+     * Show or hide the on-screen overlay
+     */
+    void toggleOverlay();
+
+    /**
+     * Check whether the on-screen overlay is shown
+     * @return true if shown
+     */
+    bool isOverlayVisible() const;
+
+    /**
+     * Write a table of every stage to the serial port (stdout on host)
+     */
+    void dump() const;
+
+    /**
+     * Get the display name of a stage
+     * @param stage Stage
+     * @return Name
+     */
+    static const char* getStageName(ProfileStage stage);
+
+private:
+    static constexpr int STAGE_COUNT = static_cast<int>(ProfileStage::COUNT);
+    static constexpr uint32_t HISTORY_SIZE = ProfilerConstants::HISTORY_SIZE;
+
+    /**
+     * Ring buffer of the recent samples of one stage
+     */
+    struct History {
+        std::atomic<uint32_t> samples[HISTORY_SIZE];  // Durations (microseconds)
+        std::atomic<uint32_t> count;                  // Samples recorded so far (next slot = count % HISTORY_SIZE)
+    };
+
+    /**
+     * Check whether a stage runs on the render loop (and counts toward the frame time)
+     * @param stage Stage
+     * @return true for render-loop stages
+     */
+    static bool isFrameStage(ProfileStage stage);
+
+    History histories[STAGE_COUNT];      // Recent samples per stage
+    uint32_t frameMicros[STAGE_COUNT];   // Time per render-loop stage in the current iteration (render loop only)
+    std::atomic<uint32_t> slowFrames;    // Drawn frames over the budget
+    std::atomic<uint8_t> lastSlowStage;  // Stage blamed for the last slow frame
+    std::atomic<uint32_t> slowCounts[STAGE_COUNT];  // Slow frames blamed on each stage
+    bool overlayVisible;                 // Whether the overlay is drawn
+};
+
+/**
+ * Scoped timer: records the time from construction to end() or destruction
+ */
+class ProfileScope {
+public:
+    /**
+     * Start timing
+     * @param profiler Profiler (nullptr disables timing)
+     * @param stage Stage
+     */
+    ProfileScope(Profiler* profiler, ProfileStage stage);
+
+    /**
+     * Record the sample unless end() already did
+     */
+    ~ProfileScope();
+
+    /**
+     * Record the sample now (later calls and the destructor do nothing)
+     */
+    void end();
+
+private:
+    Profiler* profiler;  // Profiler (nullptr once recorded)
+    ProfileStage stage;  // Stage
+    uint32_t start;      // Start time (microseconds)
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include "BodyStore.h"
+#include "Constants.h"
+
+/**
+ * QuadTree Class
+ * Barnes-Hut quadtree for approximating gravity between planets
+ */
+class QuadTree {
+public:
+    /**
+     * Constructor
+     */
+    QuadTree();
+
+    /**
+     * Set the opening angle
+     * @param theta Opening angle (0 = exact, larger = faster but less accurate)
+     */
+    void setOpeningAngle(double theta);
+
+    /**
+     * Get the opening angle
+     * @return Opening angle
+     */
+    double getOpeningAngle() const;
+
+    /**
+     * Rebuild the tree from planet positions
+     * @param bodies Body store of planets
+     */
+    void build(const BodyStore& bodies);
+
+    /**
+     * Accumulate gravity from other planets acting on a planet (pixels per step^2)
+     * @param planetIndex Index of the planet (as passed to build)
+     * @param ax X component of acceleration (accumulated)
+     * @param ay Y component of acceleration (accumulated)
+     */
+    void calculateAcceleration(size_t planetIndex, double& ax, double& ay) const;
+
+    /**
+     * Get the number of nodes in the tree
+     * @return Number of nodes
+     */
+    size_t getNodeCount() const;
+
+private:
+    /**
+     * Tree node (leaf if firstChild < 0)
+     */
+    struct Node {
+        double centerX, centerY;  // Center of the square cell
+        double halfSize;          // Half of the cell width
+        double mass;              // Total G * M in the cell
+        double massX, massY;      // Center of mass
+        int firstChild;           // Index of the first of 4 children (-1 for leaf)
+        int body;                 // First body in the leaf (-1 if empty)
+    };
+
+    /**
+     * Append a new empty node
+     * @param centerX X coordinate of cell center
+     * @param centerY Y coordinate of cell center
+     * @param halfSize Half of the cell width
+     * @return Index of the new node
+     */
+    int createNode(double centerX, double centerY, double halfSize);
+
+    /**
+     * Insert a body into the subtree
+     * @param nodeIndex Index of the subtree root
+     * @param body Index of the body
+     * @param depth Depth of the subtree root
+     */
+    void insert(int nodeIndex, int body, int depth);
+
+    /**
+     * Get the child index covering a position
+     * @param node Internal node
+     * @param x X coordinate
+     * @param y Y coordinate
+     * @return Index of the child node
+     */
+    int childFor(const Node& node, double x, double y) const;
+
+    /**
+     * Compute mass and center of mass of every node (children before parents)
+     */
+    void computeMassDistribution();
+
+    std::vector<Node> nodes;       // Node pool (index 0 is the root)
+    std::vector<double> bodyX;     // X coordinates of bodies
+    std::vector<double> bodyY;     // Y coordinates of bodies
+    std::vector<double> bodyMass;  // G * M of bodies
+    std::vector<int> nextBody;     // Next body in the same leaf (-1 for none)
+    double openingAngle;           // Opening angle
+    double openingAngleSquared;    // Square of the opening angle (for optimization)
+};
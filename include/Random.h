@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Random Class
+ * Small seedable generator (xorshift32) for randomness that has to replay
+ * exactly. Its whole state is one word, and it is independent of hal::random,
+ * whose sequence depends on how many frames have been drawn.
+ */
+class Random {
+public:
+    /**
+     * Constructor
+     * @param seed Seed
+     */
+    explicit Random(uint32_t seed = 1);
+
+    /**
+     * Restart the sequence
+     * @param seed Seed (any value, including 0)
+     */
+    void seed(uint32_t seed);
+
+    /**
+     * Get a random number in [0, max) (same contract as hal::random)
+     * @param max Upper bound (exclusive)
+     * @return Random number (0 if max is not positive)
+     */
+    long next(long max);
+
+    /**
+     * Get the generator state (to save and restore the sequence)
+     * @return State
+     */
+    uint32_t getState() const;
+
+    /**
+     * Continue from a saved state
+     * @param state State returned by getState
+     */
+    void setState(uint32_t state);
+
+private:
+    uint32_t state;  // xorshift32 state (never 0)
+};
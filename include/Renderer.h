@@ -1,35 +1,38 @@
 #pragma once
 
-#include <M5Unified.h>
-#include <M5GFX.h>
-#include "PhysicsEngine.h"
+#include "Hal.h"
+#include "SimulationSnapshot.h"
 #include "Sun.h"
+#include "DirtyRegion.h"
+#include "Profiler.h"
+#include "ParticleSystem.h"
+#include "DisplayTransport.h"
+#include "PixelKernels.h"
 
-/**
- * Particle structure for firework effects
- */
-struct Particle {
-    double x;              // X position (relative to center)
-    double y;              // Y position (relative to center)
-    double vx;             // X velocity
-    double vy;             // Y velocity
-    uint16_t color;        // Particle color
-    int lifetime;          // Remaining lifetime (frames)
-    int initialLifetime;   // Initial lifetime (for alpha calculation)
-};
+class StateWriter;
+class StateReader;
 
 /**
  * Ripple structure for planet creation effect
  */
 struct Ripple {
-    double x;              // X position (relative to center)
-    double y;              // Y position (relative to center)
-    double radius;         // Current radius (pixels)
+    float x;               // X position (relative to center)
+    float y;               // Y position (relative to center)
+    float radius;          // Current radius (pixels)
     uint16_t color;        // Ripple color
     int lifetime;          // Remaining lifetime (frames)
     int initialLifetime;   // Initial lifetime (for alpha calculation)
 };
 
+/**
+ * HUD text line rasterized once per distinct value
+ */
+struct CachedText {
+    char text[48];           // Text the stencil shows
+    pixel::Stencil stencil;  // Glyph pixels (relative to the top-left corner)
+    int width;               // Text width (pixels)
+};
+
 /**
  * Renderer Class
  * Handles rendering-related processes
@@ -39,8 +42,9 @@ public:
     /**
      * Constructor
      * @param display Display object
+     * @param profiler Profiler timing the drawing and push, and shown as an overlay (nullptr disables both)
      */
-    Renderer(M5GFX& display);
+    Renderer(hal::Display& display, Profiler* profiler = nullptr);
 
     /**
      * Initialize
@@ -48,14 +52,27 @@ public:
     void init();
 
     /**
-     * Render planets and sun
-     * @param physicsEngine Physics engine
+     * Render planets and sun (called every DRAW_INTERVAL by the frame scheduler)
+     * @param snapshot Simulation snapshot
      * @param isTouching Whether touch is active
      * @param touchStartX Touch start X coordinate
      * @param touchStartY Touch start Y coordinate
+     * @param touchX Current touch X coordinate (end of the drag arrow)
+     * @param touchY Current touch Y coordinate (end of the drag arrow)
+     */
+    void render(const SimulationSnapshot& snapshot, 
+                bool isTouching, int touchStartX, int touchStartY, int touchX, int touchY);
+
+    /**
+     * Change the sun's brightness (called every COLOR_UPDATE_INTERVAL by the frame scheduler)
      */
-    void render(const PhysicsEngine& physicsEngine, 
-                bool isTouching, int touchStartX, int touchStartY);
+    void updateSunColor();
+
+    /**
+     * Start effects triggered by the physics simulation
+     * @param events Effects from a newly acquired snapshot
+     */
+    void handleEvents(const std::vector<SimulationEvent>& events);
 
     /**
      * Create firework effect at specified position
@@ -73,6 +90,36 @@ public:
      */
     void createRipple(double x, double y, uint16_t color);
 
+    /**
+     * Write the running effects (particles and ripples) to a state file
+     * @param writer Writer
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Replace the running effects with ones written by saveState (the next frame redraws the screen)
+     * @param reader Reader
+     * @return false if the data is invalid (no effects are then running)
+     */
+    bool loadState(StateReader& reader);
+
+    /**
+     * Get the number of bytes transmitted to the display by the last frame
+     * @return Bytes pushed
+     */
+    uint32_t getPushedBytes() const;
+
+    /**
+     * Wait until the last frame has reached the display
+     */
+    void flush();
+
+    /**
+     * Get the transport pushing frames to the display (for its statistics)
+     * @return Display transport
+     */
+    const DisplayTransport& getTransport() const { return transport; }
+
     /**
      * Get X coordinate of screen center
      * @return X coordinate of screen center
@@ -98,22 +145,77 @@ public:
     int getMaxBoundsY() const;
 
 private:
-    M5GFX& display;  // Display object
-    M5Canvas canvas;  // Canvas for drawing (initialized in constructor)
+    friend struct BenchmarkAccess;  // Micro-benchmarks time the private drawing passes (tools/Benchmark.cpp)
+
+    static constexpr int HUD_X = 10;  // X coordinate of the planet count text
+    static constexpr int HUD_Y = 10;  // Y coordinate of the planet count text
+    static constexpr int PROFILER_LINE_SPACING = 2;  // Gap between profiler overlay lines (pixels)
+    // HUD lines: planet count, profiler header, one per stage and slow frames
+    static constexpr int HUD_LINES = static_cast<int>(ProfileStage::COUNT) + 3;
+
+    hal::Display& display;  // Display object
+    Profiler* profiler;  // Profiler (may be nullptr)
+    DisplayTransport transport;  // Sends finished frames to the display in the background
+    hal::Canvas firstCanvas;   // Sprites drawn into in turn (initialized in constructor)
+    hal::Canvas secondCanvas;
+    hal::Canvas* canvas;       // Sprite the current frame is drawn into
+    hal::Canvas* spareCanvas;  // Sprite of the previous frame, possibly still being sent (nullptr if single-buffered)
+    hal::Canvas textCanvas;    // Scratch sprite HUD text is rasterized into
+    CachedText hudText[HUD_LINES];  // HUD lines as drawn last
     Sun sun;  // Sun object
     int centerX, centerY;  // Center coordinates of display
-    unsigned long lastDrawTime;  // Timer for drawing
+    
+    // Dirty-rectangle tracking (only areas drawn last frame or this frame are cleared and pushed)
+    DirtyRegion drawnRegion;     // Areas drawn in the current frame
+    DirtyRegion previousRegion;  // Areas drawn in the previous frame (what the display shows)
+    DirtyRegion pushRegion;      // Areas transmitted to the display
+    DirtyRegion canvasRegion;    // Areas drawn the last time into the current sprite
+    DirtyRegion spareRegion;     // Areas drawn the last time into the spare sprite
+    bool canvasStale;            // Whether the current sprite must be cleared completely
+    bool spareStale;             // Whether the spare sprite must be cleared completely
+    bool fullRedraw;             // Whether the whole screen must be pushed (first frame)
+    uint32_t pushedBytes;        // Bytes transmitted by the last frame
     
     // Firework particles
-    static constexpr int MAX_PARTICLES = FireworkConstants::MAX_EFFECTS * FireworkConstants::PARTICLE_COUNT;
-    Particle particles[MAX_PARTICLES];
-    int particleCount;
+    ParticleSystem particles;
 
     // Ripple effects
     static constexpr int MAX_RIPPLES = RippleConstants::MAX_RIPPLES;
     Ripple ripples[MAX_RIPPLES];
     int rippleCount;
 
+    /**
+     * Calculate the interpolation factor for drawing a snapshot now
+     * @param snapshot Simulation snapshot
+     * @return Factor between the previous and current step (0-1)
+     */
+    float calculateInterpolation(const SimulationSnapshot& snapshot) const;
+
+    /**
+     * Erase everything the current sprite holds from the last frame drawn into it
+     */
+    void clearPreviousFrame();
+
+    /**
+     * Start transmitting the areas drawn in the previous or current frame to the display,
+     * then switch to the other sprite
+     */
+    void pushDirtyRegion();
+
+    /**
+     * Draw the profiler statistics below the planet count
+     */
+    void drawProfilerOverlay();
+
+    /**
+     * Draw a HUD line, rasterizing its glyphs only if the text changed since the line was last drawn
+     * @param line HUD line (index into hudText)
+     * @param x Left edge
+     * @param y Top edge
+     * @param text Text
+     */
+    void drawText(int line, int x, int y, const char* text);
+
     /**
      * Alpha blend a color with black background
      * @param fg Foreground color
@@ -123,12 +225,7 @@ private:
     uint16_t alphaBlend(uint16_t fg, uint8_t alpha) const;
 
     /**
-     * Update firework particles
-     */
-    void updateParticles();
-
-    /**
-     * Draw firework particles
+     * Draw firework particles and advance them one frame
      */
     void drawParticles();
 
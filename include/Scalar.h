@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+/**
+ * Fixed-point number with FRAC_BITS fractional bits in 32-bit storage
+ * (products and quotients use 64-bit intermediates and round to nearest)
+ */
+template <int FRAC_BITS>
+class Fixed {
+public:
+    static constexpr int FRACTION_BITS = FRAC_BITS;
+    static constexpr int64_t ONE = int64_t(1) << FRAC_BITS;
+
+    constexpr Fixed() : raw(0) {}
+    constexpr Fixed(double value)
+        : raw(static_cast<int32_t>(value >= 0 ? value * ONE + 0.5 : value * ONE - 0.5)) {}
+
+    /**
+     * Create from a raw fixed-point value
+     * @param raw Raw value (value * 2^FRAC_BITS)
+     * @return Fixed-point number
+     */
+    static constexpr Fixed fromRaw(int32_t raw) {
+        Fixed f;
+        f.raw = raw;
+        return f;
+    }
+
+    /**
+     * Divide rounding to nearest (symmetric for negative values)
+     * @param numerator Numerator
+     * @param denominator Denominator (must be positive)
+     * @return Rounded quotient
+     */
+    static int64_t roundedDivide(int64_t numerator, int64_t denominator) {
+        return numerator >= 0 ? (numerator + denominator / 2) / denominator
+                              : -((-numerator + denominator / 2) / denominator);
+    }
+
+    int32_t getRaw() const { return raw; }
+    double toDouble() const { return static_cast<double>(raw) / ONE; }
+    int toInt() const { return raw >> FRAC_BITS; }
+
+    Fixed operator+(Fixed o) const { return fromRaw(raw + o.raw); }
+    Fixed operator-(Fixed o) const { return fromRaw(raw - o.raw); }
+    Fixed operator-() const { return fromRaw(-raw); }
+    Fixed operator*(Fixed o) const {
+        int64_t product = static_cast<int64_t>(raw) * o.raw;
+        return fromRaw(static_cast<int32_t>((product + (ONE >> 1)) >> FRAC_BITS));
+    }
+    Fixed operator/(Fixed o) const {
+        int64_t numerator = static_cast<int64_t>(raw) << FRAC_BITS;
+        int64_t denominator = o.raw;
+        if (denominator < 0) {
+            numerator = -numerator;
+            denominator = -denominator;
+        }
+        return fromRaw(static_cast<int32_t>(roundedDivide(numerator, denominator)));
+    }
+    Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+    Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+    Fixed& operator*=(Fixed o) { return *this = *this * o; }
+
+    bool operator<(Fixed o) const { return raw < o.raw; }
+    bool operator>(Fixed o) const { return raw > o.raw; }
+    bool operator<=(Fixed o) const { return raw <= o.raw; }
+    bool operator>=(Fixed o) const { return raw >= o.raw; }
+    bool operator==(Fixed o) const { return raw == o.raw; }
+    bool operator!=(Fixed o) const { return raw != o.raw; }
+
+private:
+    int32_t raw;  // value * 2^FRAC_BITS
+};
+
+// Q16.16 format
+using Q16_16 = Fixed<16>;
+
+// Q10.22 format used by the engine's fixed-point mode: positions stay within
+// +-512 pixels, and the extra fraction bits keep sun acceleration at the force
+// cutoff (about 9e-7 pixels per step^2) representable, which Q16.16 rounds to 0
+using Q10_22 = Fixed<22>;
+
+// Conversions between scalar types
+inline double toDouble(double value) { return value; }
+inline double toDouble(float value) { return value; }
+template <int FRAC_BITS>
+inline double toDouble(Fixed<FRAC_BITS> value) { return value.toDouble(); }
+
+inline int toInt(double value) { return static_cast<int>(value); }
+inline int toInt(float value) { return static_cast<int>(value); }
+template <int FRAC_BITS>
+inline int toInt(Fixed<FRAC_BITS> value) {
+    // Truncate towards zero like the floating-point conversions
+    int32_t raw = value.getRaw();
+    return raw >= 0 ? (raw >> FRAC_BITS) : -((-raw) >> FRAC_BITS);
+}
+
+// Scalar type used by the physics engine (select with a build flag), and its ID in
+// state files and input logs
+#if defined(GRAVSIM_SCALAR_FIXED)
+using Real = Q10_22;
+constexpr uint8_t REAL_TYPE_ID = 2;
+#elif defined(GRAVSIM_SCALAR_FLOAT)
+using Real = float;
+constexpr uint8_t REAL_TYPE_ID = 1;
+#else
+using Real = double;
+constexpr uint8_t REAL_TYPE_ID = 0;
+#endif
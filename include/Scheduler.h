@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include "Hal.h"
+#include "Constants.h"
+
+/**
+ * Statistics of a scheduled job
+ */
+struct JobStats {
+    uint32_t runs;             // Times the job ran
+    uint32_t lateRuns;         // Runs that started more than LATE_TOLERANCE after their deadline
+    uint32_t skippedPeriods;   // Deadlines dropped because a run started at or after them
+    uint32_t maxLateMicros;    // Worst start delay after a deadline (microseconds)
+};
+
+/**
+ * Scheduler Class
+ * Runs the periodic jobs of the render loop from one place. Every job has a
+ * period, a priority and a next deadline; each pass runs the due jobs, most
+ * urgent first, and then sleeps until the earliest deadline (vTaskDelayUntil
+ * on device), so the loop no longer spins and the time it sleeps is measured
+ * as idle time. Deadlines advance by whole periods, so a job keeps its cadence
+ * after a late run; one that falls a whole period or more behind drops the
+ * deadlines it passed instead of running back to back. The clock and the
+ * sleep are injectable so the scheduler can be driven by a simulated clock.
+ */
+class Scheduler {
+public:
+    typedef std::function<void()> Job;   // Work of a job
+    typedef uint32_t (*Clock)();         // Current time (microseconds)
+    typedef void (*Sleep)(uint32_t);     // Sleep until a time (microseconds)
+
+    /**
+     * Constructor
+     * @param clock Current time
+     * @param sleep Sleep until a time
+     */
+    Scheduler(Clock clock = hal::micros, Sleep sleep = hal::sleepUntil);
+
+    /**
+     * Add a job (first due right away)
+     * @param name Name shown in the statistics (not copied)
+     * @param periodMicros Period (0 runs the job on every pass and keeps the loop from sleeping)
+     * @param priority Priority (higher runs first when several jobs are due)
+     * @param job Work of the job
+     * @return Job ID (-1 if MAX_JOBS jobs already exist)
+     */
+    int add(const char* name, uint32_t periodMicros, int priority, Job job);
+
+    /**
+     * Change the period of a job (takes effect from its next deadline)
+     * @param id Job ID
+     * @param periodMicros Period
+     */
+    void setPeriod(int id, uint32_t periodMicros);
+
+    /**
+     * Move the next deadline of a job one period from now (after it ran out of turn)
+     * @param id Job ID
+     */
+    void restart(int id);
+
+    /**
+     * Run the due jobs (each at most once), then sleep until the next deadline
+     */
+    void runOnce();
+
+    /**
+     * Get the statistics of a job
+     * @param id Job ID
+     * @return Statistics
+     */
+    const JobStats& getStats(int id) const { return jobs[id].stats; }
+
+    /**
+     * Get the time spent sleeping so far
+     * @return Microseconds
+     */
+    uint64_t getIdleMicros() const { return idleMicros; }
+
+    /**
+     * Get the time since the first job was added
+     * @return Microseconds
+     */
+    uint64_t getElapsedMicros() const { return elapsedMicros; }
+
+    /**
+     * Print the statistics of every job and the idle time over serial
+     */
+    void dump() const;
+
+private:
+    static constexpr int MAX_JOBS = SchedulerConstants::MAX_JOBS;
+
+    /**
+     * A periodic job
+     */
+    struct Entry {
+        const char* name;     // Name shown in the statistics
+        uint32_t period;      // Period (microseconds)
+        int priority;         // Priority (higher runs first)
+        uint32_t deadline;    // Next deadline (microseconds)
+        Job job;              // Work
+        JobStats stats;       // Statistics
+    };
+
+    /**
+     * Run a due job and move its deadline on
+     * @param entry Job
+     * @param now Current time
+     */
+    void run(Entry& entry, uint32_t now);
+
+    /**
+     * Add the time since the last call to the elapsed time
+     * @param now Current time
+     */
+    void tally(uint32_t now);
+
+    Clock clock;            // Current time
+    Sleep sleep;            // Sleep until a time
+    Entry jobs[MAX_JOBS];   // Jobs
+    int jobCount;           // Number of jobs
+    uint64_t idleMicros;    // Time spent sleeping
+    uint64_t elapsedMicros; // Time since the first job was added
+    uint32_t lastTally;     // Time elapsedMicros was last updated
+};
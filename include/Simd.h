@@ -0,0 +1,134 @@
+#pragma once
+
+/**
+ * Small portable SIMD wrapper for host builds on x86
+ * Each vector type offers the same static interface (load, broadcast,
+ * arithmetic, max, a comparison mask, an approximate reciprocal square root
+ * and a horizontal sum), so kernels are written once as templates over the
+ * vector type. SSE2 types are always available on x86-64; AVX2 types are
+ * compiled for AVX2 per function (GRAVSIM_TARGET_AVX2) and must only be used
+ * after checking the CPU at run time.
+ */
+#if !defined(ARDUINO) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__)
+#define GRAVSIM_SIMD_X86 1
+#include <immintrin.h>
+
+// Compile a function for AVX2 regardless of the build flags
+#define GRAVSIM_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace simd {
+    /**
+     * 4 floats (SSE2)
+     */
+    struct Vec4f {
+        typedef float Scalar;
+        static constexpr int WIDTH = 4;
+        static constexpr int NEWTON_STEPS = 1;  // Refinements of rsqrtEstimate for full precision
+        __m128 v;
+
+        static Vec4f load(const float* p) { return {_mm_loadu_ps(p)}; }
+        static Vec4f broadcast(float value) { return {_mm_set1_ps(value)}; }
+        friend Vec4f operator+(Vec4f a, Vec4f b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend Vec4f operator-(Vec4f a, Vec4f b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend Vec4f operator*(Vec4f a, Vec4f b) { return {_mm_mul_ps(a.v, b.v)}; }
+        static Vec4f max(Vec4f a, Vec4f b) { return {_mm_max_ps(a.v, b.v)}; }
+        static Vec4f lessEqual(Vec4f a, Vec4f b) { return {_mm_cmple_ps(a.v, b.v)}; }  // All ones where a <= b
+        static Vec4f select(Vec4f mask, Vec4f a) { return {_mm_and_ps(mask.v, a.v)}; }  // a where mask, else 0
+        static Vec4f rsqrtEstimate(Vec4f a) { return {_mm_rsqrt_ps(a.v)}; }  // About 12 bits
+        float sum() const {
+            __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+    };
+
+    /**
+     * 2 doubles (SSE2)
+     */
+    struct Vec2d {
+        typedef double Scalar;
+        static constexpr int WIDTH = 2;
+        static constexpr int NEWTON_STEPS = 2;
+        __m128d v;
+
+        static Vec2d load(const double* p) { return {_mm_loadu_pd(p)}; }
+        static Vec2d broadcast(double value) { return {_mm_set1_pd(value)}; }
+        friend Vec2d operator+(Vec2d a, Vec2d b) { return {_mm_add_pd(a.v, b.v)}; }
+        friend Vec2d operator-(Vec2d a, Vec2d b) { return {_mm_sub_pd(a.v, b.v)}; }
+        friend Vec2d operator*(Vec2d a, Vec2d b) { return {_mm_mul_pd(a.v, b.v)}; }
+        static Vec2d max(Vec2d a, Vec2d b) { return {_mm_max_pd(a.v, b.v)}; }
+        static Vec2d lessEqual(Vec2d a, Vec2d b) { return {_mm_cmple_pd(a.v, b.v)}; }
+        static Vec2d select(Vec2d mask, Vec2d a) { return {_mm_and_pd(mask.v, a.v)}; }
+        static Vec2d rsqrtEstimate(Vec2d a) { return {_mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(a.v)))}; }
+        double sum() const { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+    };
+
+    /**
+     * 8 floats (AVX2)
+     */
+    struct Vec8f {
+        typedef float Scalar;
+        static constexpr int WIDTH = 8;
+        static constexpr int NEWTON_STEPS = 1;
+        __m256 v;
+
+        GRAVSIM_TARGET_AVX2 static Vec8f load(const float* p) { return {_mm256_loadu_ps(p)}; }
+        GRAVSIM_TARGET_AVX2 static Vec8f broadcast(float value) { return {_mm256_set1_ps(value)}; }
+        GRAVSIM_TARGET_AVX2 friend Vec8f operator+(Vec8f a, Vec8f b) { return {_mm256_add_ps(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 friend Vec8f operator-(Vec8f a, Vec8f b) { return {_mm256_sub_ps(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 friend Vec8f operator*(Vec8f a, Vec8f b) { return {_mm256_mul_ps(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 static Vec8f max(Vec8f a, Vec8f b) { return {_mm256_max_ps(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 static Vec8f lessEqual(Vec8f a, Vec8f b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+        GRAVSIM_TARGET_AVX2 static Vec8f select(Vec8f mask, Vec8f a) { return {_mm256_and_ps(mask.v, a.v)}; }
+        GRAVSIM_TARGET_AVX2 static Vec8f rsqrtEstimate(Vec8f a) { return {_mm256_rsqrt_ps(a.v)}; }
+        GRAVSIM_TARGET_AVX2 float sum() const {
+            __m128 half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            __m128 pairs = _mm_add_ps(half, _mm_movehl_ps(half, half));
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+    };
+
+    /**
+     * 4 doubles (AVX2)
+     */
+    struct Vec4d {
+        typedef double Scalar;
+        static constexpr int WIDTH = 4;
+        static constexpr int NEWTON_STEPS = 2;
+        __m256d v;
+
+        GRAVSIM_TARGET_AVX2 static Vec4d load(const double* p) { return {_mm256_loadu_pd(p)}; }
+        GRAVSIM_TARGET_AVX2 static Vec4d broadcast(double value) { return {_mm256_set1_pd(value)}; }
+        GRAVSIM_TARGET_AVX2 friend Vec4d operator+(Vec4d a, Vec4d b) { return {_mm256_add_pd(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 friend Vec4d operator-(Vec4d a, Vec4d b) { return {_mm256_sub_pd(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 friend Vec4d operator*(Vec4d a, Vec4d b) { return {_mm256_mul_pd(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 static Vec4d max(Vec4d a, Vec4d b) { return {_mm256_max_pd(a.v, b.v)}; }
+        GRAVSIM_TARGET_AVX2 static Vec4d lessEqual(Vec4d a, Vec4d b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)}; }
+        GRAVSIM_TARGET_AVX2 static Vec4d select(Vec4d mask, Vec4d a) { return {_mm256_and_pd(mask.v, a.v)}; }
+        GRAVSIM_TARGET_AVX2 static Vec4d rsqrtEstimate(Vec4d a) {
+            return {_mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(a.v)))};
+        }
+        GRAVSIM_TARGET_AVX2 double sum() const {
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        }
+    };
+
+    /**
+     * Vector types for a scalar type
+     */
+    template <typename T>
+    struct VectorsOf;
+
+    template <>
+    struct VectorsOf<float> {
+        typedef Vec4f Sse2;
+        typedef Vec8f Avx2;
+    };
+
+    template <>
+    struct VectorsOf<double> {
+        typedef Vec2d Sse2;
+        typedef Vec4d Avx2;
+    };
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include "Scalar.h"
+
+/**
+ * Vectorized pairwise planet gravity for host builds
+ * Every planet (i) accumulates the pull of all others in tiles of 4 or 8
+ * (j), using the SIMD wrapper in Simd.h. Each pair is evaluated from both
+ * sides, which costs twice the arithmetic of the symmetric scalar loop but
+ * keeps the j loop free of scattered writes. 1/r^3 comes from a hardware
+ * reciprocal square root estimate refined by Newton steps, and pairs follow
+ * the MAX_FORCE_DISTANCE cutoff and MIN_DISTANCE clamp of GravityKernel::pair.
+ * The widest instruction set the CPU supports is picked at run time.
+ * Rows (i) only write their own accelerations, so disjoint row ranges can
+ * run on separate threads and give the same result as one call.
+ * Results match the scalar loop to rounding, not bit for bit.
+ */
+namespace SimdGravity {
+    /**
+     * Instruction sets the kernel can run on
+     */
+    enum class InstructionSet {
+        SCALAR,  // No vector kernel (the engine's symmetric scalar loop is used)
+        SSE2,    // 4 floats or 2 doubles per tile
+        AVX2     // 8 floats or 4 doubles per tile
+    };
+
+    /**
+     * Get the widest instruction set the build and CPU support
+     * @return Instruction set
+     */
+    InstructionSet detectInstructionSet();
+
+    /**
+     * Get the instruction set the kernel runs on (detected on first use)
+     * @return Instruction set
+     */
+    InstructionSet getInstructionSet();
+
+    /**
+     * Force an instruction set (limited to what detectInstructionSet supports)
+     * @param set Instruction set
+     * @return Instruction set actually selected
+     */
+    InstructionSet setInstructionSet(InstructionSet set);
+
+    /**
+     * Get the display name of an instruction set
+     * @param set Instruction set
+     * @return Name
+     */
+    const char* getName(InstructionSet set);
+
+    /**
+     * Accumulate the accelerations all planets exert on a range of planets
+     * @param x X coordinates
+     * @param y Y coordinates
+     * @param gm G * M of each planet
+     * @param count Number of planets
+     * @param begin First planet to accumulate into
+     * @param end One past the last planet to accumulate into
+     * @param ax X components of acceleration (accumulated)
+     * @param ay Y components of acceleration (accumulated)
+     * @return false if no vector kernel is selected (nothing was accumulated)
+     */
+    bool accumulate(const Real* x, const Real* y, const Real* gm, size_t count, size_t begin, size_t end,
+                    Real* ax, Real* ay);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Simulation Clock Class
+ * Fixed-timestep clock: wall time is collected in an accumulator and paid
+ * out in whole physics steps, so physics results do not depend on how often
+ * the clock is polled. The remainder gives the render interpolation factor.
+ */
+class SimulationClock {
+public:
+    /**
+     * Constructor
+     * @param stepMicros Wall time simulated by one step (microseconds)
+     * @param maxCatchUpSteps Maximum steps returned by one advance
+     */
+    SimulationClock(uint32_t stepMicros, int maxCatchUpSteps);
+
+    /**
+     * Change the wall time simulated by one step (before reset)
+     * @param stepMicros Wall time simulated by one step (microseconds)
+     */
+    void setStepMicros(uint32_t stepMicros);
+
+    /**
+     * Start (or restart) measuring from the given time
+     * @param nowMicros Current time (microseconds)
+     */
+    void reset(uint32_t nowMicros);
+
+    /**
+     * Add elapsed wall time and get the number of steps to run
+     * Lag beyond the catch-up cap is dropped (the simulation slows down instead of spiralling)
+     * @param nowMicros Current time (microseconds)
+     * @return Number of physics steps to run
+     */
+    int advance(uint32_t nowMicros);
+
+    /**
+     * Get the wall time not yet simulated
+     * @return Accumulated time (microseconds, less than one step)
+     */
+    uint32_t getAccumulatorMicros() const;
+
+    /**
+     * Get the interpolation factor between the previous and current step
+     * @return Accumulator / step (0-1)
+     */
+    float getAlpha() const;
+
+    /**
+     * Get the total number of steps paid out
+     * @return Number of steps
+     */
+    uint32_t getStepCount() const;
+
+    /**
+     * Get the total wall time dropped by the catch-up cap
+     * @return Dropped time (microseconds)
+     */
+    uint32_t getDroppedMicros() const;
+
+    /**
+     * Get the wall time simulated by one step
+     * @return Step duration (microseconds)
+     */
+    uint32_t getStepMicros() const;
+
+private:
+    uint32_t stepMicros;          // Wall time simulated by one step
+    const int maxCatchUpSteps;    // Maximum steps returned by one advance
+    uint32_t lastMicros;          // Time of the previous advance
+    uint32_t accumulatorMicros;   // Wall time not yet simulated
+    uint32_t stepCount;           // Total steps paid out
+    uint32_t droppedMicros;       // Total wall time dropped by the catch-up cap
+};
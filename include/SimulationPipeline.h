@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Hal.h"
+#include <atomic>
+#if !defined(ARDUINO)
+#include <thread>
+#endif
+#include "PhysicsEngine.h"
+#include "SimulationSnapshot.h"
+#include "TripleBuffer.h"
+#include "SpscQueue.h"
+#include "SimulationClock.h"
+#include "Constants.h"
+#include "Profiler.h"
+
+/**
+ * Request to add a planet (sent from the touch handler to the physics task)
+ */
+struct PlanetSpawn {
+    double x;         // Initial X coordinate
+    double y;         // Initial Y coordinate
+    double vx;        // Initial X velocity
+    double vy;        // Initial Y velocity
+    uint16_t color;   // Planet color
+
+    // Gesture that requested the planet (kept for input recording)
+    int16_t touchStartX, touchStartY;  // Touch start (screen coordinates)
+    int16_t touchEndX, touchEndY;      // Touch end (screen coordinates)
+    uint32_t touchStartStep;           // Step count of the snapshot shown when the touch began
+    uint32_t appliedStep;              // Step count when the planet was added (set by the physics task)
+};
+
+/**
+ * Simulation Pipeline Class
+ * Runs the physics engine on its own task (pinned to the other ESP32 core on
+ * device, a std::thread on host) and publishes snapshots through a triple
+ * buffer, so rendering never blocks integration and vice versa
+ */
+class SimulationPipeline {
+public:
+    /**
+     * Constructor
+     * @param physicsEngine Physics engine (owned by the physics task after start)
+     * @param profiler Profiler timing the physics stages (nullptr disables timing)
+     */
+    SimulationPipeline(PhysicsEngine& physicsEngine, Profiler* profiler = nullptr);
+
+    /**
+     * Destructor (stops the physics thread on host)
+     */
+    ~SimulationPipeline();
+
+    /**
+     * Start the physics task
+     * @param maxX Maximum X coordinate for out-of-bounds detection
+     * @param maxY Maximum Y coordinate for out-of-bounds detection
+     */
+    void start(int maxX, int maxY);
+
+    /**
+     * Stop the physics task and wait for it to finish (host only)
+     */
+    void stop();
+
+    /**
+     * Hold the physics task at a step boundary and wait until it is held (render side);
+     * does nothing if the task is not running
+     */
+    void pause();
+
+    /**
+     * Let the physics task continue after pause (render side); the paused time is not caught up
+     */
+    void resume();
+
+    /**
+     * Prepare for stepping with runStep on the calling task instead of starting the physics task
+     * (lockstep replay)
+     * @param maxX Maximum X coordinate for out-of-bounds detection
+     * @param maxY Maximum Y coordinate for out-of-bounds detection
+     */
+    void startLockstep(int maxX, int maxY);
+
+    /**
+     * Run one physics step and publish it (lockstep only)
+     */
+    void runStep();
+
+    /**
+     * Report planet requests back to the render side once they are applied (before start)
+     * @param enabled Whether applied requests are reported
+     */
+    void setReportingSpawns(bool enabled);
+
+    /**
+     * Take a planet request the physics task has applied (render side)
+     * @param spawn Request with its applied step (output)
+     * @return false if there is none
+     */
+    bool takeAppliedSpawn(PlanetSpawn& spawn);
+
+    /**
+     * Request a new planet (render side)
+     * @param spawn Planet to add
+     * @return false if the request queue is full
+     */
+    bool requestPlanet(const PlanetSpawn& spawn);
+
+    /**
+     * Take the latest published snapshot if there is a new one (render side)
+     * @return true if a new snapshot was acquired (its events are not yet handled)
+     */
+    bool acquireSnapshot();
+
+    /**
+     * Get the most recently acquired snapshot (render side)
+     * @return Snapshot
+     */
+    const SimulationSnapshot& getSnapshot() const;
+
+private:
+    /**
+     * Entry point of the physics task
+     * @param arg Pipeline
+     */
+    static void taskEntry(void* arg);
+
+    /**
+     * Physics task loop
+     */
+    void run();
+
+    /**
+     * Run the physics steps due on the simulation clock and publish a snapshot
+     */
+    void tick();
+
+    /**
+     * Advance the simulation by one fixed step
+     */
+    void step();
+
+    /**
+     * Copy the engine state into the write buffer and publish it
+     */
+    void publishSnapshot();
+
+    /**
+     * Reserve space in every snapshot for the engine's planet limit and trail budget,
+     * so publishing never reallocates (call whenever they may have changed)
+     */
+    void reserveSnapshots();
+
+    PhysicsEngine& physicsEngine;  // Physics engine
+    Profiler* profiler;  // Profiler (may be nullptr)
+    TripleBuffer<SimulationSnapshot> snapshots;  // Physics -> render handoff
+    SpscQueue<PlanetSpawn, PipelineConstants::SPAWN_QUEUE_SIZE> spawnQueue;  // Render -> physics requests
+    SpscQueue<PlanetSpawn, PipelineConstants::SPAWN_QUEUE_SIZE> appliedQueue;  // Physics -> render applied requests
+    bool reportingSpawns;  // Whether applied requests are pushed to appliedQueue
+    int maxX, maxY;  // Bounds for out-of-bounds detection
+    SimulationClock clock;  // Fixed-timestep clock driving the physics steps
+    bool carryEvents;  // Whether the write buffer still holds events the render side never saw
+    std::atomic<bool> running;  // Whether the physics task should keep running
+    std::atomic<bool> pauseRequested;  // Whether the render side asked the physics task to hold
+    std::atomic<bool> paused;  // Whether the physics task is holding
+#if defined(ARDUINO)
+    TaskHandle_t task;  // Physics task
+#else
+    std::thread thread;  // Physics thread
+#endif
+};
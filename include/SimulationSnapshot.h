@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "BodyStore.h"
+#include "TrailPool.h"
+
+/**
+ * Type of effect triggered by the physics simulation
+ */
+enum class SimulationEventType : uint8_t {
+    SUN_COLLISION,  // A planet fell into the sun
+    PLANET_MERGE    // Two planets collided and merged
+};
+
+/**
+ * Effect triggered by the physics simulation (handled on the render side)
+ */
+struct SimulationEvent {
+    SimulationEventType type;  // Event type
+    float x;                   // X position (relative to center)
+    float y;                   // Y position (relative to center)
+    uint16_t color;            // Color of the planet involved (the merged planet for merges)
+    BodyId body;               // ID of the planet involved (the surviving planet for merges)
+};
+
+/**
+ * Immutable copy of the simulation state handed from physics to rendering
+ */
+struct SimulationSnapshot {
+    BodyStore bodies;                     // Hot physics state of planets
+    TrailPool trails;                     // Past positions of planets
+    std::vector<SimulationEvent> events;  // Effects triggered since the last consumed snapshot
+    uint32_t step;                        // Number of physics steps simulated so far
+    uint32_t publishMicros;               // Clock time when the snapshot was published
+    uint32_t accumulatorMicros;           // Wall time not yet simulated at publish
+    uint32_t stepMicros;                  // Wall time simulated by one physics step
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include "BodyStore.h"
+#include "Constants.h"
+
+/**
+ * SpatialGrid Class
+ * Uniform-grid cell list for enumerating nearby planet pairs
+ */
+class SpatialGrid {
+public:
+    /**
+     * Constructor
+     * @param cellSize Cell width (pixels)
+     * @param halfExtent Half width of the gridded area (pixels)
+     */
+    SpatialGrid(double cellSize, double halfExtent);
+
+    /**
+     * Update cell membership from planet positions
+     * Only planets that crossed a cell boundary are moved, unless a rebuild is requested
+     * @param bodies Body store of planets
+     * @param rebuild Whether to rebuild from scratch (planet indices changed)
+     */
+    void update(const BodyStore& bodies, bool rebuild);
+
+    /**
+     * Visit every pair of planets in the same or neighbouring cells exactly once
+     * @param visit Callback taking (index i, index j)
+     */
+    template <typename Visitor>
+    void forEachNearbyPair(Visitor&& visit) const;
+
+    /**
+     * Visit every other planet in the same or neighbouring cells of a planet
+     * @param body Index of the planet
+     * @param visit Callback taking (index j)
+     */
+    template <typename Visitor>
+    void forEachNeighbor(int body, Visitor&& visit) const;
+
+    /**
+     * Get the number of planets moved between cells by the last update
+     * @return Number of relocated planets
+     */
+    size_t getRelocationCount() const;
+
+private:
+    /**
+     * Get the cell index for a position (clamped to the grid)
+     * @param x X coordinate
+     * @param y Y coordinate
+     * @return Cell index
+     */
+    int cellFor(double x, double y) const;
+
+    /**
+     * Add a planet to a cell
+     * @param body Index of the planet
+     * @param cell Index of the cell
+     */
+    void insert(int body, int cell);
+
+    /**
+     * Remove a planet from its current cell (swap with the last entry)
+     * @param body Index of the planet
+     */
+    void remove(int body);
+
+    const double cellSize;             // Cell width
+    const double halfExtent;           // Half width of the gridded area
+    const int columns;                 // Number of cells per row (and per column)
+    std::vector<std::vector<int>> cells;  // Planet indices in each cell
+    std::vector<int> bodyCell;         // Cell of each planet
+    std::vector<int> bodySlot;         // Position of each planet in its cell
+    size_t relocationCount;            // Planets moved by the last update
+};
+
+template <typename Visitor>
+void SpatialGrid::forEachNearbyPair(Visitor&& visit) const {
+    // Half stencil (self, east, south-west, south, south-east) so each pair is visited once
+    static const int offsetX[] = {1, -1, 0, 1};
+    static const int offsetY[] = {0, 1, 1, 1};
+
+    for (int cy = 0; cy < columns; cy++) {
+        for (int cx = 0; cx < columns; cx++) {
+            const std::vector<int>& cell = cells[cy * columns + cx];
+            if (cell.empty()) {
+                continue;
+            }
+
+            // Pairs inside the cell
+            for (size_t a = 0; a < cell.size(); a++) {
+                for (size_t b = a + 1; b < cell.size(); b++) {
+                    visit(cell[a], cell[b]);
+                }
+            }
+
+            // Pairs with forward neighbours
+            for (int n = 0; n < 4; n++) {
+                int nx = cx + offsetX[n];
+                int ny = cy + offsetY[n];
+                if (nx < 0 || nx >= columns || ny >= columns) {
+                    continue;
+                }
+                const std::vector<int>& neighbour = cells[ny * columns + nx];
+                for (int a : cell) {
+                    for (int b : neighbour) {
+                        visit(a, b);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void SpatialGrid::forEachNeighbor(int body, Visitor&& visit) const {
+    // Full 3x3 stencil around the planet's cell
+    int cx = bodyCell[body] % columns;
+    int cy = bodyCell[body] / columns;
+    for (int ny = cy - 1; ny <= cy + 1; ny++) {
+        if (ny < 0 || ny >= columns) {
+            continue;
+        }
+        for (int nx = cx - 1; nx <= cx + 1; nx++) {
+            if (nx < 0 || nx >= columns) {
+                continue;
+            }
+            for (int other : cells[ny * columns + nx]) {
+                if (other != body) {
+                    visit(other);
+                }
+            }
+        }
+    }
+}
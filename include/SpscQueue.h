@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * SpscQueue Class
+ * Lock-free fixed-capacity queue for one producer and one consumer
+ */
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+public:
+    /**
+     * Constructor
+     */
+    SpscQueue() : head(0), tail(0) {
+    }
+
+    /**
+     * Append an item (producer side)
+     * @param item Item to append
+     * @return false if the queue is full
+     */
+    bool push(const T& item) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t nextTail = (currentTail + 1) % SLOTS;
+        if (nextTail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        items[currentTail] = item;
+        tail.store(nextTail, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest item (consumer side)
+     * @param item Removed item (output)
+     * @return false if the queue is empty
+     */
+    bool pop(T& item) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[currentHead];
+        head.store((currentHead + 1) % SLOTS, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr size_t SLOTS = CAPACITY + 1;  // One slot stays empty to tell full from empty
+
+    T items[SLOTS];
+    std::atomic<size_t> head;  // Next item to pop (consumer)
+    std::atomic<size_t> tail;  // Next free slot (producer)
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+class PhysicsEngine;
+class Renderer;
+class TouchHandler;
+
+/**
+ * State Writer Class
+ * Appends values and arrays to a state file in memory layout (arrays are a
+ * 32-bit count followed by the raw elements), so they load back with one
+ * fread per array
+ */
+class StateWriter {
+public:
+    /**
+     * Constructor
+     * @param file Output file
+     */
+    explicit StateWriter(FILE* file) : file(file), failed(false) {}
+
+    /**
+     * Append a plain value
+     * @param value Value
+     */
+    template <typename T>
+    void write(const T& value) {
+        writeBytes(&value, sizeof(T));
+    }
+
+    /**
+     * Append a block of plain values
+     * @param values First value
+     * @param count Number of values
+     */
+    template <typename T>
+    void writeBlock(const T* values, size_t count) {
+        write(static_cast<uint32_t>(count));
+        writeBytes(values, count * sizeof(T));
+    }
+
+    /**
+     * Append an array
+     * @param values Array
+     */
+    template <typename T>
+    void writeArray(const std::vector<T>& values) {
+        writeBlock(values.data(), values.size());
+    }
+
+    /**
+     * Check whether every write succeeded
+     * @return true if no write failed
+     */
+    bool ok() const { return !failed; }
+
+private:
+    void writeBytes(const void* bytes, size_t size) {
+        if (size > 0 && fwrite(bytes, 1, size, file) != size) {
+            failed = true;
+        }
+    }
+
+    FILE* file;   // Output file
+    bool failed;  // Whether a write failed
+};
+
+/**
+ * State Reader Class
+ * Reads what StateWriter wrote, straight into the destination arrays
+ */
+class StateReader {
+public:
+    /**
+     * Constructor
+     * @param file Input file
+     */
+    explicit StateReader(FILE* file) : file(file), failed(false) {}
+
+    /**
+     * Read a plain value
+     * @param value Value (output)
+     * @return false if the file is too short
+     */
+    template <typename T>
+    bool read(T& value) {
+        return readBytes(&value, sizeof(T));
+    }
+
+    /**
+     * Read a block of plain values into a fixed buffer
+     * @param values Buffer (output)
+     * @param count Number of values read (output)
+     * @param maxCount Capacity of the buffer
+     * @return false if the file is too short or the block does not fit
+     */
+    template <typename T>
+    bool readBlock(T* values, uint32_t& count, size_t maxCount) {
+        if (!read(count) || count > maxCount) {
+            failed = true;
+            return false;
+        }
+        return readBytes(values, count * sizeof(T));
+    }
+
+    /**
+     * Read an array (resized to the stored count)
+     * @param values Array (output)
+     * @param maxCount Largest count accepted
+     * @return false if the file is too short or the array is too long
+     */
+    template <typename T>
+    bool readArray(std::vector<T>& values, size_t maxCount) {
+        uint32_t count;
+        if (!read(count) || count > maxCount) {
+            failed = true;
+            return false;
+        }
+        values.resize(count);
+        return readBytes(values.data(), count * sizeof(T));
+    }
+
+    /**
+     * Check whether every read succeeded
+     * @return true if no read failed
+     */
+    bool ok() const { return !failed; }
+
+private:
+    bool readBytes(void* bytes, size_t size) {
+        if (failed || (size > 0 && fread(bytes, 1, size, file) != size)) {
+            failed = true;
+        }
+        return !failed;
+    }
+
+    FILE* file;   // Input file
+    bool failed;  // Whether a read failed
+};
+
+/**
+ * State File Class
+ * Versioned binary snapshot of a running session: the physics engine
+ * (planets, trail pool, integrator state), the renderer's effects and the
+ * planet color sequence. Values are stored in memory layout for the build's
+ * scalar type, so a file only loads into a build with the same layout.
+ */
+class StateFile {
+public:
+    /**
+     * Constructor
+     * @param physicsEngine Physics engine
+     * @param renderer Renderer
+     * @param touchHandler Touch handler
+     */
+    StateFile(PhysicsEngine& physicsEngine, Renderer& renderer, TouchHandler& touchHandler);
+
+    /**
+     * Save the session (the physics task must be paused or not running)
+     * Written to a temporary file first, so an interrupted save keeps the previous state
+     * @param name File name in storage
+     * @return false if the file could not be written
+     */
+    bool save(const char* name) const;
+
+    /**
+     * Restore a saved session (before the physics task starts)
+     * @param name File name in storage
+     * @return false if there is no compatible state (the session is then left empty)
+     */
+    bool load(const char* name);
+
+    /**
+     * Write the session to an open file
+     * @param file Output file
+     * @return false if a write failed
+     */
+    bool write(FILE* file) const;
+
+    /**
+     * Read a session from an open file
+     * @param file Input file
+     * @return false if the data is missing or incompatible (the session is then left empty)
+     */
+    bool read(FILE* file);
+
+private:
+    PhysicsEngine& physicsEngine;  // Physics engine
+    Renderer& renderer;            // Renderer
+    TouchHandler& touchHandler;    // Touch handler
+};
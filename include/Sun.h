@@ -1,12 +1,15 @@
 #pragma once
 
-#include <M5Unified.h>
-#include <M5GFX.h>
+#include <vector>
+#include "Hal.h"
 #include "Constants.h"
+#include "PixelKernels.h"
 
 /**
  * Sun Class
- * Manages the rendering and physical properties of the sun
+ * Manages the rendering and physical properties of the sun. The body and its
+ * random rays are rendered once into FRAME_COUNT stencils, and every frame
+ * fills a random one in the current color instead of rasterizing the rays.
  */
 class Sun {
 public:
@@ -15,13 +18,24 @@ public:
      */
     Sun();
 
+    /**
+     * Render the animation frames (until then the sun is rasterized every frame)
+     * @param display Display (parent of the scratch sprite)
+     */
+    void prerender(hal::Display& display);
+
+    /**
+     * Pick a new brightness (called every COLOR_UPDATE_INTERVAL by the frame scheduler)
+     */
+    void updateColor();
+
     /**
      * Draw the sun
      * @param canvas Canvas to draw on
      * @param centerX X coordinate of screen center
      * @param centerY Y coordinate of screen center
      */
-    void draw(M5Canvas& canvas, int centerX, int centerY);
+    void draw(hal::Canvas& canvas, int centerX, int centerY);
 
     /**
      * Get the sun's mass
@@ -35,15 +49,32 @@ public:
      */
     int getRadius() const;
 
+    /**
+     * Get the radius of everything drawn for the sun (body and rays)
+     * @return Drawn radius (pixels)
+     */
+    int getDrawRadius() const;
+
 private:
     /**
      * Calculate the sun's color
      * @return Sun's color
      */
     uint16_t calculateColor();
+
+    /**
+     * Rasterize the body and a new set of random rays
+     * @param canvas Canvas to draw on
+     * @param centerX X coordinate of the sun center
+     * @param centerY Y coordinate of the sun center
+     * @param color Sun's color
+     */
+    void rasterize(hal::Canvas& canvas, int centerX, int centerY, uint16_t color);
+
+    std::vector<pixel::Stencil> frames;  // Pre-rendered body and rays (relative to the center)
     
-    // Cached color for optimization
+    // Current color (changed by updateColor, not every frame)
     uint16_t cachedColor;
-    unsigned long lastColorUpdateTime;
-    static constexpr unsigned long COLOR_UPDATE_INTERVAL = 100; // milliseconds
+    static constexpr int RAY_MIN_LENGTH = 10;  // pixels
+    static constexpr int RAY_LENGTH_VARIATION = 3;  // pixels (exclusive)
 };
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include "BodyStore.h"
+
+/**
+ * SweepAndPrune Class
+ * Broadphase for planet contacts: planets are kept sorted by the left edge of
+ * their bounding box and swept once, so only planets overlapping on the X axis
+ * are tested. The order is kept between steps, where planets barely move, so
+ * re-sorting with insertion sort is close to linear.
+ */
+class SweepAndPrune {
+public:
+    /**
+     * Constructor
+     */
+    SweepAndPrune();
+
+    /**
+     * Find every pair of planets whose circles overlap
+     * @param bodies Body store of planets
+     * @param rebuild Whether to rebuild the order from scratch (planet indices changed)
+     * @param contacts Overlapping pairs (i < j) (output, cleared first)
+     */
+    void findContacts(const BodyStore& bodies, bool rebuild, std::vector<std::pair<int, int>>& contacts);
+
+    /**
+     * Get the number of narrow-phase circle tests done by the last search
+     * @return Number of tests
+     */
+    size_t getTestCount() const;
+
+private:
+    std::vector<int> order;    // Planet indices sorted by left edge
+    std::vector<float> left;   // Left edge of each planet's bounding box
+    std::vector<int> active;   // Planets whose X interval may still overlap the sweep line
+    size_t testCount;          // Narrow-phase tests in the last search
+};
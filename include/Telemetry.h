@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "SimulationSnapshot.h"
+#include "Profiler.h"
+#include "TelemetryFormat.h"
+
+/**
+ * Telemetry Class
+ * Streams the planets of the published snapshots over the serial port as
+ * framed, quantized and delta-encoded binary (see TelemetryFormat.h), with
+ * the physics and frame timings. A frame is due every INTERVAL (the frame
+ * scheduler calls update) and is sent only if it fits both the byte budget
+ * and the free space of the serial transmit buffer, so writing never blocks;
+ * a frame that does not fit is dropped and the next one is encoded against
+ * the last frame actually sent, so no spawn or removal is lost.
+ */
+class Telemetry {
+public:
+    /**
+     * Constructor
+     * @param profiler Profiler the timings are read from (nullptr sends zeros)
+     */
+    explicit Telemetry(Profiler* profiler = nullptr);
+
+    /**
+     * Start or stop streaming (a stream always starts with a keyframe)
+     * @param enabled Whether frames are sent
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Check whether streaming is on
+     * @return true if frames are sent
+     */
+    bool isEnabled() const;
+
+    /**
+     * Send a frame of the snapshot if it fits the budget (render side, called every INTERVAL)
+     * @param snapshot Latest acquired snapshot
+     * @param now Current time (milliseconds)
+     * @return true if a frame was written to the serial port
+     */
+    bool update(const SimulationSnapshot& snapshot, uint32_t now);
+
+    /**
+     * Get the number of frames sent since streaming started
+     * @return Number of frames
+     */
+    uint32_t getSentCount() const;
+
+    /**
+     * Get the number of due frames dropped since streaming started
+     * @return Number of frames
+     */
+    uint32_t getDroppedCount() const;
+
+private:
+    /**
+     * Quantized state of a body as the decoder knows it
+     */
+    struct Body {
+        BodyId id;       // Stable ID
+        int32_t x, y;    // Position (1/POSITION_SCALE pixels)
+        int32_t vx, vy;  // Velocity (1/VELOCITY_SCALE of the engine's unit)
+    };
+
+    /**
+     * Encode a frame of the snapshot into the frame buffer and the bodies it describes into next
+     * @param snapshot Snapshot
+     * @param keyframe Whether to send every body absolute
+     * @return false if the payload does not fit the length field
+     */
+    bool encode(const SimulationSnapshot& snapshot, bool keyframe);
+
+    /**
+     * Quantize a body
+     * @param bodies Planets
+     * @param index Dense index
+     * @return Quantized body
+     */
+    static Body quantize(const BodyStore& bodies, size_t index);
+
+    /**
+     * Append an absolute body (ID, position, velocity)
+     * @param body Body
+     */
+    void putBody(const Body& body);
+
+    /**
+     * Append an unsigned LEB128 varint
+     * @param value Value
+     */
+    void putVarint(uint32_t value);
+
+    /**
+     * Append a zigzag-encoded signed varint
+     * @param value Value
+     */
+    void putSigned(int32_t value);
+
+    Profiler* profiler;          // Timing source (may be nullptr)
+    bool enabled;                // Whether frames are sent
+    std::vector<Body> sent;      // Bodies of the last frame sent (the decoder's state)
+    std::vector<Body> next;      // Bodies of the frame being encoded
+    std::vector<uint8_t> known;  // Per dense index of the snapshot: whether the body is in sent
+    std::vector<uint8_t> frame;  // Encoded frame
+    float budget;                // Bytes that may be sent now (refilled at BYTES_PER_SECOND)
+    uint32_t lastRefill;         // Time the budget was last refilled (milliseconds)
+    uint32_t sequence;           // Sequence number of the next frame sent
+    uint32_t sinceKeyframe;      // Frames sent since the last keyframe
+    bool keyframeDue;            // Whether the next frame must be a keyframe
+    uint32_t droppedSinceSent;   // Frames dropped since the last frame sent
+    uint32_t sentCount;          // Frames sent
+    uint32_t droppedCount;       // Frames dropped
+};
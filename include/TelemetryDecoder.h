@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * Counters of a telemetry decoder
+ */
+struct TelemetryDecoderStats {
+    uint32_t frames;     // Frames decoded
+    uint32_t keyframes;  // Keyframes decoded
+    uint32_t crcErrors;  // Frames with a bad checksum
+    uint32_t malformed;  // Frames whose payload did not parse
+    uint32_t gaps;       // Sequence gaps (frames lost on the link)
+    uint32_t dropped;    // Frames the device dropped for lack of bandwidth
+    uint32_t skipped;    // Deltas ignored while waiting for a keyframe
+};
+
+/**
+ * TelemetryDecoder Class
+ * Host side of the serial telemetry stream (see TelemetryFormat.h). Bytes are
+ * fed as they arrive; complete frames with a valid checksum are decoded into
+ * the bodies they describe, and every other byte is handed on as serial text.
+ * A bad checksum resyncs at the next byte; after a gap in the sequence
+ * numbers, deltas are ignored until the next keyframe. Used by
+ * tools/TelemetryDecoder.cpp and the loopback test.
+ */
+class TelemetryDecoder {
+public:
+    /**
+     * Quantized state of a body
+     */
+    struct Body {
+        uint32_t id;            // Stable ID
+        int32_t x, y, vx, vy;   // Position and velocity (TelemetryFormat units)
+    };
+
+    /**
+     * Header and changes of a decoded frame
+     */
+    struct Frame {
+        uint32_t sequence;               // Sequence number
+        uint32_t step;                   // Physics step of the snapshot
+        uint32_t dropped;                // Frames the device dropped before this one
+        uint32_t physicsMicros;          // Physics p50 (microseconds)
+        uint32_t frameMicros;            // Frame p50 (microseconds)
+        bool keyframe;                   // Whether every body was sent absolute
+        std::vector<uint32_t> spawned;   // Bodies added since the previous frame
+        std::vector<uint32_t> removed;   // Bodies gone since the previous frame
+    };
+
+    typedef std::function<void(const Frame&)> FrameHandler;  // Called for each decoded frame
+    typedef std::function<void(uint8_t)> TextHandler;        // Called for each byte outside frames
+
+    /**
+     * Constructor
+     * @param onFrame Called for each decoded frame (may be empty)
+     * @param onText Called for each byte of serial text (may be empty)
+     */
+    explicit TelemetryDecoder(FrameHandler onFrame = FrameHandler(), TextHandler onText = TextHandler());
+
+    /**
+     * Consume received bytes (an incomplete frame at the end waits for the next call)
+     * @param data Bytes
+     * @param size Number of bytes
+     */
+    void feed(const uint8_t* data, size_t size);
+
+    /**
+     * Get the bodies as of the last decoded frame
+     * @return Bodies (in the order of the stream)
+     */
+    const std::vector<Body>& getBodies() const { return bodies; }
+
+    /**
+     * Check whether the bodies are valid (a keyframe was decoded since the last gap)
+     * @return true if synced
+     */
+    bool isSynced() const { return synced; }
+
+    /**
+     * Get the counters
+     * @return Counters
+     */
+    const TelemetryDecoderStats& getStats() const { return stats; }
+
+private:
+    /**
+     * Consume every complete frame and text byte at the front of the buffer
+     */
+    void process();
+
+    /**
+     * Decode a frame with a valid checksum
+     * @param type Frame type
+     * @param payload Payload
+     * @param size Payload size
+     */
+    void decodeFrame(uint8_t type, const uint8_t* payload, size_t size);
+
+    /**
+     * Hand a byte outside frames to the text handler
+     * @param byte Byte
+     */
+    void passText(uint8_t byte);
+
+    FrameHandler onFrame;          // Called for each decoded frame
+    TextHandler onText;            // Called for each byte of serial text
+    std::vector<uint8_t> buffer;   // Received bytes not consumed yet
+    std::vector<Body> bodies;      // Bodies as of the last decoded frame
+    std::vector<Body> decoded;     // Bodies of the frame being decoded
+    Frame frame;                   // Frame being decoded
+    bool synced;                   // Whether bodies is valid
+    uint32_t nextSequence;         // Sequence number expected next
+    TelemetryDecoderStats stats;   // Counters
+};
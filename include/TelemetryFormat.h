@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Wire format of the serial telemetry stream (shared by the device encoder
+ * and the host decoder in tools/TelemetryDecoder.cpp)
+ *
+ * Frame: SYNC_0 SYNC_1, type (1 byte), payload length (2 bytes), payload,
+ * CRC-16/CCITT of type, length and payload (2 bytes). Multi-byte fields are
+ * little-endian. Bytes outside frames are ordinary serial text.
+ *
+ * Payload (integers are LEB128 varints, signed ones zigzag-encoded):
+ *   sequence, step, dropped frames, physics p50 (us), frame p50 (us), then
+ *   KEYFRAME: count, count x (id, x, y, vx, vy)
+ *   DELTA:    removed count, removed ids,
+ *             kept count, kept x (dx, dy, dvx, dvy),
+ *             added count, added x (id, x, y, vx, vy)
+ * Kept bodies are in the order of the previous frame with removed bodies
+ * taken out; added bodies are appended after them. Positions are relative to
+ * the sun in 1/POSITION_SCALE pixels, velocities in 1/VELOCITY_SCALE of the
+ * engine's unit, and deltas are between quantized values, so they never drift.
+ */
+namespace TelemetryFormat {
+    constexpr uint8_t SYNC_0 = 0xA5;           // First sync byte
+    constexpr uint8_t SYNC_1 = 0x5A;           // Second sync byte
+    constexpr size_t HEADER_SIZE = 5;          // Sync, type, payload length
+    constexpr size_t CRC_SIZE = 2;             // Trailing checksum
+    constexpr size_t MAX_PAYLOAD_SIZE = 65535; // Largest payload the length field can carry
+    constexpr double POSITION_SCALE = 16.0;    // Position units per pixel
+    constexpr double VELOCITY_SCALE = 65536.0; // Velocity units per engine velocity unit
+
+    /**
+     * Kinds of telemetry frames
+     */
+    enum class FrameType : uint8_t {
+        KEYFRAME = 1,  // Every body, absolute
+        DELTA = 2      // Changes since the previous frame
+    };
+
+    /**
+     * Compute the CRC-16/CCITT-FALSE of a byte range
+     * @param bytes First byte
+     * @param size Number of bytes
+     * @param crc Running value (to continue a previous range)
+     * @return CRC
+     */
+    inline uint16_t crc16(const uint8_t* bytes, size_t size, uint16_t crc = 0xFFFF) {
+        for (size_t i = 0; i < size; i++) {
+            crc ^= static_cast<uint16_t>(bytes[i]) << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) != 0 ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    /**
+     * Map a signed value to an unsigned one with small magnitudes staying small
+     * @param value Signed value
+     * @return Zigzag-encoded value
+     */
+    inline uint32_t zigzag(int32_t value) {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    /**
+     * Undo zigzag
+     * @param value Zigzag-encoded value
+     * @return Signed value
+     */
+    inline int32_t unzigzag(uint32_t value) {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+}
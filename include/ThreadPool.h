@@ -0,0 +1,106 @@
+#pragma once
+
+#if !defined(ARDUINO)
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Thread Pool Class (host only)
+ * Fork-join pool for data-parallel loops. parallelFor splits an index range
+ * into chunks and deals neighbouring chunks to each thread's queue; a thread
+ * takes chunks from the front of its own queue and, once it runs dry, steals
+ * from the back of the others, so uneven chunks (such as tree walks of dense
+ * regions) still keep every core busy. The calling thread works as one of
+ * the threads. Which thread runs a chunk varies between calls, so bodies must
+ * only write data owned by their index range for results to be deterministic.
+ */
+class ThreadPool {
+public:
+    /**
+     * Constructor (starts the worker threads)
+     * @param threadCount Threads including the caller (0 for the number of hardware threads)
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /**
+     * Destructor (stops the worker threads)
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Get the number of threads that run chunks (including the caller)
+     * @return Number of threads
+     */
+    unsigned getThreadCount() const;
+
+    /**
+     * Run body over [0, count) in chunks of grain indices and wait for all of them
+     * (small ranges run on the calling thread only)
+     * @param count Number of indices
+     * @param grain Indices per chunk
+     * @param body Function called with each chunk's [begin, end)
+     */
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    /**
+     * Range of indices
+     */
+    struct Range {
+        size_t begin;  // First index
+        size_t end;    // One past the last index
+    };
+
+    /**
+     * Chunks dealt to one thread (the owner takes from the front, thieves from the back;
+     * the storage is kept from loop to loop)
+     */
+    struct Queue {
+        std::mutex mutex;           // Guards the fields below
+        std::vector<Range> ranges;  // Chunks dealt for the current loop
+        size_t front;               // Next chunk for the owner
+        size_t back;                // One past the next chunk for a thief (front == back when empty)
+    };
+
+    /**
+     * Worker thread loop
+     * @param index Queue of the worker
+     */
+    void workerLoop(unsigned index);
+
+    /**
+     * Run chunks until every queue is empty
+     * @param index Queue of the calling thread
+     * @param body Loop body
+     */
+    void runChunks(unsigned index, const std::function<void(size_t, size_t)>& body);
+
+    /**
+     * Take a chunk from the thread's own queue, or steal one from another
+     * @param index Queue of the calling thread
+     * @param range Chunk (output)
+     * @return false if every queue is empty
+     */
+    bool take(unsigned index, Range& range);
+
+    unsigned threadCount;                      // Threads including the caller
+    std::unique_ptr<Queue[]> queues;           // One queue per thread (index 0 is the caller)
+    std::vector<std::thread> workers;          // Worker threads (queues 1 and up)
+    std::mutex mutex;                          // Guards the fields below
+    std::condition_variable wake;              // Signals a new loop or shutdown to the workers
+    std::condition_variable done;              // Signals the caller that every worker finished
+    const std::function<void(size_t, size_t)>* job;  // Body of the current loop
+    uint64_t generation;                       // Incremented for every loop
+    unsigned busyWorkers;                      // Workers still running the current loop
+    bool stopping;                             // Whether the workers should exit
+};
+#endif
@@ -1,8 +1,12 @@
 #pragma once
 
-#include <M5Unified.h>
-#include "PhysicsEngine.h"
+#include "Hal.h"
+#include "SimulationPipeline.h"
 #include "Renderer.h"
+#include "Random.h"
+
+class StateWriter;
+class StateReader;
 
 /**
  * Touch Handler Class
@@ -12,17 +16,43 @@ class TouchHandler {
 public:
     /**
      * Constructor
-     * @param physicsEngine Physics engine
+     * @param pipeline Simulation pipeline (planets are added on the physics task)
      * @param renderer Renderer
      */
-    TouchHandler(PhysicsEngine& physicsEngine, Renderer& renderer);
+    TouchHandler(SimulationPipeline& pipeline, Renderer& renderer);
 
     /**
-     * Process touch operations
+     * Process touch operations (reads the touch panel)
      * @return true if touch is active
      */
     bool update();
 
+    /**
+     * Process touch operations for a given touch state (used by replay)
+     * @param touch Touch state
+     * @return true if touch is active
+     */
+    bool update(const hal::TouchPoint& touch);
+
+    /**
+     * Restart the planet color sequence
+     * @param seed Seed
+     */
+    void setSeed(uint32_t seed);
+
+    /**
+     * Write the planet color sequence position to a state file
+     * @param writer Writer
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Continue the planet color sequence from a state file
+     * @param reader Reader
+     * @return false if the data is missing
+     */
+    bool loadState(StateReader& reader);
+
     /**
      * Get X coordinate of touch start position
      * @return X coordinate of touch start position
@@ -35,10 +65,26 @@ public:
      */
     int getTouchStartY() const;
 
+    /**
+     * Get X coordinate of the current touch position
+     * @return X coordinate of the current touch position
+     */
+    int getTouchX() const;
+
+    /**
+     * Get Y coordinate of the current touch position
+     * @return Y coordinate of the current touch position
+     */
+    int getTouchY() const;
+
 private:
-    PhysicsEngine& physicsEngine;  // Physics engine
+    SimulationPipeline& pipeline;  // Simulation pipeline
     Renderer& renderer;  // Renderer
     bool isTouching;  // Whether touch is active
     int touchStartX;  // X coordinate of touch start position
     int touchStartY;  // Y coordinate of touch start position
+    uint32_t touchStartStep;  // Step count of the snapshot shown when the touch began
+    int touchX;  // X coordinate of the current touch position
+    int touchY;  // Y coordinate of the current touch position
+    Random colorRandom;  // Planet colors (separate from hal::random so replays reproduce them)
 };
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Constants.h"
+
+class StateWriter;
+class StateReader;
+
+/**
+ * TrailPool Class
+ * Past positions of planets (for trail effect), kept apart from the hot
+ * physics state in BodyStore. All trails share one pool of int16 points with
+ * a fixed budget; each planet holds a handle (first slot of its ring buffer)
+ * and a length. Trails are indexed like the planets in BodyStore (removal
+ * moves the last trail into the hole), and the budget is redistributed when
+ * planets come and go, so more planets means shorter trails.
+ */
+class TrailPool {
+public:
+    /**
+     * Constructor
+     * @param budget Maximum number of trail points of all planets together
+     */
+    TrailPool(size_t budget = TrailConstants::POOL_POINTS);
+
+    /**
+     * Reserve space for planets (the point pool always reserves the full budget)
+     * @param capacity Number of planets
+     */
+    void reserve(size_t capacity);
+
+    /**
+     * Append a trail with all points at the initial position
+     * @param x Initial X coordinate
+     * @param y Initial Y coordinate
+     */
+    void add(int x, int y);
+
+    /**
+     * Remove a trail by moving the last trail into its place (mirrors BodyStore::remove)
+     * Its points stay in the pool as a hole until compact() is called
+     * @param index Index of the trail to remove
+     */
+    void remove(size_t index);
+
+    /**
+     * Close the holes left by removed trails and hand the freed points to the remaining trails
+     * (call once after a batch of removals)
+     */
+    void compact();
+
+    /**
+     * Remove all trails
+     */
+    void clear();
+
+    /**
+     * Record a new newest point
+     * @param index Index of the planet
+     * @param x X coordinate
+     * @param y Y coordinate
+     */
+    void record(size_t index, int x, int y);
+
+    /**
+     * Get the number of trails
+     * @return Number of trails
+     */
+    size_t size() const { return start.size(); }
+
+    /**
+     * Get the number of points in a trail
+     * @param index Index of the planet
+     * @return Trail length
+     */
+    int getLength(size_t index) const { return length[index]; }
+
+    /**
+     * Get the ring buffer position of the newest point of a trail
+     * @param index Index of the planet
+     * @return Position within the trail (0 to length - 1)
+     */
+    int getHead(size_t index) const { return head[index]; }
+
+    /**
+     * Get the X coordinates of a trail (ring buffer of getLength points)
+     * @param index Index of the planet
+     * @return First X coordinate of the trail
+     */
+    const int16_t* getXs(size_t index) const { return pointX.data() + start[index]; }
+
+    /**
+     * Get the Y coordinates of a trail (ring buffer of getLength points)
+     * @param index Index of the planet
+     * @return First Y coordinate of the trail
+     */
+    const int16_t* getYs(size_t index) const { return pointY.data() + start[index]; }
+
+    /**
+     * Get X coordinate of a trail point
+     * @param index Index of the planet
+     * @param age Age of the point (0 = newest, less than getLength)
+     * @return X coordinate
+     */
+    int getX(size_t index, int age) const { return pointX[slot(index, age)]; }
+
+    /**
+     * Get Y coordinate of a trail point
+     * @param index Index of the planet
+     * @param age Age of the point (0 = newest, less than getLength)
+     * @return Y coordinate
+     */
+    int getY(size_t index, int age) const { return pointY[slot(index, age)]; }
+
+    /**
+     * Get the number of trail points in the pool (including holes not yet compacted)
+     * @return Points in use
+     */
+    size_t getPointCount() const { return pointX.size(); }
+
+    /**
+     * Get the maximum number of trail points of all planets together
+     * @return Budget (points)
+     */
+    size_t getBudget() const { return budget; }
+
+    /**
+     * Get the longest a trail may grow
+     * @return Maximum trail length (points)
+     */
+    int getMaxLength() const { return maxLength; }
+
+    /**
+     * Change the budget and the longest trail, and share the budget among the current trails
+     * @param newBudget Maximum number of trail points of all planets together
+     * @param newMaxLength Maximum trail length (points)
+     */
+    void setBudget(size_t newBudget, int newMaxLength = PlanetConstants::TRAIL_LENGTH);
+
+    /**
+     * Write the state to a state file
+     * @param writer Writer
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Replace the state with one written by saveState
+     * @param reader Reader
+     * @param maxCount Largest number of trails accepted
+     * @return false if the data is invalid or was saved with another budget (the pool is then empty)
+     */
+    bool loadState(StateReader& reader, size_t maxCount);
+
+    /**
+     * Get the number of bytes stored per trail point
+     * @return Bytes per point
+     */
+    static constexpr size_t bytesPerPoint() {
+        return 2 * sizeof(int16_t);
+    }
+
+private:
+    /**
+     * Get the pool position of a trail point
+     * @param index Index of the planet
+     * @param age Age of the point (0 = newest)
+     * @return Position in pointX/pointY
+     */
+    size_t slot(size_t index, int age) const {
+        int ring = head[index] - age;
+        if (ring < 0) {
+            ring += length[index];
+        }
+        return start[index] + ring;
+    }
+
+    /**
+     * Sort the trail indices by their position in the pool
+     */
+    void sortLayout();
+
+    /**
+     * Share the budget among the current trails and move them to their new places
+     * (the newest points are kept when a trail shrinks, the oldest is repeated when it grows)
+     * @param growing Whether trails get longer (planets were removed) or shorter (one was added)
+     */
+    void redistribute(bool growing);
+
+    /**
+     * Get the length each trail gets for a number of planets
+     * @param count Number of planets
+     * @param rank Position of the trail in the pool
+     * @return Trail length
+     */
+    int shareOf(size_t count, size_t rank) const;
+
+    size_t budget;                  // Maximum points of all trails together
+    int maxLength;                  // Maximum points of one trail
+    std::vector<int16_t> pointX;    // X coordinates of all trails
+    std::vector<int16_t> pointY;    // Y coordinates of all trails
+    std::vector<uint32_t> start;    // First pool slot of each trail (handle)
+    std::vector<uint16_t> length;   // Number of points of each trail
+    std::vector<uint16_t> head;     // Ring buffer position of the newest point of each trail
+    std::vector<uint16_t> layout;   // Trail indices in pool order
+    bool fragmented;                // Whether removed trails left holes in the pool
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * TripleBuffer Class
+ * Lock-free single-producer / single-consumer handoff of the latest value.
+ * The producer always owns one buffer, the consumer another, and the third
+ * holds the most recently published value, so neither side ever waits.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /**
+     * Constructor
+     */
+    TripleBuffer() : state(MIDDLE_INITIAL), backIndex(0), frontIndex(2) {
+    }
+
+    /**
+     * Get the buffer owned by the producer
+     * @return Buffer to fill before publish()
+     */
+    T& getWriteBuffer() {
+        return buffers[backIndex];
+    }
+
+    /**
+     * Publish the write buffer and take over the previous middle buffer
+     * @return true if the buffer handed back was never read by the consumer
+     *         (its content was dropped and is now the new write buffer)
+     */
+    bool publish() {
+        uint8_t previous = state.exchange(static_cast<uint8_t>(backIndex | FRESH), std::memory_order_acq_rel);
+        backIndex = previous & INDEX_MASK;
+        return (previous & FRESH) != 0;
+    }
+
+    /**
+     * Take the most recently published buffer if there is a new one
+     * @return true if a new buffer was acquired
+     */
+    bool acquire() {
+        if ((state.load(std::memory_order_acquire) & FRESH) == 0) {
+            return false;
+        }
+        uint8_t previous = state.exchange(static_cast<uint8_t>(frontIndex), std::memory_order_acq_rel);
+        frontIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * Get the buffer owned by the consumer
+     * @return Most recently acquired buffer
+     */
+    const T& getReadBuffer() const {
+        return buffers[frontIndex];
+    }
+
+    /**
+     * Access a buffer for initialization (only before both sides start)
+     * @param index Buffer index (0-2)
+     * @return Buffer
+     */
+    T& getBuffer(int index) {
+        return buffers[index];
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x03;
+    static constexpr uint8_t FRESH = 0x04;        // Middle buffer has not been read yet
+    static constexpr uint8_t MIDDLE_INITIAL = 1;  // Buffer 1 starts in the middle
+
+    T buffers[3];
+    std::atomic<uint8_t> state;  // Middle buffer index and FRESH flag
+    uint8_t backIndex;           // Buffer owned by the producer
+    uint8_t frontIndex;          // Buffer owned by the consumer
+};
@@ -0,0 +1,206 @@
+#include "BodyStore.h"
+#include "StateFile.h"
+
+namespace {
+    /**
+     * Fold the bytes of an array into an FNV-1a hash
+     */
+    template <typename T>
+    uint32_t hashArray(uint32_t hash, const std::vector<T>& values) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values.data());
+        for (size_t i = 0; i < values.size() * sizeof(T); i++) {
+            hash = (hash ^ bytes[i]) * 16777619U;
+        }
+        return hash;
+    }
+}
+
+void BodyStore::reserve(size_t capacity) {
+    x.reserve(capacity);
+    y.reserve(capacity);
+    vx.reserve(capacity);
+    vy.reserve(capacity);
+    prevX.reserve(capacity);
+    prevY.reserve(capacity);
+    gm.reserve(capacity);
+    radius.reserve(capacity);
+    color.reserve(capacity);
+    id.reserve(capacity);
+    serial.reserve(capacity);
+
+    // Add the new slots to the free stack (lowest slot on top)
+    size_t oldCapacity = slotIndex.size();
+    if (capacity <= oldCapacity) {
+        return;
+    }
+    slotIndex.resize(capacity, FREE_SLOT);
+    slotGeneration.resize(capacity, 0);
+    freeSlots.reserve(capacity);
+    freeSlots.insert(freeSlots.begin(), capacity - oldCapacity, 0);
+    for (size_t i = 0; i < capacity - oldCapacity; i++) {
+        freeSlots[i] = static_cast<uint16_t>(capacity - 1 - i);
+    }
+}
+
+BodyId BodyStore::add(Real px, Real py, Real pvx, Real pvy, Real pgm, float pradius, uint16_t pcolor) {
+    if (freeSlots.empty()) {
+        return INVALID_ID;
+    }
+    uint16_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    slotIndex[slot] = static_cast<uint16_t>(x.size());
+
+    x.push_back(px);
+    y.push_back(py);
+    vx.push_back(pvx);
+    vy.push_back(pvy);
+    prevX.push_back(px);
+    prevY.push_back(py);
+    gm.push_back(pgm);
+    radius.push_back(pradius);
+    color.push_back(pcolor);
+    id.push_back((static_cast<BodyId>(slotGeneration[slot]) << 16) | slot);
+    serial.push_back(nextSerial++);
+    return id.back();
+}
+
+void BodyStore::remove(size_t index) {
+    // Free the slot; the generation bump invalidates IDs still held elsewhere
+    uint16_t slot = id[index] & 0xFFFF;
+    slotIndex[slot] = FREE_SLOT;
+    slotGeneration[slot]++;
+    freeSlots.push_back(slot);
+
+    // Move the last planet into the hole
+    size_t last = x.size() - 1;
+    if (index != last) {
+        x[index] = x[last];
+        y[index] = y[last];
+        vx[index] = vx[last];
+        vy[index] = vy[last];
+        prevX[index] = prevX[last];
+        prevY[index] = prevY[last];
+        gm[index] = gm[last];
+        radius[index] = radius[last];
+        color[index] = color[last];
+        id[index] = id[last];
+        serial[index] = serial[last];
+        slotIndex[id[index] & 0xFFFF] = static_cast<uint16_t>(index);
+    }
+    x.pop_back();
+    y.pop_back();
+    vx.pop_back();
+    vy.pop_back();
+    prevX.pop_back();
+    prevY.pop_back();
+    gm.pop_back();
+    radius.pop_back();
+    color.pop_back();
+    id.pop_back();
+    serial.pop_back();
+}
+
+void BodyStore::clear() {
+    while (!x.empty()) {
+        remove(x.size() - 1);
+    }
+}
+
+int BodyStore::indexOf(BodyId bodyId) const {
+    uint32_t slot = bodyId & 0xFFFF;
+    if (slot >= slotIndex.size() || slotIndex[slot] == FREE_SLOT ||
+        slotGeneration[slot] != (bodyId >> 16)) {
+        return -1;
+    }
+    return slotIndex[slot];
+}
+
+size_t BodyStore::oldest() const {
+    size_t result = 0;
+    for (size_t i = 1; i < serial.size(); i++) {
+        if (static_cast<int32_t>(serial[i] - serial[result]) < 0) {  // Wrap-safe comparison
+            result = i;
+        }
+    }
+    return result;
+}
+
+uint32_t BodyStore::checksum() const {
+    uint32_t hash = 2166136261U;
+    hash = hashArray(hash, x);
+    hash = hashArray(hash, y);
+    hash = hashArray(hash, vx);
+    hash = hashArray(hash, vy);
+    hash = hashArray(hash, gm);
+    hash = hashArray(hash, radius);
+    hash = hashArray(hash, color);
+    hash = hashArray(hash, id);
+    return hash;
+}
+
+void BodyStore::saveState(StateWriter& writer) const {
+    writer.writeArray(x);
+    writer.writeArray(y);
+    writer.writeArray(vx);
+    writer.writeArray(vy);
+    writer.writeArray(prevX);
+    writer.writeArray(prevY);
+    writer.writeArray(gm);
+    writer.writeArray(radius);
+    writer.writeArray(color);
+    writer.writeArray(id);
+    writer.writeArray(serial);
+    writer.writeArray(slotIndex);
+    writer.writeArray(slotGeneration);
+    writer.writeArray(freeSlots);
+    writer.write(nextSerial);
+}
+
+bool BodyStore::loadState(StateReader& reader, size_t maxCount) {
+    // Each array is read straight into place (the slot table may have grown for a larger solver before)
+    reader.readArray(x, maxCount);
+    reader.readArray(y, maxCount);
+    reader.readArray(vx, maxCount);
+    reader.readArray(vy, maxCount);
+    reader.readArray(prevX, maxCount);
+    reader.readArray(prevY, maxCount);
+    reader.readArray(gm, maxCount);
+    reader.readArray(radius, maxCount);
+    reader.readArray(color, maxCount);
+    reader.readArray(id, maxCount);
+    reader.readArray(serial, maxCount);
+    reader.readArray(slotIndex, MAX_SLOTS);
+    reader.readArray(slotGeneration, MAX_SLOTS);
+    reader.readArray(freeSlots, MAX_SLOTS);
+    reader.read(nextSerial);
+
+    // Every array must describe the same planets, and the slot table must map their IDs back
+    size_t count = x.size();
+    bool valid = reader.ok() &&
+        y.size() == count && vx.size() == count && vy.size() == count &&
+        prevX.size() == count && prevY.size() == count && gm.size() == count &&
+        radius.size() == count && color.size() == count && id.size() == count && serial.size() == count &&
+        slotGeneration.size() == slotIndex.size() && freeSlots.size() + count == slotIndex.size();
+    for (size_t i = 0; valid && i < count; i++) {
+        uint32_t slot = id[i] & 0xFFFF;
+        valid = slot < slotIndex.size() && slotIndex[slot] == i && slotGeneration[slot] == (id[i] >> 16);
+    }
+
+    // The other slots must each be on the free stack exactly once
+    std::vector<bool> listed(slotIndex.size(), false);
+    for (size_t i = 0; valid && i < freeSlots.size(); i++) {
+        uint16_t slot = freeSlots[i];
+        valid = slot < slotIndex.size() && slotIndex[slot] == FREE_SLOT && !listed[slot];
+        if (valid) {
+            listed[slot] = true;
+        }
+    }
+    if (!valid) {
+        *this = BodyStore();
+        return false;
+    }
+
+    // Restore the reserved capacity so adding planets does not reallocate
+    reserve(slotIndex.size());
+    return true;
+}
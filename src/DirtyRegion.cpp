@@ -0,0 +1,123 @@
+#include "DirtyRegion.h"
+
+namespace {
+    /**
+     * Bounding box of two rectangles
+     */
+    DirtyRect combine(const DirtyRect& a, const DirtyRect& b) {
+        DirtyRect result;
+        result.left = a.left < b.left ? a.left : b.left;
+        result.top = a.top < b.top ? a.top : b.top;
+        result.right = a.right > b.right ? a.right : b.right;
+        result.bottom = a.bottom > b.bottom ? a.bottom : b.bottom;
+        return result;
+    }
+
+    /**
+     * Whether two rectangles overlap or touch
+     */
+    bool touches(const DirtyRect& a, const DirtyRect& b) {
+        return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+    }
+}
+
+DirtyRegion::DirtyRegion(int width, int height)
+    : width(width), height(height), count(0) {
+}
+
+void DirtyRegion::setBounds(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    count = 0;
+}
+
+void DirtyRegion::clear() {
+    count = 0;
+}
+
+void DirtyRegion::add(int x, int y, int w, int h) {
+    // Clip to the screen
+    DirtyRect rect = {x, y, x + w, y + h};
+    if (rect.left < 0) rect.left = 0;
+    if (rect.top < 0) rect.top = 0;
+    if (rect.right > width) rect.right = width;
+    if (rect.bottom > height) rect.bottom = height;
+    if (rect.left >= rect.right || rect.top >= rect.bottom) {
+        return;  // Off screen
+    }
+    insert(rect);
+}
+
+void DirtyRegion::addCircle(int x, int y, int radius) {
+    add(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
+}
+
+void DirtyRegion::addLine(int x0, int y0, int x1, int y1, int margin) {
+    int left = (x0 < x1 ? x0 : x1) - margin;
+    int top = (y0 < y1 ? y0 : y1) - margin;
+    int right = (x0 > x1 ? x0 : x1) + margin;
+    int bottom = (y0 > y1 ? y0 : y1) + margin;
+    add(left, top, right - left + 1, bottom - top + 1);
+}
+
+void DirtyRegion::add(const DirtyRegion& other) {
+    for (int i = 0; i < other.count; i++) {
+        insert(other.rects[i]);
+    }
+}
+
+void DirtyRegion::addAll() {
+    count = 0;
+    add(0, 0, width, height);
+}
+
+void DirtyRegion::insert(DirtyRect rect) {
+    // Absorb every rectangle the new one touches (repeat, since the box grows)
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < count; i++) {
+            if (touches(rects[i], rect)) {
+                rect = combine(rects[i], rect);
+                rects[i] = rects[--count];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (count < RenderConstants::MAX_DIRTY_RECTS) {
+        rects[count++] = rect;
+        return;
+    }
+
+    // Full: merge into the rectangle whose bounding box grows the least
+    int best = 0;
+    int bestGrowth = combine(rects[0], rect).area() - rects[0].area();
+    for (int i = 1; i < count; i++) {
+        int growth = combine(rects[i], rect).area() - rects[i].area();
+        if (growth < bestGrowth) {
+            best = i;
+            bestGrowth = growth;
+        }
+    }
+    rect = combine(rects[best], rect);
+    rects[best] = rects[--count];
+    insert(rect);
+}
+
+int DirtyRegion::getCount() const {
+    return count;
+}
+
+const DirtyRect& DirtyRegion::getRect(int index) const {
+    return rects[index];
+}
+
+int DirtyRegion::getArea() const {
+    int area = 0;
+    for (int i = 0; i < count; i++) {
+        area += rects[i].area();
+    }
+    return area;
+}
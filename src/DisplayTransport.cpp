@@ -0,0 +1,142 @@
+#include "DisplayTransport.h"
+#if !defined(ARDUINO)
+#include <chrono>
+#include <thread>
+#endif
+
+DisplayTransport::DisplayTransport(hal::Display& display)
+    : display(display), source(nullptr), waitMicros(0), transferCount(0)
+#if !defined(ARDUINO)
+      , startMicros(0), durationMicros(0), checksum(0), transferMicros(0), tornCount(0)
+#endif
+{
+}
+
+bool DisplayTransport::isFree(const hal::Canvas& canvas) {
+    return source != &canvas || !isBusy();
+}
+
+#if defined(ARDUINO)
+
+void DisplayTransport::push(hal::Canvas& canvas, const DirtyRegion& region) {
+    wait();
+    source = &canvas;
+    transferCount++;
+
+    // The bus stays held until the fence; each clipped rectangle is queued as DMA from the sprite
+    const lgfx::swap565_t* pixels = static_cast<const lgfx::swap565_t*>(canvas.getBuffer());
+    display.startWrite();
+    for (int i = 0; i < region.getCount(); i++) {
+        const DirtyRect& rect = region.getRect(i);
+        display.setClipRect(rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top);
+        display.pushImageDMA(0, 0, canvas.width(), canvas.height(), pixels);
+    }
+    display.clearClipRect();
+}
+
+bool DisplayTransport::isBusy() {
+    if (source == nullptr) {
+        return false;
+    }
+    if (display.dmaBusy()) {
+        return true;
+    }
+    complete();
+    return false;
+}
+
+void DisplayTransport::wait() {
+    if (source == nullptr) {
+        return;
+    }
+    uint32_t start = hal::micros();
+    display.waitDMA();
+    waitMicros += static_cast<uint32_t>(hal::micros()) - start;
+    complete();
+}
+
+void DisplayTransport::complete() {
+    display.endWrite();
+    source = nullptr;
+}
+
+#else
+
+void DisplayTransport::push(hal::Canvas& canvas, const DirtyRegion& region) {
+    wait();
+    source = &canvas;
+    pending = region;
+    transferCount++;
+
+    // The link is busy for as long as the pixels take to send
+    uint64_t nanos = static_cast<uint64_t>(region.getArea()) * display.getTransferNanos();
+    durationMicros = static_cast<uint32_t>(nanos / 1000);
+    transferMicros += durationMicros;
+    startMicros = hal::micros();
+    if (durationMicros == 0) {
+        complete();
+        return;
+    }
+    checksum = checksumPending();
+}
+
+bool DisplayTransport::isBusy() {
+    if (source == nullptr) {
+        return false;
+    }
+    if (static_cast<uint32_t>(hal::micros()) - startMicros < durationMicros) {
+        return true;
+    }
+    complete();
+    return false;
+}
+
+void DisplayTransport::wait() {
+    if (source == nullptr) {
+        return;
+    }
+    uint32_t start = hal::micros();
+    uint32_t elapsed = start - startMicros;
+    if (elapsed < durationMicros) {
+        std::this_thread::sleep_for(std::chrono::microseconds(durationMicros - elapsed));
+    }
+    waitMicros += static_cast<uint32_t>(hal::micros()) - start;
+    complete();
+}
+
+void DisplayTransport::complete() {
+    // A sprite drawn into before its fence would have sent a mix of two frames
+    if (durationMicros > 0 && checksumPending() != checksum) {
+        tornCount++;
+    }
+
+    // The pixels reach the panel only now
+    const uint16_t* pixels = static_cast<const uint16_t*>(source->getBuffer());
+    display.startWrite();
+    for (int i = 0; i < pending.getCount(); i++) {
+        const DirtyRect& rect = pending.getRect(i);
+        display.setClipRect(rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top);
+        display.pushImage(0, 0, source->width(), source->height(), pixels);
+    }
+    display.clearClipRect();
+    display.endWrite();
+    source = nullptr;
+}
+
+uint32_t DisplayTransport::checksumPending() const {
+    const uint16_t* pixels = static_cast<const uint16_t*>(source->getBuffer());
+    int width = source->width();
+    uint32_t sum = 0;
+    for (int i = 0; i < pending.getCount(); i++) {
+        const DirtyRect& rect = pending.getRect(i);
+        for (int y = rect.top; y < rect.bottom; y++) {
+            const uint16_t* row = pixels + static_cast<size_t>(y) * width;
+            for (int x = rect.left; x < rect.right; x++) {
+                sum = sum * 31 + row[x];
+            }
+        }
+    }
+    return sum;
+}
+
+#endif
@@ -0,0 +1,203 @@
+#if !defined(ARDUINO)
+
+#include "FrameBufferCanvas.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+FrameBufferDisplay::FrameBufferDisplay(int width, int height)
+    : screenWidth(width), screenHeight(height),
+      clipLeft(0), clipTop(0), clipRight(width), clipBottom(height),
+      pixels(static_cast<size_t>(width) * height, TFT_BLACK),
+      pushedPixels(0), transferNanos(0) {
+}
+
+void FrameBufferDisplay::setClipRect(int x, int y, int w, int h) {
+    clipLeft = std::max(x, 0);
+    clipTop = std::max(y, 0);
+    clipRight = std::min(x + w, screenWidth);
+    clipBottom = std::min(y + h, screenHeight);
+}
+
+void FrameBufferDisplay::clearClipRect() {
+    clipLeft = 0;
+    clipTop = 0;
+    clipRight = screenWidth;
+    clipBottom = screenHeight;
+}
+
+void FrameBufferDisplay::pushImage(int x, int y, int w, int h, const uint16_t* image) {
+    int left = std::max(x, clipLeft);
+    int top = std::max(y, clipTop);
+    int right = std::min(x + w, clipRight);
+    int bottom = std::min(y + h, clipBottom);
+    if (left >= right || top >= bottom) {
+        return;
+    }
+    for (int row = top; row < bottom; row++) {
+        const uint16_t* source = image + static_cast<size_t>(row - y) * w + (left - x);
+        std::copy(source, source + (right - left), pixels.begin() + static_cast<size_t>(row) * screenWidth + left);
+    }
+    pushedPixels += static_cast<uint64_t>(right - left) * (bottom - top);
+}
+
+FrameBufferCanvas::FrameBufferCanvas(FrameBufferDisplay* parent)
+    : parent(parent), spriteWidth(0), spriteHeight(0),
+      cursorX(0), cursorY(0), textColor(TFT_WHITE) {
+}
+
+void* FrameBufferCanvas::createSprite(int w, int h) {
+    spriteWidth = w;
+    spriteHeight = h;
+    pixels.assign(static_cast<size_t>(w) * h, TFT_BLACK);
+    return pixels.data();
+}
+
+void FrameBufferCanvas::fillScreen(uint16_t color) {
+    std::fill(pixels.begin(), pixels.end(), color);
+}
+
+void FrameBufferCanvas::drawPixel(int x, int y, uint16_t color) {
+    if (x < 0 || y < 0 || x >= spriteWidth || y >= spriteHeight) {
+        return;
+    }
+    pixels[static_cast<size_t>(y) * spriteWidth + x] = color;
+}
+
+void FrameBufferCanvas::drawSpan(int x0, int x1, int y, uint16_t color) {
+    if (y < 0 || y >= spriteHeight) {
+        return;
+    }
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, spriteWidth - 1);
+    if (x0 > x1) {
+        return;
+    }
+    auto row = pixels.begin() + static_cast<size_t>(y) * spriteWidth;
+    std::fill(row + x0, row + x1 + 1, color);
+}
+
+void FrameBufferCanvas::fillRect(int x, int y, int w, int h, uint16_t color) {
+    for (int row = y; row < y + h; row++) {
+        drawSpan(x, x + w - 1, row, color);
+    }
+}
+
+void FrameBufferCanvas::drawCircle(int x, int y, int r, uint16_t color) {
+    // Midpoint circle, one point per octant per iteration
+    int f = 1 - r;
+    int ddFx = 1;
+    int ddFy = -2 * r;
+    int px = 0;
+    int py = r;
+    drawPixel(x, y + r, color);
+    drawPixel(x, y - r, color);
+    drawPixel(x + r, y, color);
+    drawPixel(x - r, y, color);
+    while (px < py) {
+        if (f >= 0) {
+            py--;
+            ddFy += 2;
+            f += ddFy;
+        }
+        px++;
+        ddFx += 2;
+        f += ddFx;
+        drawPixel(x + px, y + py, color);
+        drawPixel(x - px, y + py, color);
+        drawPixel(x + px, y - py, color);
+        drawPixel(x - px, y - py, color);
+        drawPixel(x + py, y + px, color);
+        drawPixel(x - py, y + px, color);
+        drawPixel(x + py, y - px, color);
+        drawPixel(x - py, y - px, color);
+    }
+}
+
+void FrameBufferCanvas::fillCircle(int x, int y, int r, uint16_t color) {
+    // Midpoint circle filled with horizontal spans
+    drawSpan(x - r, x + r, y, color);
+    int f = 1 - r;
+    int ddFx = 1;
+    int ddFy = -2 * r;
+    int px = 0;
+    int py = r;
+    while (px < py) {
+        if (f >= 0) {
+            py--;
+            ddFy += 2;
+            f += ddFy;
+        }
+        px++;
+        ddFx += 2;
+        f += ddFx;
+        drawSpan(x - py, x + py, y + px, color);
+        drawSpan(x - py, x + py, y - px, color);
+        drawSpan(x - px, x + px, y + py, color);
+        drawSpan(x - px, x + px, y - py, color);
+    }
+}
+
+void FrameBufferCanvas::drawLine(int x0, int y0, int x1, int y1, uint16_t color) {
+    // Bresenham
+    int dx = std::abs(x1 - x0);
+    int dy = -std::abs(y1 - y0);
+    int stepX = x0 < x1 ? 1 : -1;
+    int stepY = y0 < y1 ? 1 : -1;
+    int error = dx + dy;
+    while (true) {
+        drawPixel(x0, y0, color);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int error2 = 2 * error;
+        if (error2 >= dy) {
+            error += dy;
+            x0 += stepX;
+        }
+        if (error2 <= dx) {
+            error += dx;
+            y0 += stepY;
+        }
+    }
+}
+
+void FrameBufferCanvas::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color) {
+    // Sort vertices by Y (y0 <= y1 <= y2)
+    if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+    if (y1 > y2) { std::swap(y1, y2); std::swap(x1, x2); }
+    if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+
+    if (y0 == y2) {
+        drawSpan(std::min(std::min(x0, x1), x2), std::max(std::max(x0, x1), x2), y0, color);
+        return;
+    }
+
+    // Walk the long edge (0-2) against the short edges (0-1, then 1-2), one span per row
+    for (int y = y0; y <= y2; y++) {
+        int a = x0 + (x2 - x0) * (y - y0) / (y2 - y0);
+        int b;
+        if (y < y1) {
+            b = x0 + (x1 - x0) * (y - y0) / (y1 - y0);
+        } else if (y2 != y1) {
+            b = x1 + (x2 - x1) * (y - y1) / (y2 - y1);
+        } else {
+            b = x1;
+        }
+        drawSpan(std::min(a, b), std::max(a, b), y, color);
+    }
+}
+
+void FrameBufferCanvas::print(const char* text) {
+    cursorX += textWidth(text);
+}
+
+int FrameBufferCanvas::textWidth(const char* text) const {
+    return static_cast<int>(strlen(text)) * FONT_WIDTH;
+}
+
+void FrameBufferCanvas::pushSprite(int x, int y) {
+    parent->pushImage(x, y, spriteWidth, spriteHeight, pixels.data());
+}
+
+#endif
@@ -0,0 +1,163 @@
+#if !defined(ARDUINO)
+
+#include "Hal.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace {
+    // Resolution of the M5Stack Core2 display
+    constexpr int DISPLAY_WIDTH = 320;
+    constexpr int DISPLAY_HEIGHT = 240;
+
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::minstd_rand generator;                      // Render-side RNG (seeded by randomSeed)
+    std::atomic<uint32_t> toneCount(0);              // Tones played so far
+    hal::TouchPoint touchState = {false, false, 0, 0};  // Touch state reported by readTouch (render loop only)
+    bool buttonPresses[3] = {false, false, false};      // Presses not yet reported by wasButtonPressed (render loop only)
+    double serialQueued = 0.0;                          // Bytes in the modeled serial transmit buffer
+    uint32_t serialDrainMicros = 0;                     // Time the modeled buffer was last drained
+    FILE* serialOutput = nullptr;                       // Serial output (nullptr = stdout)
+
+    /**
+     * Drain the modeled serial transmit buffer at the line rate (10 bits per byte)
+     */
+    void drainSerial() {
+        uint32_t now = hal::micros();
+        serialQueued = std::max(0.0, serialQueued - (now - serialDrainMicros) * (hal::SERIAL_BAUD_RATE / 10.0 / 1e6));
+        serialDrainMicros = now;
+    }
+}
+
+namespace hal {
+    uint32_t millis() {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    uint32_t micros() {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    void delay(uint32_t ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+
+    void sleepUntil(uint32_t deadlineMicros) {
+        int32_t remaining = static_cast<int32_t>(deadlineMicros - micros());
+        if (remaining > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(remaining));
+        }
+    }
+
+    long random(long max) {
+        if (max <= 0) {
+            return 0;
+        }
+        return static_cast<long>(generator() % static_cast<unsigned long>(max));
+    }
+
+    long random(long min, long max) {
+        if (min >= max) {
+            return min;
+        }
+        return min + random(max - min);
+    }
+
+    void randomSeed(uint32_t seed) {
+        generator.seed(seed);
+    }
+
+    void setVolume(uint8_t volume) {
+        (void)volume;
+    }
+
+    void tone(float frequency, uint32_t durationMs) {
+        (void)frequency;
+        (void)durationMs;
+        toneCount++;
+    }
+
+    uint32_t getToneCount() {
+        return toneCount;
+    }
+
+    TouchPoint readTouch() {
+        return touchState;
+    }
+
+    void setTouch(const TouchPoint& touch) {
+        touchState = touch;
+    }
+
+    bool wasButtonPressed(Button button) {
+        bool& pressed = buttonPresses[static_cast<int>(button)];
+        bool result = pressed;
+        pressed = false;
+        return result;
+    }
+
+    bool isButtonPressed(Button button) {
+        (void)button;
+        return false;
+    }
+
+    void pressButton(Button button) {
+        buttonPresses[static_cast<int>(button)] = true;
+    }
+
+    void print(const char* text) {
+        fputs(text, serialOutput != nullptr ? serialOutput : stdout);
+        drainSerial();
+        serialQueued += strlen(text);
+    }
+
+    int readSerial() {
+        return -1;
+    }
+
+    size_t serialWritable() {
+        drainSerial();
+        return serialQueued < SERIAL_TX_BUFFER_SIZE ? SERIAL_TX_BUFFER_SIZE - static_cast<size_t>(serialQueued) : 0;
+    }
+
+    void writeSerial(const uint8_t* data, size_t size) {
+        fwrite(data, 1, size, serialOutput != nullptr ? serialOutput : stdout);
+        drainSerial();
+        serialQueued += size;
+    }
+
+    void setSerialOutput(FILE* file) {
+        serialOutput = file;
+    }
+
+    bool beginStorage() {
+        return true;
+    }
+
+    FILE* openFile(const char* name, const char* mode) {
+        return fopen(name, mode);
+    }
+
+    bool renameFile(const char* from, const char* to) {
+        return rename(from, to) == 0;
+    }
+
+    void begin() {
+    }
+
+    void update() {
+    }
+
+    Display& getDisplay() {
+        static Display display(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        return display;
+    }
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include "InputLog.h"
+#include <cstring>
+
+namespace {
+    const char MAGIC[4] = {'G', 'S', 'I', 'N'};  // File signature
+    constexpr uint16_t VERSION = 3;               // Format version (3: scalar type and pairwise kernel)
+    constexpr size_t HEADER_SIZE = 24;            // Magic, version, solver, integrator, seed, time step, flags,
+                                                  // scalar type and size, pairwise kernel
+    constexpr uint8_t FLAG_START_STATE = 0x01;    // A StateFile follows the header
+    constexpr uint8_t FLAG_FAST_MATH = 0x02;      // Recorded by a build with -ffast-math
+
+    // Floating-point options of this build that change rounding
+#if defined(__FAST_MATH__)
+    constexpr bool FAST_MATH = true;
+#else
+    constexpr bool FAST_MATH = false;
+#endif
+    constexpr size_t EVENT_SIZE = 9;              // Step, type, value
+
+    void putU16(uint8_t* bytes, uint16_t value) {
+        bytes[0] = static_cast<uint8_t>(value);
+        bytes[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void putU32(uint8_t* bytes, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint16_t getU16(const uint8_t* bytes) {
+        return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+    }
+
+    uint32_t getU32(const uint8_t* bytes) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t packPoint(int x, int y) {
+        return static_cast<uint16_t>(x) | (static_cast<uint32_t>(static_cast<uint16_t>(y)) << 16);
+    }
+}
+
+InputRecorder::InputRecorder()
+    : file(nullptr), nextCheckpointStep(0), lastCheckpointStep(0) {
+}
+
+InputRecorder::~InputRecorder() {
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+bool InputRecorder::open(const char* name, uint32_t seed, const PhysicsEngine& engine, SimulationPipeline& pipeline,
+                         const StateFile* startState) {
+    file = hal::openFile(name, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    uint64_t timeStepBits;
+    double timeStep = engine.getTimeStep();
+    memcpy(&timeStepBits, &timeStep, sizeof(timeStepBits));
+
+    uint8_t bytes[HEADER_SIZE];
+    memcpy(bytes, MAGIC, sizeof(MAGIC));
+    putU16(bytes + 4, VERSION);
+    bytes[6] = static_cast<uint8_t>(engine.getForceSolver());
+    bytes[7] = static_cast<uint8_t>(engine.getIntegrator());
+    putU32(bytes + 8, seed);
+    putU32(bytes + 12, static_cast<uint32_t>(timeStepBits));
+    putU32(bytes + 16, static_cast<uint32_t>(timeStepBits >> 32));
+    bytes[20] = (startState != nullptr ? FLAG_START_STATE : 0) | (FAST_MATH ? FLAG_FAST_MATH : 0);
+    bytes[21] = REAL_TYPE_ID;
+    bytes[22] = static_cast<uint8_t>(sizeof(Real));
+    bytes[23] = static_cast<uint8_t>(engine.getPairwiseKernel());
+    fwrite(bytes, 1, sizeof(bytes), file);
+    if (startState != nullptr && !startState->write(file)) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    fflush(file);
+
+    nextCheckpointStep = InputLogConstants::CHECKPOINT_STEPS;
+    lastCheckpointStep = 0;
+    pipeline.setReportingSpawns(true);
+    return true;
+}
+
+void InputRecorder::update(SimulationPipeline& pipeline) {
+    if (file == nullptr) {
+        return;
+    }
+    bool wrote = false;
+
+    // Every gesture that added a planet: pressed where the touch began, released when applied
+    PlanetSpawn spawn;
+    while (pipeline.takeAppliedSpawn(spawn)) {
+        InputEvent begin = {spawn.touchStartStep, InputEventType::TOUCH_BEGIN,
+                            packPoint(spawn.touchStartX, spawn.touchStartY)};
+        InputEvent end = {spawn.appliedStep, InputEventType::TOUCH_END,
+                          packPoint(spawn.touchEndX, spawn.touchEndY)};
+        write(begin);
+        write(end);
+        wrote = true;
+    }
+
+    // The acquired snapshot already contains every gesture applied before its step
+    const SimulationSnapshot& snapshot = pipeline.getSnapshot();
+    if (snapshot.step >= nextCheckpointStep) {
+        writeCheckpoint(snapshot);
+        wrote = true;
+    }
+
+    // Flush right away, since the device is usually switched off rather than shut down
+    if (wrote) {
+        fflush(file);
+    }
+}
+
+void InputRecorder::close(SimulationPipeline& pipeline) {
+    if (file == nullptr) {
+        return;
+    }
+    update(pipeline);
+    const SimulationSnapshot& snapshot = pipeline.getSnapshot();
+    if (snapshot.step != lastCheckpointStep) {
+        writeCheckpoint(snapshot);
+    }
+    fclose(file);
+    file = nullptr;
+}
+
+bool InputRecorder::isOpen() const {
+    return file != nullptr;
+}
+
+void InputRecorder::write(const InputEvent& event) {
+    uint8_t bytes[EVENT_SIZE];
+    putU32(bytes, event.step);
+    bytes[4] = static_cast<uint8_t>(event.type);
+    putU32(bytes + 5, event.value);
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+void InputRecorder::writeCheckpoint(const SimulationSnapshot& snapshot) {
+    InputEvent checkpoint = {snapshot.step, InputEventType::CHECKPOINT, snapshot.bodies.checksum()};
+    write(checkpoint);
+    lastCheckpointStep = snapshot.step;
+    nextCheckpointStep = snapshot.step + InputLogConstants::CHECKPOINT_STEPS;
+}
+
+InputReplay::InputReplay()
+    : loaded(false),
+      header{0, ForceSolver::PAIRWISE, Integrator::BLOCK_LEAPFROG, 0.0, false, PairwiseKernel::SYMMETRIC, false},
+      nextEvent(0), touch{false, false, 0, 0},
+      matched(0), mismatched(0), uncompared(0), started(false), startMillis(0), startStep(0) {
+}
+
+bool InputReplay::open(const char* name, StateFile* state) {
+    FILE* file = hal::openFile(name, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    uint8_t bytes[HEADER_SIZE];
+    if (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes) ||
+        memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0 || getU16(bytes + 4) != VERSION) {
+        fclose(file);
+        return false;
+    }
+    if (bytes[21] != REAL_TYPE_ID || bytes[22] != sizeof(Real)) {
+        hal::print("replay: recorded with another scalar type\n");
+        fclose(file);
+        return false;
+    }
+    uint64_t timeStepBits = getU32(bytes + 12) | (static_cast<uint64_t>(getU32(bytes + 16)) << 32);
+    header.forceSolver = static_cast<ForceSolver>(bytes[6]);
+    header.integrator = static_cast<Integrator>(bytes[7]);
+    header.seed = getU32(bytes + 8);
+    memcpy(&header.timeStep, &timeStepBits, sizeof(header.timeStep));
+    header.startsFromState = (bytes[20] & FLAG_START_STATE) != 0;
+    header.fastMath = (bytes[20] & FLAG_FAST_MATH) != 0;
+    header.pairwiseKernel = static_cast<PairwiseKernel>(bytes[23]);
+
+    // A session that was resumed starts from the state it was resumed with
+    if (header.startsFromState && (state == nullptr || !state->read(file))) {
+        fclose(file);
+        return false;
+    }
+
+    // A truncated last event (power loss while writing) is dropped
+    events.clear();
+    uint8_t record[EVENT_SIZE];
+    while (fread(record, 1, sizeof(record), file) == sizeof(record)) {
+        InputEvent event = {getU32(record), static_cast<InputEventType>(record[4]), getU32(record + 5)};
+        events.push_back(event);
+    }
+    fclose(file);
+
+    nextEvent = 0;
+    loaded = true;
+    return true;
+}
+
+bool InputReplay::isOpen() const {
+    return loaded;
+}
+
+const InputLogHeader& InputReplay::getHeader() const {
+    return header;
+}
+
+bool InputReplay::configure(PhysicsEngine& engine) {
+    if (!header.startsFromState) {
+        engine.setForceSolver(header.forceSolver);
+        engine.setIntegrator(header.integrator);
+        engine.setTimeStep(header.timeStep);
+    }
+    if (!engine.setPairwiseKernel(header.pairwiseKernel)) {
+        hal::print("replay: the recorded pairwise kernel is not available\n");
+        loaded = false;
+        return false;
+    }
+    if (header.fastMath != FAST_MATH) {
+        hal::print("replay: recorded with other floating-point options, checkpoints are not compared\n");
+    }
+    return true;
+}
+
+bool InputReplay::feed(const PhysicsEngine& engine, TouchHandler& touchHandler) {
+    uint32_t step = engine.getStepCount();
+    if (!started) {
+        started = true;
+        startMillis = hal::millis();
+        startStep = step;
+    }
+
+    bool delivered = false;
+    while (nextEvent < events.size() && events[nextEvent].step <= step) {
+        const InputEvent& event = events[nextEvent++];
+        delivered = true;
+        if (event.type == InputEventType::CHECKPOINT) {
+            // A checkpoint is only meaningful at exactly its step, on a build that rounds the same
+            if (header.fastMath != FAST_MATH) {
+                uncompared++;
+            } else if (event.step == step && event.value == engine.getBodies().checksum()) {
+                matched++;
+            } else {
+                mismatched++;
+            }
+            continue;
+        }
+        touch.touched = event.type == InputEventType::TOUCH_BEGIN;
+        touch.pressed = touch.touched;
+        touch.x = static_cast<int16_t>(event.value & 0xFFFF);
+        touch.y = static_cast<int16_t>(event.value >> 16);
+        touchHandler.update(touch);
+    }
+
+    if (delivered && isFinished()) {
+        report(step);
+    }
+    return touchHandler.update(touch);
+}
+
+bool InputReplay::isFinished() const {
+    return nextEvent >= events.size();
+}
+
+uint32_t InputReplay::getMismatchCount() const {
+    return mismatched;
+}
+
+void InputReplay::report(uint32_t step) const {
+    char line[128];
+    snprintf(line, sizeof(line), "replay: %lu/%lu checkpoints matched (%lu not compared), %lu steps in %lu ms\n",
+             static_cast<unsigned long>(matched), static_cast<unsigned long>(matched + mismatched),
+             static_cast<unsigned long>(uncompared), static_cast<unsigned long>(step - startStep),
+             static_cast<unsigned long>(hal::millis() - startMillis));
+    hal::print(line);
+}
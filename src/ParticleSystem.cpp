@@ -0,0 +1,99 @@
+#include "ParticleSystem.h"
+#include "StateFile.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Golden angle (radians): consecutive table entries never line up, so any run of them covers the circle
+    const double GOLDEN_ANGLE = 2.399963229728653;
+    // Step of the speed sequence (plastic-number low-discrepancy sequence, independent of the angles)
+    const double SPEED_STEP = 0.7548776662466927;
+    // Spawn speeds range from 0.7x to 1.3x PARTICLE_SPEED
+    const double MIN_SPEED_FACTOR = 0.7;
+    const double SPEED_FACTOR_RANGE = 0.6;
+    // Spawn positions are clamped so a lifetime of motion stays inside the int16 range (+-512 pixels)
+    const double SPAWN_LIMIT = 400.0;
+}
+
+ParticleSystem::ParticleSystem(size_t capacity)
+    : capacity(capacity), tail(0), count(0), recycledCount(0),
+      x(capacity), y(capacity), vx(capacity), vy(capacity), color(capacity), life(capacity),
+      tableX(FireworkConstants::VELOCITY_TABLE_SIZE), tableY(FireworkConstants::VELOCITY_TABLE_SIZE) {
+    for (int k = 0; k < FireworkConstants::VELOCITY_TABLE_SIZE; k++) {
+        double angle = k * GOLDEN_ANGLE;
+        double speedFactor = MIN_SPEED_FACTOR + SPEED_FACTOR_RANGE * std::fmod(k * SPEED_STEP, 1.0);
+        double speed = FireworkConstants::PARTICLE_SPEED * speedFactor * ONE;
+        tableX[k] = static_cast<int16_t>(std::lround(speed * std::cos(angle)));
+        tableY[k] = static_cast<int16_t>(std::lround(speed * std::sin(angle)));
+    }
+}
+
+void ParticleSystem::spawn(double spawnX, double spawnY, uint16_t spawnColor, int spawnCount, uint32_t seed) {
+    int16_t fixedX = static_cast<int16_t>(std::max(-SPAWN_LIMIT, std::min(SPAWN_LIMIT, spawnX)) * ONE);
+    int16_t fixedY = static_cast<int16_t>(std::max(-SPAWN_LIMIT, std::min(SPAWN_LIMIT, spawnY)) * ONE);
+    for (int k = 0; k < spawnCount; k++) {
+        size_t i = allocate();
+        size_t entry = (seed + k) % FireworkConstants::VELOCITY_TABLE_SIZE;
+        x[i] = fixedX;
+        y[i] = fixedY;
+        vx[i] = tableX[entry];
+        vy[i] = tableY[entry];
+        color[i] = spawnColor;
+        life[i] = FireworkConstants::PARTICLE_LIFETIME;
+    }
+}
+
+size_t ParticleSystem::allocate() {
+    if (count == capacity) {
+        // Pool full: the oldest particle makes room
+        tail = tail + 1 == capacity ? 0 : tail + 1;
+        count--;
+        recycledCount++;
+    }
+    size_t slot = tail + count;
+    count++;
+    return slot < capacity ? slot : slot - capacity;
+}
+
+void ParticleSystem::clear() {
+    tail = 0;
+    count = 0;
+}
+
+void ParticleSystem::saveState(StateWriter& writer) const {
+    writer.write(static_cast<uint32_t>(count));
+    for (size_t k = 0; k < count; k++) {
+        size_t i = (tail + k) % capacity;
+        writer.write(x[i]);
+        writer.write(y[i]);
+        writer.write(vx[i]);
+        writer.write(vy[i]);
+        writer.write(color[i]);
+        writer.write(life[i]);
+    }
+}
+
+bool ParticleSystem::loadState(StateReader& reader) {
+    clear();
+    uint32_t savedCount = 0;
+    if (!reader.read(savedCount) || savedCount > capacity) {
+        return false;
+    }
+
+    // Stored oldest first, so lifetimes must not increase towards the head
+    uint8_t previousLife = 0;
+    for (uint32_t i = 0; i < savedCount; i++) {
+        reader.read(x[i]);
+        reader.read(y[i]);
+        reader.read(vx[i]);
+        reader.read(vy[i]);
+        reader.read(color[i]);
+        reader.read(life[i]);
+        if (!reader.ok() || life[i] == 0 || life[i] > FireworkConstants::PARTICLE_LIFETIME || life[i] < previousLife) {
+            return false;
+        }
+        previousLife = life[i];
+    }
+    count = savedCount;
+    return true;
+}
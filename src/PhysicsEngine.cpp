@@ -1,151 +1,885 @@
 #include "PhysicsEngine.h"
-#include "Renderer.h"
+#include "GravityKernel.h"
+#include "SimdGravity.h"
+#include "StateFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cmath>
 
-PhysicsEngine::PhysicsEngine(Renderer& renderer) 
-    : renderer(renderer),
-      lastTrailUpdateTime(0),
-      distanceScaleSquared(PhysicsConstants::DISTANCE_SCALE * PhysicsConstants::DISTANCE_SCALE),
+namespace {
+    // G * M of the sun in the engine's scalar type
+    const Real SUN_GM(StepUnits::SUN_GM);
+
+    // Yoshida 4th-order coefficients: w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 * w1
+    const double YOSHIDA_W1 = 1.0 / (2.0 - std::cbrt(2.0));
+    const double YOSHIDA_W0 = 1.0 - 2.0 * YOSHIDA_W1;
+}
+
+PhysicsEngine::PhysicsEngine() 
+    : forceSolver(ForceSolver::PAIRWISE),
+      planetLimit(0),
+      spatialGrid(CellListConstants::CELL_SIZE, CellListConstants::HALF_EXTENT),
+      threadPool(nullptr),
+      planetsReordered(true),
+      contactsReordered(true),
+      integrator(Integrator::BLOCK_LEAPFROG),
+      timeStep(IntegratorConstants::DEFAULT_TIME_STEP),
+      timeStepValue(IntegratorConstants::DEFAULT_TIME_STEP),
+      accelerationsValid(false),
+      stepCount(0),
+      simulationTime(0.0),
+      lastTrailSlot(0),
+      forceEvaluationCount(0),
+      conservationBaselineValid(false),
+      baselineEnergy(0.0),
+      baselineAngularMomentum(0.0),
+      baselineStep(0),
+      baselineForceEvaluations(0),
       collisionEffectActive(false),
       collisionEffectX(0),
       collisionEffectY(0),
-      collisionEffectStartTime(0) {
+      collisionEffectStartTime(0.0) {
     // Reserve space for maximum planets to avoid reallocation
-    planets.reserve(PlanetConstants::MAX_COUNT);
+    bodies.reserve(PlanetConstants::MAX_COUNT);
+    trails.reserve(PlanetConstants::MAX_COUNT);
     accelerationX.reserve(PlanetConstants::MAX_COUNT);
     accelerationY.reserve(PlanetConstants::MAX_COUNT);
+    stepLevels.reserve(PlanetConstants::MAX_COUNT);
+    activePlanets.reserve(PlanetConstants::MAX_COUNT);
+    mergeState.reserve(PlanetConstants::MAX_COUNT);
+    pendingEvents.reserve(PipelineConstants::MAX_PENDING_EVENTS);
+}
+
+BodyId PhysicsEngine::addPlanet(double x, double y, double vx, double vy, uint16_t color, double mass) {
+    // Make room by dropping the oldest planet
+    if (bodies.size() >= getMaxPlanetCount()) {
+        removePlanet(bodies.oldest());
+        trails.compact();
+    }
+    double gm = mass * StepUnits::GRAVITY;
+    BodyId id = bodies.add(Real(x), Real(y), Real(vx * StepUnits::VELOCITY), Real(vy * StepUnits::VELOCITY),
+                           Real(gm), Planet::radiusFor(gm), color);
+    if (id == BodyStore::INVALID_ID) {
+        return id;  // Every slot is in use: keep the trails in step with the bodies
+    }
+    trails.add(x, y);
+    planetsReordered = true;
+    contactsReordered = true;
+    accelerationsValid = false;
+    conservationBaselineValid = false;
+    return id;
+}
+
+void PhysicsEngine::removePlanet(size_t index) {
+    bodies.remove(index);
+    trails.remove(index);
+    planetsReordered = true;
+    contactsReordered = true;
+    accelerationsValid = false;
+    conservationBaselineValid = false;
+}
+
+void PhysicsEngine::compactPlanets() {
+    trails.compact();
+}
+
+void PhysicsEngine::setForceSolver(ForceSolver solver) {
+    forceSolver = solver;
+    
+    // Drop the oldest planets if the new solver supports fewer
+    size_t maxCount = getMaxPlanetCount();
+    while (bodies.size() > maxCount) {
+        removePlanet(bodies.oldest());
+    }
+    trails.compact();
+    
+    // Reserve space for maximum planets to avoid reallocation
+    bodies.reserve(maxCount);
+    trails.reserve(maxCount);
+    accelerationX.reserve(maxCount);
+    accelerationY.reserve(maxCount);
+    stepLevels.reserve(maxCount);
+    activePlanets.reserve(maxCount);
+    mergeState.reserve(maxCount);
+    accelerationsValid = false;
+}
+
+ForceSolver PhysicsEngine::getForceSolver() const {
+    return forceSolver;
+}
+
+void PhysicsEngine::setThreadPool(ThreadPool* pool) {
+    threadPool = pool;
+}
+
+PairwiseKernel PhysicsEngine::getPairwiseKernel() const {
+    // Mirrors the choice in calculatePlanetGravity
+    switch (SimdGravity::getInstructionSet()) {
+        case SimdGravity::InstructionSet::AVX2:
+            return PairwiseKernel::ROWS_AVX2;
+        case SimdGravity::InstructionSet::SSE2:
+            return PairwiseKernel::ROWS_SSE2;
+        default:
+            return threadPool != nullptr ? PairwiseKernel::ROWS : PairwiseKernel::SYMMETRIC;
+    }
+}
+
+bool PhysicsEngine::setPairwiseKernel(PairwiseKernel kernel) {
+    SimdGravity::InstructionSet set = SimdGravity::InstructionSet::SCALAR;
+    if (kernel == PairwiseKernel::ROWS_AVX2) {
+        set = SimdGravity::InstructionSet::AVX2;
+    } else if (kernel == PairwiseKernel::ROWS_SSE2) {
+        set = SimdGravity::InstructionSet::SSE2;
+    } else if (kernel == PairwiseKernel::ROWS && threadPool == nullptr) {
+        return false;
+    } else if (kernel != PairwiseKernel::ROWS && kernel != PairwiseKernel::SYMMETRIC) {
+        return false;
+    }
+    if (set > SimdGravity::detectInstructionSet()) {
+        return false;
+    }
+    SimdGravity::setInstructionSet(set);
+    if (kernel == PairwiseKernel::SYMMETRIC) {
+        threadPool = nullptr;
+    }
+    return true;
 }
 
-void PhysicsEngine::addPlanet(double x, double y, double vx, double vy, uint16_t color) {
-    planets.emplace_back(x, y, vx, vy, color);
-    if (planets.size() > PlanetConstants::MAX_COUNT) {
-        planets.erase(planets.begin());
+void PhysicsEngine::setIntegrator(Integrator newIntegrator) {
+    integrator = newIntegrator;
+    accelerationsValid = false;
+    conservationBaselineValid = false;
+}
+
+Integrator PhysicsEngine::getIntegrator() const {
+    return integrator;
+}
+
+void PhysicsEngine::setTimeStep(double newTimeStep) {
+    timeStep = Real(newTimeStep);
+    timeStepValue = newTimeStep;
+    conservationBaselineValid = false;
+}
+
+double PhysicsEngine::getTimeStep() const {
+    return timeStepValue;
+}
+
+void PhysicsEngine::setOpeningAngle(double theta) {
+    quadTree.setOpeningAngle(theta);
+}
+
+void PhysicsEngine::setPlanetLimit(size_t limit) {
+    // Apply the new limit like a solver change (dropping planets first if it shrank)
+    planetLimit = std::min<size_t>(limit, PlanetConstants::MAX_LIMIT);
+    setForceSolver(forceSolver);
+
+    // Every planet up to the limit gets the same trail length, within MAX_POOL_POINTS
+    int length = PlanetConstants::TRAIL_LENGTH;
+    if (planetLimit > 0) {
+        length = static_cast<int>(std::min<size_t>(length, TrailConstants::MAX_POOL_POINTS / planetLimit));
+    }
+    trails.setBudget(std::max<size_t>(TrailConstants::POOL_POINTS, planetLimit * length), length);
+}
+
+size_t PhysicsEngine::getMaxPlanetCount() const {
+    if (planetLimit > 0) {
+        return planetLimit;
+    }
+    switch (forceSolver) {
+        case ForceSolver::BARNES_HUT:
+            return BarnesHutConstants::MAX_PLANET_COUNT;
+        case ForceSolver::CELL_LIST:
+            return CellListConstants::MAX_PLANET_COUNT;
+        default:
+            return PlanetConstants::MAX_COUNT;
     }
 }
 
+void PhysicsEngine::saveState(StateWriter& writer) const {
+    writer.write(static_cast<uint8_t>(forceSolver));
+    writer.write(static_cast<uint8_t>(integrator));
+    writer.write(timeStepValue);
+    writer.write(stepCount);
+    writer.write(simulationTime);
+    writer.write(lastTrailSlot);
+    writer.write(forceEvaluationCount);
+    writer.write(static_cast<uint8_t>(accelerationsValid));
+    writer.write(static_cast<uint8_t>(collisionEffectActive));
+    writer.write(collisionEffectX);
+    writer.write(collisionEffectY);
+    writer.write(collisionEffectStartTime);
+    bodies.saveState(writer);
+    trails.saveState(writer);
+    writer.writeArray(accelerationX);
+    writer.writeArray(accelerationY);
+    writer.writeArray(stepLevels);
+}
+
+bool PhysicsEngine::loadState(StateReader& reader) {
+    uint8_t solver = 0;
+    uint8_t savedIntegrator = 0;
+    double savedTimeStep = 0.0;
+    uint8_t savedAccelerationsValid = 0;
+    uint8_t savedEffectActive = 0;
+    reader.read(solver);
+    reader.read(savedIntegrator);
+    reader.read(savedTimeStep);
+    reader.read(stepCount);
+    reader.read(simulationTime);
+    reader.read(lastTrailSlot);
+    reader.read(forceEvaluationCount);
+    reader.read(savedAccelerationsValid);
+    reader.read(savedEffectActive);
+    reader.read(collisionEffectX);
+    reader.read(collisionEffectY);
+    reader.read(collisionEffectStartTime);
+    bool valid = reader.ok() && solver <= static_cast<uint8_t>(ForceSolver::CELL_LIST) &&
+        savedIntegrator <= static_cast<uint8_t>(Integrator::BLOCK_LEAPFROG) && savedTimeStep > 0.0;
+
+    // Settings first: the solver decides the planet limit and reserves space for it
+    if (valid) {
+        bodies.clear();
+        trails.clear();
+        setForceSolver(static_cast<ForceSolver>(solver));
+        setIntegrator(static_cast<Integrator>(savedIntegrator));
+        setTimeStep(savedTimeStep);
+    }
+    size_t maxCount = getMaxPlanetCount();
+    valid = valid && bodies.loadState(reader, maxCount) && trails.loadState(reader, maxCount) &&
+        trails.size() == bodies.size() &&
+        reader.readArray(accelerationX, maxCount) && reader.readArray(accelerationY, maxCount) &&
+        reader.readArray(stepLevels, maxCount);
+    if (!valid) {
+        bodies = BodyStore();
+        bodies.reserve(maxCount);
+        trails.clear();
+        stepCount = 0;
+        simulationTime = 0.0;
+        lastTrailSlot = 0;
+        savedAccelerationsValid = 0;
+        savedEffectActive = 0;
+    }
+
+    // Caches are rebuilt on the next step; stale accelerations are recomputed
+    accelerationsValid = savedAccelerationsValid != 0 &&
+        accelerationX.size() == bodies.size() && accelerationY.size() == bodies.size();
+    collisionEffectActive = savedEffectActive != 0;
+    planetsReordered = true;
+    contactsReordered = true;
+    conservationBaselineValid = false;
+    pendingEvents.clear();
+    return valid;
+}
+
+ForceErrorReport PhysicsEngine::measureForceError() {
+    ForceErrorReport report = {bodies.size(), 0.0, 0.0};
+    if (bodies.size() < 2) {
+        return report;
+    }
+    
+    // Exact accelerations from the pairwise kernel
+    std::vector<Real> exactX(bodies.size(), Real(0));
+    std::vector<Real> exactY(bodies.size(), Real(0));
+    calculatePlanetGravity(exactX, exactY);
+    
+    // Accelerations from the selected solver
+    std::vector<Real> approxX(bodies.size(), Real(0));
+    std::vector<Real> approxY(bodies.size(), Real(0));
+    calculatePlanetGravity(forceSolver, approxX, approxY);
+    
+    // Normalize by the RMS exact magnitude (per-body ratios blow up for isolated planets)
+    double sumExactSquared = 0.0;
+    double sumErrorSquared = 0.0;
+    double maxErrorSquared = 0.0;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        double exactAx = toDouble(exactX[i]);
+        double exactAy = toDouble(exactY[i]);
+        double ex = toDouble(approxX[i]) - exactAx;
+        double ey = toDouble(approxY[i]) - exactAy;
+        double errorSquared = ex*ex + ey*ey;
+        sumExactSquared += exactAx*exactAx + exactAy*exactAy;
+        sumErrorSquared += errorSquared;
+        if (errorSquared > maxErrorSquared) {
+            maxErrorSquared = errorSquared;
+        }
+    }
+    
+    if (sumExactSquared > 0.0) {
+        double rmsExact = sqrt(sumExactSquared / bodies.size());
+        report.rmsRelativeError = sqrt(sumErrorSquared / bodies.size()) / rmsExact;
+        report.maxRelativeError = sqrt(maxErrorSquared) / rmsExact;
+    }
+    return report;
+}
+
 bool PhysicsEngine::shouldUpdateTrails() {
-    unsigned long currentTime = millis();
-    if (currentTime - lastTrailUpdateTime > RenderConstants::TRAIL_UPDATE_INTERVAL) {
-        lastTrailUpdateTime = currentTime;
+    // Trails advance on simulated time, so they look the same at any frame rate or time step
+    uint32_t trailSlot = static_cast<uint32_t>(simulationTime / RenderConstants::TRAIL_UPDATE_STEPS);
+    if (trailSlot != lastTrailSlot) {
+        lastTrailSlot = trailSlot;
         return true;
     }
     return false;
 }
 
-void PhysicsEngine::calculateSunGravity(size_t planetIndex, std::vector<double>& ax, std::vector<double>& ay) {
+void PhysicsEngine::calculateSunGravity(size_t planetIndex, std::vector<Real>& ax, std::vector<Real>& ay) {
     // Calculate gravity from the sun (sun is at origin (0,0))
-    double dx = -planets[planetIndex].getX();
-    double dy = -planets[planetIndex].getY();
-    double r2 = dx*dx + dy*dy;
-    
-    // Optimized calculation using inverse square root
-    // F = G * m1 * m2 / r^2, a = F / m
-    // Combined: a = G * m2 * dx / (r^3) where r^3 = r * r^2
-    double r = sqrt(r2);
-    double r_inv3 = 1.0 / (r * r2);  // 1/r^3 using only one sqrt
+    // a = G * M * d / r^3 in pixels per step^2 (see GravityKernel)
+    GravityKernel<Real>::attract(-bodies.x[planetIndex], -bodies.y[planetIndex], SUN_GM,
+                                 ax[planetIndex], ay[planetIndex]);
+}
+
+void PhysicsEngine::calculatePairGravity(size_t i, size_t j, std::vector<Real>& ax, std::vector<Real>& ay) {
+    // Accelerations of planets i and j towards each other (skipped beyond the force cutoff)
+    Real accelIX, accelIY, accelJX, accelJY;
+    if (!GravityKernel<Real>::mutual(bodies.x[j] - bodies.x[i], bodies.y[j] - bodies.y[i],
+                                     bodies.gm[i], bodies.gm[j], accelIX, accelIY, accelJX, accelJY)) {
+        return;
+    }
     
-    // Acceleration calculation (optimized to reduce operations)
-    double factor = PhysicsConstants::G * SunConstants::MASS * r_inv3 / distanceScaleSquared;
-    double accelX = factor * dx;
-    double accelY = factor * dy;
+    // Acceleration for planet i
+    ax[i] += accelIX;
+    ay[i] += accelIY;
     
-    ax[planetIndex] += accelX;
-    ay[planetIndex] += accelY;
+    // Acceleration for planet j (opposite direction, scaled by the mass of i)
+    ax[j] += accelJX;
+    ay[j] += accelJY;
 }
 
-void PhysicsEngine::calculatePlanetGravity(std::vector<double>& ax, std::vector<double>& ay) {
+void PhysicsEngine::calculatePlanetGravity(std::vector<Real>& ax, std::vector<Real>& ay) {
+    // With a pool, each thread sums whole rows (every pair twice, but no shared writes)
+    if (threadPool != nullptr) {
+        forEachChunk(bodies.size(), [&](size_t begin, size_t end) {
+            calculatePlanetGravityRows(begin, end, ax, ay);
+        });
+        return;
+    }
+
+    // Vector kernel on hosts that have one
+    if (SimdGravity::accumulate(bodies.x.data(), bodies.y.data(), bodies.gm.data(), bodies.size(),
+                                0, bodies.size(), ax.data(), ay.data())) {
+        return;
+    }
+
     // Calculate gravity between planets (skip calculation for distant planets to reduce processing load)
-    for (size_t i = 0; i < planets.size(); i++) {
-        for (size_t j = i + 1; j < planets.size(); j++) {
-            // Calculate distance between planets
-            double dx = planets[j].getX() - planets[i].getX();
-            double dy = planets[j].getY() - planets[i].getY();
-            double r2 = dx*dx + dy*dy;
-            
-            // Skip calculation if distance is too far (to reduce processing load)
-            if (r2 > PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED) {
-                continue;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        for (size_t j = i + 1; j < bodies.size(); j++) {
+            calculatePairGravity(i, j, ax, ay);
+        }
+    }
+}
+
+void PhysicsEngine::calculatePlanetGravityRows(size_t begin, size_t end, std::vector<Real>& ax, std::vector<Real>& ay) {
+    if (SimdGravity::accumulate(bodies.x.data(), bodies.y.data(), bodies.gm.data(), bodies.size(),
+                                begin, end, ax.data(), ay.data())) {
+        return;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        for (size_t j = 0; j < bodies.size(); j++) {
+            Real accelX, accelY;
+            if (j != i && GravityKernel<Real>::pair(bodies.x[j] - bodies.x[i], bodies.y[j] - bodies.y[i], bodies.gm[j],
+                                                    accelX, accelY)) {
+                ax[i] += accelX;
+                ay[i] += accelY;
             }
-            
-            // Apply minimum distance (to prevent collision)
-            if (r2 < PhysicsConstants::MIN_DISTANCE_SQUARED) {
-                r2 = PhysicsConstants::MIN_DISTANCE_SQUARED;
+        }
+    }
+}
+
+void PhysicsEngine::calculatePlanetGravityCellList(std::vector<Real>& ax, std::vector<Real>& ay) {
+    // Move planets that crossed a cell boundary, then visit only pairs in neighbouring cells
+    spatialGrid.update(bodies, planetsReordered);
+    planetsReordered = false;
+    spatialGrid.forEachNearbyPair([&](int i, int j) {
+        calculatePairGravity(i, j, ax, ay);
+    });
+}
+
+void PhysicsEngine::calculatePlanetGravity(ForceSolver solver, std::vector<Real>& ax, std::vector<Real>& ay) {
+    switch (solver) {
+        case ForceSolver::BARNES_HUT:
+            calculatePlanetGravityBarnesHut(ax, ay);
+            break;
+        case ForceSolver::CELL_LIST:
+            calculatePlanetGravityCellList(ax, ay);
+            break;
+        default:
+            calculatePlanetGravity(ax, ay);
+            break;
+    }
+}
+
+void PhysicsEngine::calculatePlanetGravityBarnesHut(std::vector<Real>& ax, std::vector<Real>& ay) {
+    // Rebuild the tree from the current positions, then walk it once per planet
+    quadTree.build(bodies);
+    forEachChunk(bodies.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double accelX = 0.0;
+            double accelY = 0.0;
+            quadTree.calculateAcceleration(i, accelX, accelY);
+            ax[i] += Real(accelX);
+            ay[i] += Real(accelY);
+        }
+    });
+}
+
+void PhysicsEngine::forEachChunk(size_t count, const std::function<void(size_t, size_t)>& body) {
+#if !defined(ARDUINO)
+    if (threadPool != nullptr) {
+        threadPool->parallelFor(count, ParallelConstants::FORCE_GRAIN, body);
+        return;
+    }
+#endif
+    body(0, count);
+}
+
+void PhysicsEngine::calculateAccelerations() {
+    // Reuse acceleration arrays (resize and clear)
+    accelerationX.assign(bodies.size(), Real(0));
+    accelerationY.assign(bodies.size(), Real(0));
+    
+    // Apply gravity from the sun to each planet
+    for (size_t i = 0; i < bodies.size(); i++) {
+        calculateSunGravity(i, accelerationX, accelerationY);
+    }
+    
+    // Calculate gravity between planets
+    calculatePlanetGravity(forceSolver, accelerationX, accelerationY);
+    
+    accelerationsValid = true;
+    forceEvaluationCount += bodies.size();
+}
+
+void PhysicsEngine::calculateAccelerations(const std::vector<int>& planets) {
+    // Every planet is active: the symmetric full evaluation is cheaper
+    if (planets.size() == bodies.size()) {
+        calculateAccelerations();
+        return;
+    }
+    
+    // Clear and apply gravity from the sun to the given planets
+    for (int i : planets) {
+        accelerationX[i] = Real(0);
+        accelerationY[i] = Real(0);
+        calculateSunGravity(i, accelerationX, accelerationY);
+    }
+    
+    // Calculate gravity from all other planets (one-sided, sources are not updated)
+    if (forceSolver == ForceSolver::BARNES_HUT) {
+        quadTree.build(bodies);
+    } else if (forceSolver == ForceSolver::CELL_LIST) {
+        spatialGrid.update(bodies, planetsReordered);
+        planetsReordered = false;
+    }
+    forEachChunk(planets.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            int i = planets[k];
+            switch (forceSolver) {
+                case ForceSolver::BARNES_HUT: {
+                    double accelX = 0.0;
+                    double accelY = 0.0;
+                    quadTree.calculateAcceleration(i, accelX, accelY);
+                    accelerationX[i] += Real(accelX);
+                    accelerationY[i] += Real(accelY);
+                    break;
+                }
+                case ForceSolver::CELL_LIST:
+                    spatialGrid.forEachNeighbor(i, [&](int j) {
+                        Real accelX, accelY;
+                        if (GravityKernel<Real>::pair(bodies.x[j] - bodies.x[i], bodies.y[j] - bodies.y[i],
+                                                      bodies.gm[j], accelX, accelY)) {
+                            accelerationX[i] += accelX;
+                            accelerationY[i] += accelY;
+                        }
+                    });
+                    break;
+                default:
+                    calculatePlanetGravityRows(i, i + 1, accelerationX, accelerationY);
+                    break;
             }
+        }
+    });
+    
+    forceEvaluationCount += planets.size();
+}
+
+int PhysicsEngine::chooseStepLevel(size_t planetIndex) const {
+    // Substep ~ ACCURACY * sqrt(r / |a|), the local dynamical time (sqrt(r^3 / GM) near the sun)
+    double x = toDouble(bodies.x[planetIndex]);
+    double y = toDouble(bodies.y[planetIndex]);
+    double ax = toDouble(accelerationX[planetIndex]);
+    double ay = toDouble(accelerationY[planetIndex]);
+    double distance = sqrt(x*x + y*y);
+    if (distance < SunConstants::RADIUS) {
+        distance = SunConstants::RADIUS;
+    }
+    double acceleration = sqrt(ax*ax + ay*ay);
+    if (acceleration <= 0.0) {
+        return 0;
+    }
+    double substep = BlockStepConstants::ACCURACY * sqrt(distance / acceleration);
+    
+    // Smallest power-of-two division of the time step that fits
+    int level = 0;
+    double levelStep = timeStepValue;
+    while (levelStep > substep && level < BlockStepConstants::MAX_LEVEL) {
+        levelStep *= 0.5;
+        level++;
+    }
+    return level;
+}
+
+void PhysicsEngine::kick(Real h) {
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies.vx[i] += accelerationX[i] * h;
+        bodies.vy[i] += accelerationY[i] * h;
+    }
+}
+
+void PhysicsEngine::drift(Real h) {
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies.x[i] += bodies.vx[i] * h;
+        bodies.y[i] += bodies.vy[i] * h;
+    }
+}
+
+void PhysicsEngine::integrateSemiImplicitEuler() {
+    // v = v + a(p) * h, then p = p + v * h
+    calculateAccelerations();
+    kick(timeStep);
+    drift(timeStep);
+    
+    // Positions moved after the evaluation
+    accelerationsValid = false;
+}
+
+void PhysicsEngine::integrateLeapfrog() {
+    // Half kick with the acceleration left by the previous step, drift, half kick with the new one
+    const Real halfStep(0.5 * timeStepValue);
+    if (!accelerationsValid) {
+        calculateAccelerations();
+    }
+    kick(halfStep);
+    drift(timeStep);
+    calculateAccelerations();
+    kick(halfStep);
+}
+
+void PhysicsEngine::integrateVelocityVerlet() {
+    // p = p + v * h + a * h^2 / 2, then v = v + (a + a') * h / 2
+    const Real halfStep(0.5 * timeStepValue);
+    const Real halfStepSquared(0.5 * timeStepValue * timeStepValue);
+    if (!accelerationsValid) {
+        calculateAccelerations();
+    }
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies.x[i] += bodies.vx[i] * timeStep + accelerationX[i] * halfStepSquared;
+        bodies.y[i] += bodies.vy[i] * timeStep + accelerationY[i] * halfStepSquared;
+        bodies.vx[i] += accelerationX[i] * halfStep;
+        bodies.vy[i] += accelerationY[i] * halfStep;
+    }
+    calculateAccelerations();
+    kick(halfStep);
+}
+
+void PhysicsEngine::integrateYoshida4() {
+    // Drift-kick-drift composition of three leapfrog steps with weights w1, w0, w1
+    const Real outerDrift(0.5 * YOSHIDA_W1 * timeStepValue);
+    const Real innerDrift(0.5 * (YOSHIDA_W0 + YOSHIDA_W1) * timeStepValue);
+    const Real outerKick(YOSHIDA_W1 * timeStepValue);
+    const Real innerKick(YOSHIDA_W0 * timeStepValue);
+    
+    drift(outerDrift);
+    calculateAccelerations();
+    kick(outerKick);
+    drift(innerDrift);
+    calculateAccelerations();
+    kick(innerKick);
+    drift(innerDrift);
+    calculateAccelerations();
+    kick(outerKick);
+    drift(outerDrift);
+    
+    // Positions moved after the last evaluation
+    accelerationsValid = false;
+}
+
+void PhysicsEngine::integrateBlockLeapfrog() {
+    // Substeps are counted in ticks of the finest level
+    const int ticks = 1 << BlockStepConstants::MAX_LEVEL;
+    const double tickStep = timeStepValue / ticks;
+    
+    // All planets are synchronized at a step boundary, so stale state can be rebuilt for everyone
+    if (!accelerationsValid || stepLevels.size() != bodies.size()) {
+        calculateAccelerations();
+        stepLevels.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++) {
+            stepLevels[i] = chooseStepLevel(i);
+        }
+    }
+    
+    // Opening half kick of every planet
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const Real halfStep(0.5 * tickStep * (ticks >> stepLevels[i]));
+        bodies.vx[i] += accelerationX[i] * halfStep;
+        bodies.vy[i] += accelerationY[i] * halfStep;
+    }
+    
+    int tick = 0;
+    while (tick < ticks) {
+        // Drift everyone to the next tick at which some planet ends its substep
+        int nextTick = ticks;
+        for (size_t i = 0; i < bodies.size(); i++) {
+            int span = ticks >> stepLevels[i];
+            int end = (tick / span + 1) * span;
+            if (end < nextTick) {
+                nextTick = end;
+            }
+        }
+        drift(Real((nextTick - tick) * tickStep));
+        tick = nextTick;
+        
+        // Forces only for the planets ending a substep
+        activePlanets.clear();
+        for (size_t i = 0; i < bodies.size(); i++) {
+            if (tick % (ticks >> stepLevels[i]) == 0) {
+                activePlanets.push_back(static_cast<int>(i));
+            }
+        }
+        calculateAccelerations(activePlanets);
+        
+        for (int i : activePlanets) {
+            // Closing half kick
+            const Real closingHalfStep(0.5 * tickStep * (ticks >> stepLevels[i]));
+            bodies.vx[i] += accelerationX[i] * closingHalfStep;
+            bodies.vy[i] += accelerationY[i] * closingHalfStep;
             
-            // Optimized calculation using inverse cube root
-            // a = G * m * dx / (r^3) where r^3 = r * r^2
-            double r = sqrt(r2);
-            double r_inv3 = 1.0 / (r * r2);  // 1/r^3 using only one sqrt
-            
-            // Acceleration calculation (optimized)
-            double factor = PhysicsConstants::G * PlanetConstants::MASS * r_inv3 / distanceScaleSquared;
-            double accelX = factor * dx;
-            double accelY = factor * dy;
-            
-            // Acceleration for planet i
-            ax[i] += accelX;
-            ay[i] += accelY;
+            // New level (a longer substep must start on a boundary of that level)
+            int level = chooseStepLevel(i);
+            while (tick % (ticks >> level) != 0) {
+                level++;
+            }
+            stepLevels[i] = level;
             
-            // Acceleration for planet j (opposite direction)
-            ax[j] -= accelX;
-            ay[j] -= accelY;
+            // Opening half kick of the next substep (the last one opens with the next step)
+            if (tick < ticks) {
+                const Real openingHalfStep(0.5 * tickStep * (ticks >> level));
+                bodies.vx[i] += accelerationX[i] * openingHalfStep;
+                bodies.vy[i] += accelerationY[i] * openingHalfStep;
+            }
         }
     }
 }
 
+void PhysicsEngine::recordTrails() {
+    for (size_t i = 0; i < bodies.size(); i++) {
+        trails.record(i, toInt(bodies.x[i]), toInt(bodies.y[i]));
+    }
+}
+
 bool PhysicsEngine::update() {
+    stepCount++;
+    simulationTime += timeStepValue;
+    
     // Determine if trail positions need to be updated
     bool shouldUpdateTrailPositions = shouldUpdateTrails();
     
     // Check if collision effect has expired
     if (collisionEffectActive) {
-        unsigned long currentTime = millis();
-        if (currentTime - collisionEffectStartTime > CollisionConstants::COLLISION_EFFECT_DURATION) {
+        if (simulationTime - collisionEffectStartTime > CollisionConstants::COLLISION_EFFECT_STEPS) {
             collisionEffectActive = false;
         }
     }
     
     // Early return if there are no planets
-    if (planets.empty()) {
+    if (bodies.empty()) {
         return shouldUpdateTrailPositions;
     }
     
-    // Reuse acceleration arrays (resize and clear)
-    accelerationX.resize(planets.size());
-    accelerationY.resize(planets.size());
-    std::fill(accelerationX.begin(), accelerationX.end(), 0.0);
-    std::fill(accelerationY.begin(), accelerationY.end(), 0.0);
+    // Remember the positions for render interpolation
+    std::copy(bodies.x.begin(), bodies.x.end(), bodies.prevX.begin());
+    std::copy(bodies.y.begin(), bodies.y.end(), bodies.prevY.begin());
     
-    // Apply gravity from the sun to each planet
-    for (size_t i = 0; i < planets.size(); i++) {
-        calculateSunGravity(i, accelerationX, accelerationY);
+    // Update velocity and position of each planet
+    switch (integrator) {
+        case Integrator::LEAPFROG:
+            integrateLeapfrog();
+            break;
+        case Integrator::VELOCITY_VERLET:
+            integrateVelocityVerlet();
+            break;
+        case Integrator::YOSHIDA4:
+            integrateYoshida4();
+            break;
+        case Integrator::BLOCK_LEAPFROG:
+            integrateBlockLeapfrog();
+            break;
+        default:
+            integrateSemiImplicitEuler();
+            break;
     }
     
-    // Calculate gravity between planets
-    calculatePlanetGravity(accelerationX, accelerationY);
-    
-    // Update velocity and position of each planet
-    for (size_t i = 0; i < planets.size(); i++) {
-        planets[i].update(accelerationX[i], accelerationY[i], shouldUpdateTrailPositions);
+    // Update trail positions
+    if (shouldUpdateTrailPositions) {
+        recordTrails();
     }
     
     return shouldUpdateTrailPositions;
 }
 
+void PhysicsEngine::calculateConservedQuantities(double& energy, double& angularMomentum) const {
+    // Pair potential matching GravityKernel::pair: harmonic inside MIN_DISTANCE,
+    // -GM / r outside, shifted so that it reaches zero at the force cutoff
+    const double minDistance = PhysicsConstants::MIN_DISTANCE;
+    const double cutoffPotential = 1.0 / PhysicsConstants::MAX_FORCE_DISTANCE;
+    
+    energy = 0.0;
+    angularMomentum = 0.0;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        double x = toDouble(bodies.x[i]);
+        double y = toDouble(bodies.y[i]);
+        double vx = toDouble(bodies.vx[i]);
+        double vy = toDouble(bodies.vy[i]);
+        double weight = toDouble(bodies.gm[i]) / StepUnits::PLANET_GM;  // Mass in units of PlanetConstants::MASS
+        
+        // Kinetic energy and potential energy in the sun's field
+        energy += weight * (0.5 * (vx*vx + vy*vy) - StepUnits::SUN_GM / sqrt(x*x + y*y));
+        angularMomentum += weight * (x * vy - y * vx);
+        
+        // Potential energy between planets
+        for (size_t j = i + 1; j < bodies.size(); j++) {
+            double dx = toDouble(bodies.x[j]) - x;
+            double dy = toDouble(bodies.y[j]) - y;
+            double r2 = dx*dx + dy*dy;
+            if (r2 > PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED) {
+                continue;
+            }
+            double potential;  // Per unit G * M of planet j
+            if (r2 < PhysicsConstants::MIN_DISTANCE_SQUARED) {
+                potential = (r2 - PhysicsConstants::MIN_DISTANCE_SQUARED) /
+                            (2.0 * minDistance * PhysicsConstants::MIN_DISTANCE_SQUARED) - 1.0 / minDistance;
+            } else {
+                potential = -1.0 / sqrt(r2);
+            }
+            energy += weight * toDouble(bodies.gm[j]) * (potential + cutoffPotential);
+        }
+    }
+}
+
+ConservationReport PhysicsEngine::measureConservation() {
+    ConservationReport report = {0.0, 0.0, 0.0, 0.0, 0, 0};
+    calculateConservedQuantities(report.energy, report.angularMomentum);
+    
+    // Start a new baseline when planets were added, removed or merged (or the scheme changed)
+    if (!conservationBaselineValid) {
+        baselineEnergy = report.energy;
+        baselineAngularMomentum = report.angularMomentum;
+        baselineStep = stepCount;
+        baselineForceEvaluations = forceEvaluationCount;
+        conservationBaselineValid = true;
+    }
+    
+    if (baselineEnergy != 0.0) {
+        report.energyDrift = fabs(report.energy - baselineEnergy) / fabs(baselineEnergy);
+    }
+    if (baselineAngularMomentum != 0.0) {
+        report.angularMomentumDrift = fabs(report.angularMomentum - baselineAngularMomentum) /
+                                      fabs(baselineAngularMomentum);
+    }
+    report.steps = stepCount - baselineStep;
+    report.forceEvaluations = forceEvaluationCount - baselineForceEvaluations;
+    return report;
+}
+
+void PhysicsEngine::pushEvent(SimulationEventType type, double x, double y, uint16_t color, BodyId body) {
+    if (pendingEvents.size() >= PipelineConstants::MAX_PENDING_EVENTS) {
+        return;  // Render side is too far behind, drop the effect
+    }
+    SimulationEvent event;
+    event.type = type;
+    event.x = x;
+    event.y = y;
+    event.color = color;
+    event.body = body;
+    pendingEvents.push_back(event);
+}
+
+void PhysicsEngine::mergePlanets(size_t i, size_t j) {
+    double gmI = toDouble(bodies.gm[i]);
+    double gmJ = toDouble(bodies.gm[j]);
+    double gm = gmI + gmJ;
+    double weightI = gmI / gm;
+    double weightJ = gmJ / gm;
+    
+    // Center of mass and momentum are conserved (kinetic energy is not: the merge is inelastic)
+    bodies.x[i] = Real(weightI * toDouble(bodies.x[i]) + weightJ * toDouble(bodies.x[j]));
+    bodies.y[i] = Real(weightI * toDouble(bodies.y[i]) + weightJ * toDouble(bodies.y[j]));
+    bodies.vx[i] = Real(weightI * toDouble(bodies.vx[i]) + weightJ * toDouble(bodies.vx[j]));
+    bodies.vy[i] = Real(weightI * toDouble(bodies.vy[i]) + weightJ * toDouble(bodies.vy[j]));
+    bodies.prevX[i] = bodies.x[i];
+    bodies.prevY[i] = bodies.y[i];
+    bodies.gm[i] = Real(gm);
+    bodies.radius[i] = Planet::radiusFor(gm);
+    bodies.color[i] = Planet::mixColors(bodies.color[i], bodies.color[j], static_cast<float>(weightJ));
+}
+
+void PhysicsEngine::mergeCollidingPlanets() {
+    if (bodies.size() < 2) {
+        return;
+    }
+    
+    // Broadphase: only pairs overlapping on the X axis are tested
+    contactSweep.findContacts(bodies, contactsReordered, contacts);
+    contactsReordered = false;
+    if (contacts.empty()) {
+        return;
+    }
+    
+    // Merge each pair into its older planet (which keeps its ID); a planet takes part in at most
+    // one merge per step (clusters finish merging over the next steps)
+    mergeState.assign(bodies.size(), 0);
+    for (const auto& contact : contacts) {
+        int i = contact.first;
+        int j = contact.second;
+        if (mergeState[i] != 0 || mergeState[j] != 0) {
+            continue;
+        }
+        if (static_cast<int32_t>(bodies.serial[j] - bodies.serial[i]) < 0) {
+            std::swap(i, j);
+        }
+        mergePlanets(i, j);
+        mergeState[i] = 1;
+        mergeState[j] = 2;
+        
+        // Request firework effect at the merge position (handled on the render side)
+        pushEvent(SimulationEventType::PLANET_MERGE, toDouble(bodies.x[i]), toDouble(bodies.y[i]), bodies.color[i],
+                  bodies.id[i]);
+    }
+    
+    // Remove absorbed planets (from the end so that the planet moved into a hole has already been handled)
+    for (int i = static_cast<int>(mergeState.size()) - 1; i >= 0; i--) {
+        if (mergeState[i] == 2) {
+            removePlanet(i);
+        }
+    }
+}
+
 void PhysicsEngine::removeOutOfBoundsPlanets(int maxX, int maxY) {
     // Early return if there are no planets
-    if (planets.empty()) {
+    if (bodies.empty()) {
         return;
     }
     
     // Remove planets that are out of bounds or have collided with the sun
-    // Process from the end to prevent index shifting due to removal
-    for (int i = static_cast<int>(planets.size()) - 1; i >= 0; i--) {
-        const Planet& planet = planets[i];
+    // Process from the end so that the planet moved into a hole has already been checked
+    for (int i = static_cast<int>(bodies.size()) - 1; i >= 0; i--) {
+        Planet planet = getPlanet(i);
         
         // Remove planets that are out of bounds
         if (planet.isOutOfBounds(maxX, maxY)) {
-            planets.erase(planets.begin() + i);
+            removePlanet(i);
         } 
         // Remove planets that have collided with the sun and play sound effect
         else if (planet.isCollidedWithSun()) {
@@ -153,26 +887,50 @@ void PhysicsEngine::removeOutOfBoundsPlanets(int maxX, int maxY) {
             collisionEffectActive = true;
             collisionEffectX = planet.getX();
             collisionEffectY = planet.getY();
-            collisionEffectStartTime = millis();
-            
-            // Create firework effect at collision position
-            renderer.createFirework(collisionEffectX, collisionEffectY, planet.getColor());
+            collisionEffectStartTime = simulationTime;
             
-            // Play sound effect
-            M5.Speaker.tone(ToneConstants::COLLISION_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+            // Request firework effect and sound at collision position (handled on the render side)
+            pushEvent(SimulationEventType::SUN_COLLISION, collisionEffectX, collisionEffectY, planet.getColor(),
+                      planet.getId());
             
             // Remove the planet
-            planets.erase(planets.begin() + i);
+            removePlanet(i);
         }
     }
 }
 
+uint32_t PhysicsEngine::getStepCount() const {
+    return stepCount;
+}
+
 size_t PhysicsEngine::getPlanetCount() const {
-    return planets.size();
+    return bodies.size();
+}
+
+Planet PhysicsEngine::getPlanet(size_t index) const {
+    return Planet(bodies, trails, index);
+}
+
+int PhysicsEngine::findPlanet(BodyId id) const {
+    return bodies.indexOf(id);
+}
+
+const BodyStore& PhysicsEngine::getBodies() const {
+    return bodies;
 }
 
-const std::vector<Planet>& PhysicsEngine::getPlanets() const {
-    return planets;
+const TrailPool& PhysicsEngine::getTrails() const {
+    return trails;
+}
+
+void PhysicsEngine::takeEvents(std::vector<SimulationEvent>& events) {
+    for (const auto& event : pendingEvents) {
+        if (events.size() >= PipelineConstants::MAX_PENDING_EVENTS) {
+            break;  // Render side is too far behind, drop the effect
+        }
+        events.push_back(event);
+    }
+    pendingEvents.clear();
 }
 
 bool PhysicsEngine::hasActiveCollisionEffect() const {
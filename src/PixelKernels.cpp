@@ -0,0 +1,133 @@
+#include "PixelKernels.h"
+#include <algorithm>
+
+namespace {
+    constexpr int MAX_RADIUS = RenderConstants::MAX_DISC_RADIUS;
+
+    /**
+     * Half width of every row of the discs up to MAX_RADIUS
+     */
+    struct DiscMasks {
+        uint8_t halfWidth[MAX_RADIUS + 1][MAX_RADIUS + 1];  // [radius][|row offset|]
+
+        DiscMasks() {
+            for (int r = 0; r <= MAX_RADIUS; r++) {
+                uint8_t* rows = halfWidth[r];
+                std::fill(rows, rows + MAX_RADIUS + 1, 0);
+
+                // Same midpoint walk as fillCircle, keeping the widest span of each row
+                rows[0] = r;
+                int f = 1 - r;
+                int ddFx = 1;
+                int ddFy = -2 * r;
+                int px = 0;
+                int py = r;
+                while (px < py) {
+                    if (f >= 0) {
+                        py--;
+                        ddFy += 2;
+                        f += ddFy;
+                    }
+                    px++;
+                    ddFx += 2;
+                    f += ddFx;
+                    rows[px] = std::max<int>(rows[px], py);
+                    rows[py] = std::max<int>(rows[py], px);
+                }
+            }
+        }
+    };
+
+    const DiscMasks& masks() {
+        static const DiscMasks discMasks;
+        return discMasks;
+    }
+
+    /**
+     * Visit the clipped run of every row of a disc
+     * @param visit Callback taking (first pixel of the run, length)
+     */
+    template <typename Visitor>
+    void forEachRun(pixel::Target& target, int x, int y, int radius, Visitor visit) {
+        const uint8_t* rows = masks().halfWidth[radius];
+        int top = std::max(y - radius, 0);
+        int bottom = std::min(y + radius, target.height - 1);
+        for (int row = top; row <= bottom; row++) {
+            int half = rows[row < y ? y - row : row - y];
+            int left = std::max(x - half, 0);
+            int right = std::min(x + half, target.width - 1);
+            if (left <= right) {
+                visit(target.pixels + row * target.width + left, right - left + 1);
+            }
+        }
+    }
+}
+
+namespace pixel {
+    void fillDisc(Target& target, int x, int y, int radius, uint16_t color) {
+        if (radius > MAX_RADIUS) {
+            target.canvas.fillCircle(x, y, radius, color);
+            return;
+        }
+        if (radius < 0) {
+            return;
+        }
+        const uint16_t value = hal::toCanvasColor(color);
+        forEachRun(target, x, y, radius, [value](uint16_t* run, int length) {
+            std::fill(run, run + length, value);
+        });
+    }
+
+    void addDisc(Target& target, int x, int y, int radius, uint16_t color) {
+        if (radius < 0) {
+            return;
+        }
+        radius = std::min(radius, MAX_RADIUS);
+        forEachRun(target, x, y, radius, [color](uint16_t* run, int length) {
+            for (int i = 0; i < length; i++) {
+                run[i] = hal::toCanvasColor(addColors(hal::fromCanvasColor(run[i]), color));
+            }
+        });
+    }
+
+    void Stencil::capture(hal::Canvas& canvas, int originX, int originY) {
+        spans.clear();
+        const uint16_t* pixels = static_cast<const uint16_t*>(canvas.getBuffer());
+        if (pixels == nullptr) {
+            return;
+        }
+        int width = canvas.width();
+        for (int row = 0; row < canvas.height(); row++) {
+            const uint16_t* line = pixels + row * width;
+            int column = 0;
+            while (column < width) {
+                if (line[column] == TFT_BLACK) {
+                    column++;
+                    continue;
+                }
+                int start = column;
+                while (column < width && line[column] != TFT_BLACK) {
+                    column++;
+                }
+                spans.push_back({static_cast<int16_t>(start - originX), static_cast<int16_t>(row - originY),
+                                 static_cast<int16_t>(column - start)});
+            }
+        }
+    }
+
+    void fillStencil(Target& target, const Stencil& stencil, int x, int y, uint16_t color) {
+        const uint16_t value = hal::toCanvasColor(color);
+        for (const Span& span : stencil.spans) {
+            int row = y + span.y;
+            if (static_cast<unsigned>(row) >= static_cast<unsigned>(target.height)) {
+                continue;
+            }
+            int left = std::max(x + span.x, 0);
+            int right = std::min(x + span.x + span.length, target.width);
+            if (left < right) {
+                uint16_t* run = target.pixels + row * target.width;
+                std::fill(run + left, run + right, value);
+            }
+        }
+    }
+}
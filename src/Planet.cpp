@@ -1,7 +1,8 @@
 #include "Planet.h"
+#include "PixelKernels.h"
 #include <cmath>
 
-uint16_t Planet::alphaBlend(uint16_t fg, uint16_t bg, uint8_t alpha) const {
+uint16_t Planet::alphaBlend(uint16_t fg, uint16_t bg, uint8_t alpha) {
     // Decompose color into RGB components
     uint8_t fgR = (fg >> 11) & 0x1F;
     uint8_t fgG = (fg >> 5) & 0x3F;
@@ -20,118 +21,138 @@ uint16_t Planet::alphaBlend(uint16_t fg, uint16_t bg, uint8_t alpha) const {
     return (r << 11) | (g << 5) | b;
 }
 
-Planet::Planet(double x, double y, double vx, double vy, uint16_t color)
-    : x(x), y(y), vx(vx), vy(vy), color(color), trailIndex(0) {
-    // Initialize trail positions
-    for (int i = 0; i < PlanetConstants::TRAIL_LENGTH; i++) {
-        trailX[i] = x;
-        trailY[i] = y;
-    }
+Planet::Planet(const BodyStore& bodies, const TrailPool& trails, size_t index)
+    : bodies(bodies), trails(trails), index(index) {
 }
 
-void Planet::update(double ax, double ay, bool updateTrails) {
-    // Update velocity: v = v + a * dt
-    vx += ax * PhysicsConstants::TIME_SCALE;
-    vy += ay * PhysicsConstants::TIME_SCALE;
-    
-    // Update position: p = p + v * dt
-    x += vx * PhysicsConstants::TIME_SCALE;
-    y += vy * PhysicsConstants::TIME_SCALE;
-    
-    // Update trail positions using ring buffer (optimized - O(1) instead of O(n))
-    if (updateTrails) {
-        trailIndex = (trailIndex + 1) % PlanetConstants::TRAIL_LENGTH;
-        trailX[trailIndex] = x;
-        trailY[trailIndex] = y;
-    }
+void Planet::getInterpolatedPosition(float alpha, double& x, double& y) const {
+    double previousX = toDouble(bodies.prevX[index]);
+    double previousY = toDouble(bodies.prevY[index]);
+    x = previousX + (getX() - previousX) * alpha;
+    y = previousY + (getY() - previousY) * alpha;
 }
 
-void Planet::draw(M5Canvas& canvas, int centerX, int centerY) const {
-    // Draw the planet body
+void Planet::draw(hal::Canvas& canvas, int centerX, int centerY, float alpha) const {
+    // Draw the planet body between the previous and current step
+    double x, y;
+    getInterpolatedPosition(alpha, x, y);
     int screenX = centerX + x;
     int screenY = centerY + y;
-    canvas.fillCircle(screenX, screenY, PlanetConstants::RADIUS, color);
+    pixel::Target target(canvas);
+    pixel::fillDisc(target, screenX, screenY, static_cast<int>(getRadius() + 0.5f), getColor());
 }
 
-void Planet::drawTrail(M5Canvas& canvas, int centerX, int centerY) const {
-    // Draw trails using ring buffer (newest to oldest)
-    for (int i = 0; i < PlanetConstants::TRAIL_LENGTH; i++) {
-        // Calculate ring buffer index (from newest to oldest)
-        int idx = (trailIndex - i + PlanetConstants::TRAIL_LENGTH) % PlanetConstants::TRAIL_LENGTH;
-        
+void Planet::drawTrail(hal::Canvas& canvas, int centerX, int centerY) const {
+    // Walk the trail's ring buffer in the pool directly (newest to oldest)
+    const int16_t* xs = trails.getXs(index);
+    const int16_t* ys = trails.getYs(index);
+    int length = trails.getLength(index);
+    int slot = trails.getHead(index);
+    pixel::Target target(canvas);
+    for (int i = 0; i < length; i++) {
         // Calculate screen position of trail point
-        int trailScreenX = centerX + trailX[idx];
-        int trailScreenY = centerY + trailY[idx];
+        int trailScreenX = centerX + xs[slot];
+        int trailScreenY = centerY + ys[slot];
+        slot = slot == 0 ? length - 1 : slot - 1;
         
         // Trail transparency with non-linear gradient for smoother, more natural effect
         // Use exponential curve: alpha stays high longer, then fades faster at the end
-        float normalizedPosition = 1.0f - (float)i / PlanetConstants::TRAIL_LENGTH;
+        float normalizedPosition = 1.0f - (float)i / length;
         uint8_t alpha = 255 * pow(normalizedPosition, 2.0f);  // Quadratic falloff for beautiful fade
         
         // Trail color (faded version of original color)
-        uint16_t trailColor = alphaBlend(color, BLACK, alpha);
+        uint16_t trailColor = alphaBlend(getColor(), BLACK, alpha);
         
         // Draw trail
-        canvas.drawPixel(trailScreenX, trailScreenY, trailColor);
+        pixel::drawPixel(target, trailScreenX, trailScreenY, trailColor);
+    }
+}
+
+void Planet::getTrailBounds(int& left, int& top, int& right, int& bottom) const {
+    // Order does not matter, so scan the ring buffer as stored
+    const int16_t* xs = trails.getXs(index);
+    const int16_t* ys = trails.getYs(index);
+    left = right = xs[0];
+    top = bottom = ys[0];
+    for (int i = 1; i < trails.getLength(index); i++) {
+        int x = xs[i];
+        int y = ys[i];
+        if (x < left) left = x;
+        if (x > right) right = x;
+        if (y < top) top = y;
+        if (y > bottom) bottom = y;
     }
 }
 
 bool Planet::isOutOfBounds(int maxX, int maxY) const {
-    return (abs(x) > maxX || abs(y) > maxY);
+    return (fabs(getX()) > maxX || fabs(getY()) > maxY);
 }
 
 bool Planet::isCollidedWithSun() const {
     // Collision detected if distance from sun center is less than sun radius
+    double x = getX();
+    double y = getY();
     double distanceSquared = x*x + y*y;
     return (distanceSquared < SunConstants::RADIUS_SQUARED);
 }
 
-uint16_t Planet::randomPastelColor() {
+uint16_t Planet::randomPastelColor(Random& random) {
     // Method to generate cosmic vibrant colors
     // Creates colors reminiscent of nebulas and distant galaxies
     uint8_t r, g, b;
     
     // Select from multiple cosmic color palettes
-    int palette = random(7);
+    int palette = random.next(7);
     
     switch (palette) {
         case 0: // Magenta / Purple Nebula
-            r = 180 + random(76);   // 180-255
-            g = 50 + random(100);    // 50-149
-            b = 200 + random(56);    // 200-255
+            r = 180 + random.next(76);   // 180-255
+            g = 50 + random.next(100);    // 50-149
+            b = 200 + random.next(56);    // 200-255
             break;
         case 1: // Cyan / Blue Starlight
-            r = 50 + random(80);     // 50-129
-            g = 180 + random(76);    // 180-255
-            b = 230 + random(26);    // 230-255
+            r = 50 + random.next(80);     // 50-129
+            g = 180 + random.next(76);    // 180-255
+            b = 230 + random.next(26);    // 230-255
             break;
         case 2: // Golden / Warm Dwarf Star
-            r = 230 + random(26);    // 230-255
-            g = 160 + random(60);    // 160-219
-            b = 80 + random(100);    // 80-179
+            r = 230 + random.next(26);    // 230-255
+            g = 160 + random.next(60);    // 160-219
+            b = 80 + random.next(100);    // 80-179
             break;
         case 3: // Emerald / Teal Cosmic Dust
-            r = 50 + random(100);    // 50-149
-            g = 200 + random(56);    // 200-255
-            b = 150 + random(70);    // 150-219
+            r = 50 + random.next(100);    // 50-149
+            g = 200 + random.next(56);    // 200-255
+            b = 150 + random.next(70);    // 150-219
             break;
         case 4: // Rose / Pink Gas Cloud
-            r = 230 + random(26);    // 230-255
-            g = 100 + random(80);    // 100-179
-            b = 180 + random(76);    // 180-255
+            r = 230 + random.next(26);    // 230-255
+            g = 100 + random.next(80);    // 100-179
+            b = 180 + random.next(76);    // 180-255
             break;
         case 5: // Lavender / Purple Galaxy Core
-            r = 160 + random(60);    // 160-219
-            g = 120 + random(80);    // 120-199
-            b = 220 + random(36);    // 220-255
+            r = 160 + random.next(60);    // 160-219
+            g = 120 + random.next(80);    // 120-199
+            b = 220 + random.next(36);    // 220-255
             break;
-        case 6: // Silver / White Dwarf
-            r = 200 + random(56);    // 200-255
-            g = 200 + random(56);    // 200-255
-            b = 220 + random(36);    // 220-255
+        default: // Silver / White Dwarf (palette 6)
+            r = 200 + random.next(56);    // 200-255
+            g = 200 + random.next(56);    // 200-255
+            b = 220 + random.next(36);    // 220-255
             break;
     }
     
     // Convert to RGB565 format
     return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
+
+float Planet::radiusFor(double gm) {
+    // Volume grows with mass, so radius grows with its cube root
+    float radius = PlanetConstants::RADIUS * static_cast<float>(cbrt(gm / StepUnits::PLANET_GM));
+    return radius < PlanetConstants::MAX_RADIUS ? radius : PlanetConstants::MAX_RADIUS;
+}
+
+uint16_t Planet::mixColors(uint16_t a, uint16_t b, float weightB) {
+    uint8_t alpha = static_cast<uint8_t>(weightB * 255.0f + 0.5f);
+    return alphaBlend(b, a, alpha);
+}
@@ -0,0 +1,148 @@
+#include "Profiler.h"
+#include "Hal.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+    const char* const STAGE_NAMES[] = {
+        "input", "touch", "snapshot", "draw", "push", "save", "telemetry", "frame", "physics", "merge", "cull"
+    };
+    static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<size_t>(ProfileStage::COUNT),
+                  "every stage needs a name");
+}
+
+Profiler::Profiler()
+    : slowFrames(0), lastSlowStage(static_cast<uint8_t>(ProfileStage::COUNT)), overlayVisible(false) {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        for (uint32_t j = 0; j < HISTORY_SIZE; j++) {
+            histories[i].samples[j].store(0, std::memory_order_relaxed);
+        }
+        histories[i].count.store(0, std::memory_order_relaxed);
+        frameMicros[i] = 0;
+        slowCounts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::record(ProfileStage stage, uint32_t micros) {
+    History& history = histories[static_cast<int>(stage)];
+
+    // Single writer per stage: the slot is written before the count that publishes it
+    uint32_t count = history.count.load(std::memory_order_relaxed);
+    history.samples[count % HISTORY_SIZE].store(micros, std::memory_order_relaxed);
+    history.count.store(count + 1, std::memory_order_release);
+
+    if (isFrameStage(stage)) {
+        frameMicros[static_cast<int>(stage)] += micros;
+    }
+}
+
+void Profiler::endFrame(bool drawn) {
+    if (drawn) {
+        // The frame time is the sum of the render-loop stages of this iteration
+        uint32_t total = 0;
+        int slowest = 0;
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            total += frameMicros[i];
+            if (frameMicros[i] > frameMicros[slowest]) {
+                slowest = i;
+            }
+        }
+        record(ProfileStage::FRAME, total);
+
+        // Blame a slow frame on the stage that took longest
+        if (total > ProfilerConstants::SLOW_FRAME_MICROS) {
+            slowFrames.fetch_add(1, std::memory_order_relaxed);
+            slowCounts[slowest].fetch_add(1, std::memory_order_relaxed);
+            lastSlowStage.store(static_cast<uint8_t>(slowest), std::memory_order_relaxed);
+        }
+    }
+
+    std::fill(frameMicros, frameMicros + STAGE_COUNT, 0);
+}
+
+ProfileStats Profiler::getStats(ProfileStage stage) const {
+    const History& history = histories[static_cast<int>(stage)];
+    ProfileStats stats = {0, 0, 0, 0, 0};
+
+    // Copy the ring (a sample being overwritten meanwhile is at worst one record newer)
+    uint32_t count = std::min(history.count.load(std::memory_order_acquire), HISTORY_SIZE);
+    if (count == 0) {
+        return stats;
+    }
+    uint32_t sorted[HISTORY_SIZE];
+    for (uint32_t i = 0; i < count; i++) {
+        sorted[i] = history.samples[i].load(std::memory_order_relaxed);
+    }
+    std::sort(sorted, sorted + count);
+
+    stats.samples = count;
+    stats.min = sorted[0];
+    stats.p50 = sorted[(count - 1) * 50 / 100];
+    stats.p99 = sorted[(count - 1) * 99 / 100];
+    stats.max = sorted[count - 1];
+    return stats;
+}
+
+uint32_t Profiler::getSlowFrameCount() const {
+    return slowFrames.load(std::memory_order_relaxed);
+}
+
+ProfileStage Profiler::getLastSlowStage() const {
+    return static_cast<ProfileStage>(lastSlowStage.load(std::memory_order_relaxed));
+}
+
+void Profiler::toggleOverlay() {
+    overlayVisible = !overlayVisible;
+}
+
+bool Profiler::isOverlayVisible() const {
+    return overlayVisible;
+}
+
+void Profiler::dump() const {
+    char line[96];
+    snprintf(line, sizeof(line), "%-9s %7s %7s %7s %7s %7s %5s\n",
+             "stage", "samples", "min", "p50", "p99", "max", "slow");
+    hal::print(line);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        ProfileStage stage = static_cast<ProfileStage>(i);
+        ProfileStats stats = getStats(stage);
+        snprintf(line, sizeof(line), "%-9s %7lu %7lu %7lu %7lu %7lu %5lu\n", getStageName(stage),
+                 static_cast<unsigned long>(stats.samples), static_cast<unsigned long>(stats.min),
+                 static_cast<unsigned long>(stats.p50), static_cast<unsigned long>(stats.p99),
+                 static_cast<unsigned long>(stats.max),
+                 static_cast<unsigned long>(slowCounts[i].load(std::memory_order_relaxed)));
+        hal::print(line);
+    }
+    snprintf(line, sizeof(line), "slow frames (> %lu us): %lu\n",
+             static_cast<unsigned long>(ProfilerConstants::SLOW_FRAME_MICROS),
+             static_cast<unsigned long>(getSlowFrameCount()));
+    hal::print(line);
+}
+
+const char* Profiler::getStageName(ProfileStage stage) {
+    if (stage >= ProfileStage::COUNT) {
+        return "-";
+    }
+    return STAGE_NAMES[static_cast<int>(stage)];
+}
+
+bool Profiler::isFrameStage(ProfileStage stage) {
+    return stage < ProfileStage::FRAME;
+}
+
+ProfileScope::ProfileScope(Profiler* profiler, ProfileStage stage)
+    : profiler(profiler), stage(stage), start(profiler != nullptr ? hal::micros() : 0) {
+}
+
+ProfileScope::~ProfileScope() {
+    end();
+}
+
+void ProfileScope::end() {
+    if (profiler == nullptr) {
+        return;
+    }
+    profiler->record(stage, hal::micros() - start);
+    profiler = nullptr;
+}
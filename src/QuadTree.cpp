@@ -0,0 +1,224 @@
+#include "QuadTree.h"
+#include <cmath>
+
+QuadTree::QuadTree()
+    : openingAngle(BarnesHutConstants::DEFAULT_OPENING_ANGLE),
+      openingAngleSquared(BarnesHutConstants::DEFAULT_OPENING_ANGLE * BarnesHutConstants::DEFAULT_OPENING_ANGLE) {
+}
+
+void QuadTree::setOpeningAngle(double theta) {
+    openingAngle = theta;
+    openingAngleSquared = theta * theta;
+}
+
+double QuadTree::getOpeningAngle() const {
+    return openingAngle;
+}
+
+size_t QuadTree::getNodeCount() const {
+    return nodes.size();
+}
+
+int QuadTree::createNode(double centerX, double centerY, double halfSize) {
+    Node node;
+    node.centerX = centerX;
+    node.centerY = centerY;
+    node.halfSize = halfSize;
+    node.mass = 0.0;
+    node.massX = 0.0;
+    node.massY = 0.0;
+    node.firstChild = -1;
+    node.body = -1;
+    nodes.push_back(node);
+    return static_cast<int>(nodes.size()) - 1;
+}
+
+int QuadTree::childFor(const Node& node, double x, double y) const {
+    // Children are stored in the order: (-x,-y), (+x,-y), (-x,+y), (+x,+y)
+    int quadrant = (x >= node.centerX ? 1 : 0) + (y >= node.centerY ? 2 : 0);
+    return node.firstChild + quadrant;
+}
+
+void QuadTree::insert(int nodeIndex, int body, int depth) {
+    // Descend until reaching a leaf (indices are used since the pool may reallocate)
+    while (nodes[nodeIndex].firstChild >= 0) {
+        nodeIndex = childFor(nodes[nodeIndex], bodyX[body], bodyY[body]);
+        depth++;
+    }
+
+    // Empty leaf: store the body
+    if (nodes[nodeIndex].body < 0) {
+        nodes[nodeIndex].body = body;
+        return;
+    }
+
+    // Maximum depth reached: chain the body into the same leaf
+    if (depth >= BarnesHutConstants::MAX_DEPTH) {
+        nextBody[body] = nodes[nodeIndex].body;
+        nodes[nodeIndex].body = body;
+        return;
+    }
+
+    // Occupied leaf: split into 4 children and push the resident body down
+    int resident = nodes[nodeIndex].body;
+    double cx = nodes[nodeIndex].centerX;
+    double cy = nodes[nodeIndex].centerY;
+    double quarter = nodes[nodeIndex].halfSize * 0.5;
+
+    int firstChild = createNode(cx - quarter, cy - quarter, quarter);
+    createNode(cx + quarter, cy - quarter, quarter);
+    createNode(cx - quarter, cy + quarter, quarter);
+    createNode(cx + quarter, cy + quarter, quarter);
+
+    nodes[nodeIndex].firstChild = firstChild;
+    nodes[nodeIndex].body = -1;
+
+    insert(childFor(nodes[nodeIndex], bodyX[resident], bodyY[resident]), resident, depth + 1);
+    insert(childFor(nodes[nodeIndex], bodyX[body], bodyY[body]), body, depth + 1);
+}
+
+void QuadTree::computeMassDistribution() {
+    // Children are always created after their parent, so a reverse sweep visits children first
+    for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; i--) {
+        Node& node = nodes[i];
+        double mass = 0.0;
+        double weightedX = 0.0;
+        double weightedY = 0.0;
+
+        if (node.firstChild < 0) {
+            // Leaf: sum all chained bodies
+            for (int b = node.body; b >= 0; b = nextBody[b]) {
+                mass += bodyMass[b];
+                weightedX += bodyMass[b] * bodyX[b];
+                weightedY += bodyMass[b] * bodyY[b];
+            }
+        } else {
+            // Internal node: combine children
+            for (int c = node.firstChild; c < node.firstChild + 4; c++) {
+                mass += nodes[c].mass;
+                weightedX += nodes[c].mass * nodes[c].massX;
+                weightedY += nodes[c].mass * nodes[c].massY;
+            }
+        }
+
+        node.mass = mass;
+        if (mass > 0.0) {
+            node.massX = weightedX / mass;
+            node.massY = weightedY / mass;
+        }
+    }
+}
+
+void QuadTree::build(const BodyStore& bodies) {
+    nodes.clear();
+    bodyX.resize(bodies.size());
+    bodyY.resize(bodies.size());
+    bodyMass.resize(bodies.size());
+    nextBody.assign(bodies.size(), -1);
+
+    if (bodies.empty()) {
+        return;
+    }
+
+    // Compute the bounding square of all planets (the tree always works in double precision)
+    double minX = toDouble(bodies.x[0]);
+    double maxX = minX;
+    double minY = toDouble(bodies.y[0]);
+    double maxY = minY;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodyX[i] = toDouble(bodies.x[i]);
+        bodyY[i] = toDouble(bodies.y[i]);
+        bodyMass[i] = toDouble(bodies.gm[i]);
+        if (bodyX[i] < minX) minX = bodyX[i];
+        if (bodyX[i] > maxX) maxX = bodyX[i];
+        if (bodyY[i] < minY) minY = bodyY[i];
+        if (bodyY[i] > maxY) maxY = bodyY[i];
+    }
+    double halfSize = 0.5 * fmax(maxX - minX, maxY - minY) + 1.0;
+
+    // Reserve the typical node count (about 2 nodes per body) to avoid reallocation
+    nodes.reserve(bodies.size() * 2 + 1);
+    createNode(0.5 * (minX + maxX), 0.5 * (minY + maxY), halfSize);
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        insert(0, static_cast<int>(i), 0);
+    }
+
+    computeMassDistribution();
+}
+
+void QuadTree::calculateAcceleration(size_t planetIndex, double& ax, double& ay) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    const int self = static_cast<int>(planetIndex);
+    const double px = bodyX[planetIndex];
+    const double py = bodyY[planetIndex];
+
+    // Explicit stack (each level pushes at most 4 children)
+    int stack[4 * BarnesHutConstants::MAX_DEPTH + 4];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (node.mass <= 0.0) {
+            continue;
+        }
+
+        // Skip the whole cell if its nearest point is beyond the force cutoff
+        double gapX = fmax(fabs(px - node.centerX) - node.halfSize, 0.0);
+        double gapY = fmax(fabs(py - node.centerY) - node.halfSize, 0.0);
+        if (gapX * gapX + gapY * gapY > PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED) {
+            continue;
+        }
+
+        if (node.firstChild < 0) {
+            // Leaf: exact interaction with every chained body (same kernel as the pairwise loop)
+            for (int b = node.body; b >= 0; b = nextBody[b]) {
+                if (b == self) {
+                    continue;
+                }
+                double dx = bodyX[b] - px;
+                double dy = bodyY[b] - py;
+                double r2 = dx*dx + dy*dy;
+                if (r2 > PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED) {
+                    continue;
+                }
+                if (r2 < PhysicsConstants::MIN_DISTANCE_SQUARED) {
+                    r2 = PhysicsConstants::MIN_DISTANCE_SQUARED;
+                }
+                double r = sqrt(r2);
+                double factor = bodyMass[b] / (r * r2);
+                ax += factor * dx;
+                ay += factor * dy;
+            }
+            continue;
+        }
+
+        // Internal node: approximate as a point mass if it is small enough relative to distance
+        double dx = node.massX - px;
+        double dy = node.massY - py;
+        double r2 = dx*dx + dy*dy;
+        double size = 2.0 * node.halfSize;
+        if (size * size < openingAngleSquared * r2) {
+            if (r2 > PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED) {
+                continue;
+            }
+            if (r2 < PhysicsConstants::MIN_DISTANCE_SQUARED) {
+                r2 = PhysicsConstants::MIN_DISTANCE_SQUARED;
+            }
+            double r = sqrt(r2);
+            double factor = node.mass / (r * r2);
+            ax += factor * dx;
+            ay += factor * dy;
+            continue;
+        }
+
+        // Otherwise open the node
+        for (int c = node.firstChild; c < node.firstChild + 4; c++) {
+            stack[stackSize++] = c;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#include "Random.h"
+
+Random::Random(uint32_t seed) {
+    this->seed(seed);
+}
+
+void Random::seed(uint32_t seed) {
+    // Spread nearby seeds apart; xorshift must not start from 0
+    state = seed * 2654435761U ^ 0x9E3779B9U;
+    if (state == 0) {
+        state = 1;
+    }
+}
+
+long Random::next(long max) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    if (max <= 0) {
+        return 0;
+    }
+    return static_cast<long>(state % static_cast<uint32_t>(max));
+}
+
+uint32_t Random::getState() const {
+    return state;
+}
+
+void Random::setState(uint32_t newState) {
+    state = newState != 0 ? newState : 1;
+}
@@ -1,9 +1,17 @@
 #include "Renderer.h"
 #include "Constants.h"
+#include "Planet.h"
+#include "StateFile.h"
+#include "PixelKernels.h"
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <utility>
 
-Renderer::Renderer(M5GFX& display) 
-    : display(display), canvas(&display), sun(), lastDrawTime(0), particleCount(0), rippleCount(0) {
+Renderer::Renderer(hal::Display& display, Profiler* profiler) 
+    : display(display), profiler(profiler), transport(display), firstCanvas(&display), secondCanvas(&display),
+      canvas(&firstCanvas), spareCanvas(nullptr), textCanvas(&display), hudText(), sun(),
+      canvasStale(true), spareStale(true), fullRedraw(true), pushedBytes(0), rippleCount(0) {
 }
 
 void Renderer::init() {
@@ -11,66 +19,257 @@ void Renderer::init() {
     centerX = display.width() / 2;
     centerY = display.height() / 2;
     
-    // Initialize canvas
-    canvas.createSprite(display.width(), display.height());
-    canvas.setColorDepth(16);  // 16-bit color
+    // Initialize canvases (one frame is drawn while the other is sent; one sprite if memory is short).
+    // A 320x240 sprite takes 150 KB, so two only fit when they go to PSRAM.
+    bool psram = hal::hasPsram();
+    firstCanvas.setPsram(psram);
+    firstCanvas.createSprite(display.width(), display.height());
+    firstCanvas.setColorDepth(16);  // 16-bit color
+    canvas = &firstCanvas;
+    spareCanvas = nullptr;
+    secondCanvas.setPsram(psram);
+    if (secondCanvas.createSprite(display.width(), display.height()) != nullptr) {
+        secondCanvas.setColorDepth(16);
+        spareCanvas = &secondCanvas;
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "renderer: %s, %dx%d sprites in %s\n",
+             spareCanvas != nullptr ? "double-buffered" : "single-buffered", display.width(), display.height(),
+             psram ? "PSRAM" : "internal RAM");
+    hal::print(line);
+    
+    // Pre-render the sun frames, and a line-high sprite for the HUD text
+    sun.prerender(display);
+    textCanvas.setColorDepth(16);
+    textCanvas.createSprite(display.width(), firstCanvas.fontHeight());
+    textCanvas.setTextColor(TFT_WHITE);
+    for (CachedText& line : hudText) {
+        line = CachedText();
+    }
+    
+    // Track dirty areas in screen coordinates
+    drawnRegion.setBounds(display.width(), display.height());
+    previousRegion.setBounds(display.width(), display.height());
+    pushRegion.setBounds(display.width(), display.height());
+    canvasRegion.setBounds(display.width(), display.height());
+    spareRegion.setBounds(display.width(), display.height());
+    canvasStale = true;
+    spareStale = true;
+    fullRedraw = true;
 }
 
-void Renderer::render(const PhysicsEngine& physicsEngine, 
-                      bool isTouching, int touchStartX, int touchStartY) {
-    // Redraw at regular intervals (wider intervals to reduce processing load)
-    unsigned long currentTime = millis();
-    if (currentTime - lastDrawTime <= RenderConstants::DRAW_INTERVAL) {
-        return;  // Skip if drawing interval is too short
+void Renderer::updateSunColor() {
+    sun.updateColor();
+}
+
+void Renderer::handleEvents(const std::vector<SimulationEvent>& events) {
+    for (const auto& event : events) {
+        if (event.type == SimulationEventType::SUN_COLLISION) {
+            // Create firework effect at collision position
+            createFirework(event.x, event.y, event.color);
+            
+            // Play sound effect
+            hal::tone(ToneConstants::COLLISION_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+        } else if (event.type == SimulationEventType::PLANET_MERGE) {
+            // Create firework effect at merge position in the merged planet's color
+            createFirework(event.x, event.y, event.color);
+        }
     }
-    lastDrawTime = currentTime;
+}
+
+void Renderer::saveState(StateWriter& writer) const {
+    particles.saveState(writer);
+    writer.writeBlock(ripples, rippleCount);
+}
+
+bool Renderer::loadState(StateReader& reader) {
+    uint32_t count = 0;
+    bool valid = particles.loadState(reader);
+    valid = valid && reader.readBlock(ripples, count, MAX_RIPPLES);
+    rippleCount = valid ? static_cast<int>(count) : 0;
+    canvasStale = true;
+    spareStale = true;
+    fullRedraw = true;
+    return valid;
+}
+
+void Renderer::render(const SimulationSnapshot& snapshot, 
+                      bool isTouching, int touchStartX, int touchStartY, int touchX, int touchY) {
+    // A single sprite is still being sent until the previous push completes
+    if (!transport.isFree(*canvas)) {
+        ProfileScope pushScope(profiler, ProfileStage::PUSH);
+        transport.wait();
+    }
+    ProfileScope drawScope(profiler, ProfileStage::DRAW);
     
-    // Clear canvas
-    canvas.fillScreen(BLACK);
+    // Erase what was last drawn into this sprite (the rest of it is already black)
+    clearPreviousFrame();
+    drawnRegion.clear();
     
     // Draw the sun
-    sun.draw(canvas, centerX, centerY);
+    sun.draw(*canvas, centerX, centerY);
+    drawnRegion.addCircle(centerX, centerY, sun.getDrawRadius());
     
     // First draw trails for all planets
-    const auto& planets = physicsEngine.getPlanets();
-    for (const auto& planet : planets) {
-        planet.drawTrail(canvas, centerX, centerY);
+    size_t planetCount = snapshot.bodies.size();
+    for (size_t i = 0; i < planetCount; i++) {
+        Planet planet(snapshot.bodies, snapshot.trails, i);
+        planet.drawTrail(*canvas, centerX, centerY);
+        
+        int left, top, right, bottom;
+        planet.getTrailBounds(left, top, right, bottom);
+        drawnRegion.add(centerX + left, centerY + top, right - left + 1, bottom - top + 1);
     }
     
-    // Then draw all planet bodies (overlaid on trails)
-    for (const auto& planet : planets) {
-        planet.draw(canvas, centerX, centerY);
+    // Then draw all planet bodies (overlaid on trails), interpolated to the current time
+    float interpolation = calculateInterpolation(snapshot);
+    for (size_t i = 0; i < planetCount; i++) {
+        Planet planet(snapshot.bodies, snapshot.trails, i);
+        planet.draw(*canvas, centerX, centerY, interpolation);
+        
+        double x, y;
+        planet.getInterpolatedPosition(interpolation, x, y);
+        drawnRegion.addCircle(static_cast<int>(centerX + x), static_cast<int>(centerY + y),
+                              static_cast<int>(planet.getRadius() + 0.5f));
     }
     
     // Draw ripples
     drawRipples();
     
-    // Draw firework particles
+    // Draw firework particles (advanced in the same pass)
     drawParticles();
     
     // If touching, draw drag arrow
     if (isTouching) {
         // Draw small circle at touch start position
-        canvas.drawCircle(touchStartX, touchStartY, PlanetConstants::RADIUS, TFT_WHITE);
+        canvas->drawCircle(touchStartX, touchStartY, PlanetConstants::RADIUS, TFT_WHITE);
+        drawnRegion.addCircle(touchStartX, touchStartY, PlanetConstants::RADIUS);
         
         // Draw arrow from touch start position to current position
-        drawArrow(touchStartX, touchStartY, 
-                  M5.Touch.getDetail().x, M5.Touch.getDetail().y, 
-                  TFT_WHITE);
+        drawArrow(touchStartX, touchStartY, touchX, touchY, TFT_WHITE);
     }
     
     // Display number of planets
-    canvas.setCursor(10, 10);
-    canvas.printf("Planets: %d", physicsEngine.getPlanetCount());
+    char text[32];
+    snprintf(text, sizeof(text), "Planets: %d", static_cast<int>(planetCount));
+    drawText(0, HUD_X, HUD_Y, text);
+    
+    // Display stage timings if requested
+    if (profiler != nullptr && profiler->isOverlayVisible()) {
+        drawProfilerOverlay();
+    }
+    drawScope.end();
     
-    // Transfer canvas content to display
-    canvas.pushSprite(0, 0);
+    // Transfer only the changed areas of the canvas to the display (in the background)
+    {
+        ProfileScope pushScope(profiler, ProfileStage::PUSH);
+        pushDirtyRegion();
+    }
     
     // Update ripples after rendering
     updateRipples();
+}
+
+void Renderer::drawProfilerOverlay() {
+    char text[48];
+    int lineHeight = canvas->fontHeight() + PROFILER_LINE_SPACING;
+    int y = HUD_Y + lineHeight;
+    
+    // One line per stage: median, 99th percentile and worst time (microseconds)
+    int line = 1;
+    snprintf(text, sizeof(text), "%-9s %6s %6s %6s", "us", "p50", "p99", "max");
+    drawText(line++, HUD_X, y, text);
+    for (int i = 0; i < static_cast<int>(ProfileStage::COUNT); i++) {
+        ProfileStage stage = static_cast<ProfileStage>(i);
+        ProfileStats stats = profiler->getStats(stage);
+        y += lineHeight;
+        snprintf(text, sizeof(text), "%-9s %6lu %6lu %6lu", Profiler::getStageName(stage),
+                 static_cast<unsigned long>(stats.p50), static_cast<unsigned long>(stats.p99),
+                 static_cast<unsigned long>(stats.max));
+        drawText(line++, HUD_X, y, text);
+    }
+    
+    // Slow frames and the stage responsible for the last one
+    y += lineHeight;
+    snprintf(text, sizeof(text), "slow %lu (%s)", static_cast<unsigned long>(profiler->getSlowFrameCount()),
+             Profiler::getStageName(profiler->getLastSlowStage()));
+    drawText(line, HUD_X, y, text);
+}
+
+void Renderer::drawText(int line, int x, int y, const char* text) {
+    CachedText& cache = hudText[line];
+    if (textCanvas.getBuffer() == nullptr) {
+        // No scratch sprite: print straight into the frame
+        canvas->setCursor(x, y);
+        canvas->print(text);
+        cache.width = canvas->textWidth(text);
+    } else {
+        if (strcmp(cache.text, text) != 0) {
+            snprintf(cache.text, sizeof(cache.text), "%s", text);
+            cache.width = textCanvas.textWidth(text);
+            textCanvas.fillScreen(BLACK);
+            textCanvas.setCursor(0, 0);
+            textCanvas.print(text);
+            cache.stencil.capture(textCanvas, 0, 0);
+        }
+        pixel::Target target(*canvas);
+        pixel::fillStencil(target, cache.stencil, x, y, TFT_WHITE);
+    }
+    drawnRegion.add(x, y, cache.width, canvas->fontHeight());
+}
+
+void Renderer::clearPreviousFrame() {
+    if (canvasStale) {
+        canvas->fillScreen(BLACK);
+        return;
+    }
+    for (int i = 0; i < canvasRegion.getCount(); i++) {
+        const DirtyRect& rect = canvasRegion.getRect(i);
+        canvas->fillRect(rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, BLACK);
+    }
+}
+
+void Renderer::pushDirtyRegion() {
+    // Pixels change only where something was drawn now or erased from the previous frame
+    pushRegion.clear();
+    if (fullRedraw) {
+        pushRegion.addAll();
+    } else {
+        pushRegion.add(drawnRegion);
+        pushRegion.add(previousRegion);
+    }
+    
+    // The display clips the sprite transfer, so only the rectangles are sent; the next
+    // frame is drawn into the other sprite while this one is on its way
+    transport.push(*canvas, pushRegion);
+    
+    pushedBytes = pushRegion.getArea() * RenderConstants::BYTES_PER_PIXEL;
+    previousRegion = drawnRegion;
+    canvasRegion = drawnRegion;
+    canvasStale = false;
+    fullRedraw = false;
+    if (spareCanvas != nullptr) {
+        std::swap(canvas, spareCanvas);
+        std::swap(canvasRegion, spareRegion);
+        std::swap(canvasStale, spareStale);
+    }
+}
+
+uint32_t Renderer::getPushedBytes() const {
+    return pushedBytes;
+}
+
+void Renderer::flush() {
+    transport.wait();
+}
+
+float Renderer::calculateInterpolation(const SimulationSnapshot& snapshot) const {
+    // Time since the snapshot's last step = leftover at publish + time since publish
+    uint32_t sinceStep = snapshot.accumulatorMicros + (static_cast<uint32_t>(hal::micros()) - snapshot.publishMicros);
+    float interpolation = static_cast<float>(sinceStep) / snapshot.stepMicros;
     
-    // Update particles after rendering
-    updateParticles();
+    // Clamp when physics is behind (never extrapolate past the current state)
+    return interpolation < 1.0f ? interpolation : 1.0f;
 }
 
 int Renderer::getCenterX() const {
@@ -91,7 +290,8 @@ int Renderer::getMaxBoundsY() const {
 
 void Renderer::drawArrow(int startX, int startY, int endX, int endY, uint16_t color, int headSize) {
     // Draw line
-    canvas.drawLine(startX, startY, endX, endY, color);
+    canvas->drawLine(startX, startY, endX, endY, color);
+    drawnRegion.addLine(startX, startY, endX, endY, headSize * 3 / 2);  // Head reaches ~1.12 * headSize
     
     // Calculate direction vector of arrow
     float dx = endX - startX;
@@ -125,52 +325,12 @@ void Renderer::drawArrow(int startX, int startY, int endX, int endY, uint16_t co
     int y3 = arrowY - headSize * dy - headSize * 0.5 * perpY;
     
     // Draw filled triangle
-    canvas.fillTriangle(x1, y1, x2, y2, x3, y3, color);
+    canvas->fillTriangle(x1, y1, x2, y2, x3, y3, color);
 }
 
 void Renderer::createFirework(double x, double y, uint16_t color) {
-    // Create particles for firework effect
-    for (int i = 0; i < FireworkConstants::PARTICLE_COUNT; i++) {
-        if (particleCount >= MAX_PARTICLES) {
-            break;  // Maximum particles reached
-        }
-        
-        // Random angle (0-360 degrees)
-        float angle = random(360) * DEG_TO_RAD;
-        
-        // Random speed variation (0.7x to 1.3x of base speed)
-        float speed = FireworkConstants::PARTICLE_SPEED * (0.7f + random(60) / 100.0f);
-        
-        // Set particle properties
-        particles[particleCount].x = x;
-        particles[particleCount].y = y;
-        particles[particleCount].vx = speed * cos(angle);
-        particles[particleCount].vy = speed * sin(angle);
-        particles[particleCount].color = color;
-        particles[particleCount].lifetime = FireworkConstants::PARTICLE_LIFETIME;
-        particles[particleCount].initialLifetime = FireworkConstants::PARTICLE_LIFETIME;
-        
-        particleCount++;
-    }
-}
-
-void Renderer::updateParticles() {
-    // Update all particles
-    for (int i = particleCount - 1; i >= 0; i--) {
-        // Update position
-        particles[i].x += particles[i].vx;
-        particles[i].y += particles[i].vy;
-        
-        // Decrease lifetime
-        particles[i].lifetime--;
-        
-        // Remove dead particles
-        if (particles[i].lifetime <= 0) {
-            // Move last particle to current position (to maintain compact array)
-            particles[i] = particles[particleCount - 1];
-            particleCount--;
-        }
-    }
+    // Burst from a random rotation of the velocity table (the oldest particles make room if the pool is full)
+    particles.spawn(x, y, color, FireworkConstants::PARTICLE_COUNT, hal::random(FireworkConstants::VELOCITY_TABLE_SIZE));
 }
 
 uint16_t Renderer::alphaBlend(uint16_t fg, uint8_t alpha) const {
@@ -189,22 +349,24 @@ uint16_t Renderer::alphaBlend(uint16_t fg, uint8_t alpha) const {
 }
 
 void Renderer::drawParticles() {
-    for (int i = 0; i < particleCount; i++) {
+    pixel::Target target(*canvas);
+    particles.drawAndAdvance([this, &target](int x, int y, uint16_t color, int lifetime) {
         // Calculate alpha based on remaining lifetime
-        uint8_t alpha = 255 * particles[i].lifetime / particles[i].initialLifetime;
+        uint8_t alpha = 255 * lifetime / FireworkConstants::PARTICLE_LIFETIME;
         
         // Calculate particle size (shrinks as it fades)
         int radius = 2 * alpha / 255;
         if (radius < 1) radius = 1;
         
         // Calculate screen position
-        int screenX = centerX + static_cast<int>(particles[i].x);
-        int screenY = centerY + static_cast<int>(particles[i].y);
+        int screenX = centerX + x;
+        int screenY = centerY + y;
         
-        // Draw particle with alpha blending
-        uint16_t blendedColor = alphaBlend(particles[i].color, alpha);
-        canvas.fillCircle(screenX, screenY, radius, blendedColor);
-    }
+        // Add the faded color, so overlapping sparks glow brighter
+        uint16_t blendedColor = alphaBlend(color, alpha);
+        pixel::addDisc(target, screenX, screenY, radius, blendedColor);
+        drawnRegion.addCircle(screenX, screenY, radius);
+    });
 }
 
 void Renderer::createRipple(double x, double y, uint16_t color) {
@@ -257,13 +419,14 @@ void Renderer::drawRipples() {
         
         // Draw ripple with alpha blending
         uint16_t blendedColor = alphaBlend(ripples[i].color, alpha);
-        canvas.drawCircle(screenX, screenY, radius, blendedColor);
+        canvas->drawCircle(screenX, screenY, radius, blendedColor);
+        drawnRegion.addCircle(screenX, screenY, radius);
         
         // Draw a second, inner ripple ring for enhanced effect
         if (radius > 4) {
             uint8_t innerAlpha = alpha * 0.5;  // Inner ring is more transparent
             uint16_t innerBlendedColor = alphaBlend(ripples[i].color, innerAlpha);
-            canvas.drawCircle(screenX, screenY, radius - 3, innerBlendedColor);
+            canvas->drawCircle(screenX, screenY, radius - 3, innerBlendedColor);
         }
     }
 }
@@ -0,0 +1,126 @@
+#include "Scheduler.h"
+#include <cstdio>
+
+Scheduler::Scheduler(Clock clock, Sleep sleep)
+    : clock(clock), sleep(sleep), jobs(), jobCount(0), idleMicros(0), elapsedMicros(0), lastTally(0) {
+}
+
+int Scheduler::add(const char* name, uint32_t periodMicros, int priority, Job job) {
+    if (jobCount >= MAX_JOBS) {
+        return -1;
+    }
+    uint32_t now = clock();
+    if (jobCount == 0) {
+        lastTally = now;
+    }
+    Entry& entry = jobs[jobCount];
+    entry.name = name;
+    entry.period = periodMicros;
+    entry.priority = priority;
+    entry.deadline = now;
+    entry.job = job;
+    entry.stats = JobStats();
+    return jobCount++;
+}
+
+void Scheduler::setPeriod(int id, uint32_t periodMicros) {
+    jobs[id].period = periodMicros;
+}
+
+void Scheduler::restart(int id) {
+    jobs[id].deadline = clock() + jobs[id].period;
+}
+
+void Scheduler::runOnce() {
+    // Run every due job once, the highest priority first (ties go to the earliest deadline)
+    bool ran[MAX_JOBS] = {};
+    while (true) {
+        uint32_t now = clock();
+        Entry* next = nullptr;
+        for (int i = 0; i < jobCount; i++) {
+            Entry& entry = jobs[i];
+            if (ran[i] || static_cast<int32_t>(now - entry.deadline) < 0) {
+                continue;
+            }
+            if (next == nullptr || entry.priority > next->priority ||
+                (entry.priority == next->priority &&
+                 static_cast<int32_t>(entry.deadline - next->deadline) < 0)) {
+                next = &entry;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+        ran[next - jobs] = true;
+        run(*next, now);
+    }
+
+    // Sleep until the earliest deadline
+    if (jobCount == 0) {
+        return;
+    }
+    uint32_t wake = jobs[0].deadline;
+    for (int i = 1; i < jobCount; i++) {
+        if (static_cast<int32_t>(jobs[i].deadline - wake) < 0) {
+            wake = jobs[i].deadline;
+        }
+    }
+    uint32_t start = clock();
+    if (static_cast<int32_t>(wake - start) > 0) {
+        sleep(wake);
+        uint32_t end = clock();
+        idleMicros += end - start;
+        tally(end);
+    } else {
+        tally(start);
+    }
+}
+
+void Scheduler::run(Entry& entry, uint32_t now) {
+    // Report starts later than the tolerance (a job of every pass has no deadline to be late for)
+    uint32_t late = entry.period > 0 ? now - entry.deadline : 0;
+    if (late > SchedulerConstants::LATE_TOLERANCE) {
+        entry.stats.lateRuns++;
+    }
+    if (late > entry.stats.maxLateMicros) {
+        entry.stats.maxLateMicros = late;
+    }
+    entry.stats.runs++;
+
+    // Keep the cadence: the next deadline is one period after this one, not after now
+    if (entry.period == 0) {
+        entry.deadline = now;
+    } else {
+        entry.deadline += entry.period;
+        if (static_cast<int32_t>(now - entry.deadline) >= 0) {
+            uint32_t missed = (now - entry.deadline) / entry.period + 1;
+            entry.stats.skippedPeriods += missed;
+            entry.deadline += missed * entry.period;
+        }
+    }
+    entry.job();
+}
+
+void Scheduler::tally(uint32_t now) {
+    elapsedMicros += now - lastTally;
+    lastTally = now;
+}
+
+void Scheduler::dump() const {
+    char line[96];
+    snprintf(line, sizeof(line), "%-9s %7s %7s %7s %7s %7s\n", "job", "period", "runs", "late", "skipped", "maxlate");
+    hal::print(line);
+    for (int i = 0; i < jobCount; i++) {
+        const Entry& entry = jobs[i];
+        snprintf(line, sizeof(line), "%-9s %7lu %7lu %7lu %7lu %7lu\n", entry.name,
+                 static_cast<unsigned long>(entry.period), static_cast<unsigned long>(entry.stats.runs),
+                 static_cast<unsigned long>(entry.stats.lateRuns),
+                 static_cast<unsigned long>(entry.stats.skippedPeriods),
+                 static_cast<unsigned long>(entry.stats.maxLateMicros));
+        hal::print(line);
+    }
+    unsigned long percent = elapsedMicros > 0 ? static_cast<unsigned long>(idleMicros * 100 / elapsedMicros) : 0;
+    snprintf(line, sizeof(line), "idle %lu%% (%llu of %llu us)\n", percent,
+             static_cast<unsigned long long>(idleMicros), static_cast<unsigned long long>(elapsedMicros));
+    hal::print(line);
+}
@@ -0,0 +1,126 @@
+#include "SimdGravity.h"
+#include "Simd.h"
+#include "GravityKernel.h"
+#include <algorithm>
+
+namespace {
+#if defined(GRAVSIM_SIMD_X86) && !defined(GRAVSIM_SCALAR_FIXED)
+    /**
+     * Tile kernel for one vector type (inlined into a function compiled for its instruction set)
+     */
+    template <typename V>
+    __attribute__((always_inline)) inline void accumulateTiles(const Real* x, const Real* y, const Real* gm,
+                                                                size_t count, size_t begin, size_t end,
+                                                                Real* ax, Real* ay) {
+        typedef typename V::Scalar T;
+        const V maxDistanceSquared = V::broadcast(T(PhysicsConstants::MAX_FORCE_DISTANCE_SQUARED));
+        const V minDistanceSquared = V::broadcast(T(PhysicsConstants::MIN_DISTANCE_SQUARED));
+        const V half = V::broadcast(T(0.5));
+        const V threeHalves = V::broadcast(T(1.5));
+        const size_t vectorEnd = count - count % V::WIDTH;
+
+        for (size_t i = begin; i < end; i++) {
+            const V xi = V::broadcast(x[i]);
+            const V yi = V::broadcast(y[i]);
+            V sumX = V::broadcast(T(0));
+            V sumY = V::broadcast(T(0));
+
+            // The planet itself gives dx = dy = 0, which clamps to MIN_DISTANCE and adds nothing
+            for (size_t j = 0; j < vectorEnd; j += V::WIDTH) {
+                V dx = V::load(x + j) - xi;
+                V dy = V::load(y + j) - yi;
+                V r2 = dx*dx + dy*dy;
+                V inRange = V::lessEqual(r2, maxDistanceSquared);
+                r2 = V::max(r2, minDistanceSquared);
+
+                // 1/r from the estimate, refined by Newton steps y' = y * (3/2 - r^2 * y^2 / 2)
+                V invR = V::rsqrtEstimate(r2);
+                for (int step = 0; step < V::NEWTON_STEPS; step++) {
+                    invR = invR * (threeHalves - half * r2 * invR * invR);
+                }
+                V factor = V::select(inRange, V::load(gm + j) * (invR * invR * invR));
+                sumX = sumX + factor * dx;
+                sumY = sumY + factor * dy;
+            }
+
+            // Planets past the last full tile
+            T accelX = sumX.sum();
+            T accelY = sumY.sum();
+            for (size_t j = vectorEnd; j < count; j++) {
+                T pairX, pairY;
+                if (j != i && GravityKernel<T>::pair(x[j] - x[i], y[j] - y[i], gm[j], pairX, pairY)) {
+                    accelX += pairX;
+                    accelY += pairY;
+                }
+            }
+            ax[i] += accelX;
+            ay[i] += accelY;
+        }
+    }
+
+    void accumulateSse2(const Real* x, const Real* y, const Real* gm, size_t count, size_t begin, size_t end,
+                        Real* ax, Real* ay) {
+        accumulateTiles<simd::VectorsOf<Real>::Sse2>(x, y, gm, count, begin, end, ax, ay);
+    }
+
+    GRAVSIM_TARGET_AVX2 void accumulateAvx2(const Real* x, const Real* y, const Real* gm, size_t count,
+                                            size_t begin, size_t end, Real* ax, Real* ay) {
+        accumulateTiles<simd::VectorsOf<Real>::Avx2>(x, y, gm, count, begin, end, ax, ay);
+    }
+#endif
+
+    /**
+     * Instruction set in use (detected on first use)
+     */
+    SimdGravity::InstructionSet& selected() {
+        static SimdGravity::InstructionSet set = SimdGravity::detectInstructionSet();
+        return set;
+    }
+}
+
+namespace SimdGravity {
+    InstructionSet detectInstructionSet() {
+#if defined(GRAVSIM_SIMD_X86) && !defined(GRAVSIM_SCALAR_FIXED)
+        __builtin_cpu_init();  // Needed when called before static constructors have run
+        return __builtin_cpu_supports("avx2") ? InstructionSet::AVX2 : InstructionSet::SSE2;
+#else
+        return InstructionSet::SCALAR;
+#endif
+    }
+
+    InstructionSet getInstructionSet() {
+        return selected();
+    }
+
+    InstructionSet setInstructionSet(InstructionSet set) {
+        selected() = std::min(set, detectInstructionSet());
+        return selected();
+    }
+
+    const char* getName(InstructionSet set) {
+        switch (set) {
+            case InstructionSet::AVX2: return "avx2";
+            case InstructionSet::SSE2: return "sse2";
+            default: return "scalar";
+        }
+    }
+
+    // (the parameters are unused when no kernel is compiled in, e.g. in fixed-point builds)
+    bool accumulate([[maybe_unused]] const Real* x, [[maybe_unused]] const Real* y,
+                    [[maybe_unused]] const Real* gm, [[maybe_unused]] size_t count,
+                    [[maybe_unused]] size_t begin, [[maybe_unused]] size_t end,
+                    [[maybe_unused]] Real* ax, [[maybe_unused]] Real* ay) {
+        switch (selected()) {
+#if defined(GRAVSIM_SIMD_X86) && !defined(GRAVSIM_SCALAR_FIXED)
+            case InstructionSet::AVX2:
+                accumulateAvx2(x, y, gm, count, begin, end, ax, ay);
+                return true;
+            case InstructionSet::SSE2:
+                accumulateSse2(x, y, gm, count, begin, end, ax, ay);
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+}
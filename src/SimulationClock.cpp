@@ -0,0 +1,58 @@
+#include "SimulationClock.h"
+
+SimulationClock::SimulationClock(uint32_t stepMicros, int maxCatchUpSteps)
+    : stepMicros(stepMicros),
+      maxCatchUpSteps(maxCatchUpSteps),
+      lastMicros(0),
+      accumulatorMicros(0),
+      stepCount(0),
+      droppedMicros(0) {
+}
+
+void SimulationClock::setStepMicros(uint32_t newStepMicros) {
+    stepMicros = newStepMicros;
+}
+
+void SimulationClock::reset(uint32_t nowMicros) {
+    lastMicros = nowMicros;
+    accumulatorMicros = 0;
+}
+
+int SimulationClock::advance(uint32_t nowMicros) {
+    // Unsigned subtraction handles wrap-around of the microsecond counter
+    accumulatorMicros += nowMicros - lastMicros;
+    lastMicros = nowMicros;
+
+    int steps = static_cast<int>(accumulatorMicros / stepMicros);
+    if (steps > maxCatchUpSteps) {
+        // Too far behind: run the cap and drop the rest of the lag
+        droppedMicros += (steps - maxCatchUpSteps) * stepMicros;
+        steps = maxCatchUpSteps;
+        accumulatorMicros %= stepMicros;
+    } else {
+        accumulatorMicros -= steps * stepMicros;
+    }
+
+    stepCount += steps;
+    return steps;
+}
+
+uint32_t SimulationClock::getAccumulatorMicros() const {
+    return accumulatorMicros;
+}
+
+float SimulationClock::getAlpha() const {
+    return static_cast<float>(accumulatorMicros) / stepMicros;
+}
+
+uint32_t SimulationClock::getStepCount() const {
+    return stepCount;
+}
+
+uint32_t SimulationClock::getDroppedMicros() const {
+    return droppedMicros;
+}
+
+uint32_t SimulationClock::getStepMicros() const {
+    return stepMicros;
+}
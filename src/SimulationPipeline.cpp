@@ -0,0 +1,213 @@
+#include "SimulationPipeline.h"
+
+SimulationPipeline::SimulationPipeline(PhysicsEngine& physicsEngine, Profiler* profiler)
+    : physicsEngine(physicsEngine),
+      profiler(profiler),
+      reportingSpawns(false),
+      maxX(0),
+      maxY(0),
+      clock(ClockConstants::STEP_MICROS, ClockConstants::MAX_CATCH_UP_STEPS),
+      carryEvents(false),
+      running(false),
+      pauseRequested(false),
+      paused(false)
+#if defined(ARDUINO)
+      , task(nullptr)
+#endif
+{
+    reserveSnapshots();
+    for (int i = 0; i < 3; i++) {
+        SimulationSnapshot& snapshot = snapshots.getBuffer(i);
+        snapshot.step = 0;
+        snapshot.publishMicros = 0;
+        snapshot.accumulatorMicros = 0;
+        snapshot.stepMicros = ClockConstants::STEP_MICROS;
+    }
+}
+
+SimulationPipeline::~SimulationPipeline() {
+    stop();
+}
+
+void SimulationPipeline::start(int boundsX, int boundsY) {
+    maxX = boundsX;
+    maxY = boundsY;
+    running = true;
+
+    // A loaded state, a solver switch or a planet limit may have raised the engine's limits
+    reserveSnapshots();
+
+    // One physics step covers the engine's time step of simulated (and wall) time
+    clock.setStepMicros(static_cast<uint32_t>(ClockConstants::STEP_MICROS * physicsEngine.getTimeStep() + 0.5));
+    clock.reset(hal::micros());
+
+#if defined(ARDUINO)
+    // Run physics on the core the Arduino loop (rendering) does not use
+    xTaskCreatePinnedToCore(taskEntry, "physics",
+                            PipelineConstants::PHYSICS_TASK_STACK_SIZE, this,
+                            PipelineConstants::PHYSICS_TASK_PRIORITY, &task,
+                            PipelineConstants::PHYSICS_TASK_CORE);
+#else
+    thread = std::thread(taskEntry, this);
+#endif
+}
+
+void SimulationPipeline::stop() {
+    running = false;
+#if !defined(ARDUINO)
+    if (thread.joinable()) {
+        thread.join();
+    }
+#endif
+}
+
+void SimulationPipeline::pause() {
+    if (!running) {
+        return;
+    }
+    pauseRequested = true;
+    while (!paused) {
+        hal::delay(PipelineConstants::PHYSICS_POLL_INTERVAL);
+    }
+}
+
+void SimulationPipeline::resume() {
+    if (!running) {
+        return;
+    }
+    pauseRequested = false;
+    while (paused) {
+        hal::delay(PipelineConstants::PHYSICS_POLL_INTERVAL);
+    }
+}
+
+void SimulationPipeline::startLockstep(int boundsX, int boundsY) {
+    maxX = boundsX;
+    maxY = boundsY;
+    reserveSnapshots();
+}
+
+void SimulationPipeline::runStep() {
+    step();
+    publishSnapshot();
+}
+
+void SimulationPipeline::setReportingSpawns(bool enabled) {
+    reportingSpawns = enabled;
+}
+
+bool SimulationPipeline::takeAppliedSpawn(PlanetSpawn& spawn) {
+    return appliedQueue.pop(spawn);
+}
+
+void SimulationPipeline::taskEntry(void* arg) {
+    static_cast<SimulationPipeline*>(arg)->run();
+#if defined(ARDUINO)
+    vTaskDelete(nullptr);
+#endif
+}
+
+void SimulationPipeline::run() {
+    while (running) {
+        // Hold between steps while the render side reads the engine (state saving)
+        if (pauseRequested) {
+            paused = true;
+            while (pauseRequested && running) {
+                hal::delay(PipelineConstants::PHYSICS_POLL_INTERVAL);
+            }
+            clock.reset(hal::micros());
+            paused = false;
+            continue;
+        }
+
+        tick();
+
+        // Yield between polls (also lets the idle task feed the watchdog on device)
+        hal::delay(PipelineConstants::PHYSICS_POLL_INTERVAL);
+    }
+}
+
+void SimulationPipeline::tick() {
+    // Run as many fixed steps as wall time demands
+    int steps = clock.advance(hal::micros());
+    if (steps == 0) {
+        return;
+    }
+    for (int i = 0; i < steps; i++) {
+        step();
+    }
+    publishSnapshot();
+}
+
+void SimulationPipeline::step() {
+    // Add planets requested by the touch handler (applied at a step boundary)
+    PlanetSpawn spawn;
+    while (spawnQueue.pop(spawn)) {
+        physicsEngine.addPlanet(spawn.x, spawn.y, spawn.vx, spawn.vy, spawn.color);
+        if (reportingSpawns) {
+            spawn.appliedStep = physicsEngine.getStepCount();
+            appliedQueue.push(spawn);  // Same capacity as spawnQueue, drained every render loop
+        }
+    }
+
+    // Update physics simulation
+    {
+        ProfileScope scope(profiler, ProfileStage::PHYSICS);
+        physicsEngine.update();
+    }
+
+    // Merge planets that touch each other
+    {
+        ProfileScope scope(profiler, ProfileStage::MERGE);
+        physicsEngine.mergeCollidingPlanets();
+    }
+
+    // Remove planets that are out of bounds, then reclaim their trail space in one pass
+    ProfileScope scope(profiler, ProfileStage::CULL);
+    physicsEngine.removeOutOfBoundsPlanets(maxX, maxY);
+    physicsEngine.compactPlanets();
+}
+
+void SimulationPipeline::publishSnapshot() {
+    SimulationSnapshot& snapshot = snapshots.getWriteBuffer();
+
+    // Keep events of a snapshot that was replaced before the render side read it
+    if (!carryEvents) {
+        snapshot.events.clear();
+    }
+    physicsEngine.takeEvents(snapshot.events);
+
+    // Copy the state (capacity is reserved, so this does not allocate)
+    snapshot.bodies = physicsEngine.getBodies();
+    snapshot.trails = physicsEngine.getTrails();
+    snapshot.step = physicsEngine.getStepCount();
+    snapshot.publishMicros = hal::micros();
+    snapshot.accumulatorMicros = clock.getAccumulatorMicros();
+    snapshot.stepMicros = clock.getStepMicros();
+
+    carryEvents = snapshots.publish();
+}
+
+void SimulationPipeline::reserveSnapshots() {
+    size_t maxCount = physicsEngine.getMaxPlanetCount();
+    const TrailPool& trails = physicsEngine.getTrails();
+    for (int i = 0; i < 3; i++) {
+        SimulationSnapshot& snapshot = snapshots.getBuffer(i);
+        snapshot.bodies.reserve(maxCount);
+        snapshot.trails.setBudget(trails.getBudget(), trails.getMaxLength());
+        snapshot.trails.reserve(maxCount);
+        snapshot.events.reserve(PipelineConstants::MAX_PENDING_EVENTS);
+    }
+}
+
+bool SimulationPipeline::requestPlanet(const PlanetSpawn& spawn) {
+    return spawnQueue.push(spawn);
+}
+
+bool SimulationPipeline::acquireSnapshot() {
+    return snapshots.acquire();
+}
+
+const SimulationSnapshot& SimulationPipeline::getSnapshot() const {
+    return snapshots.getReadBuffer();
+}
@@ -0,0 +1,66 @@
+#include "SpatialGrid.h"
+#include <cmath>
+
+SpatialGrid::SpatialGrid(double cellSize, double halfExtent)
+    : cellSize(cellSize),
+      halfExtent(halfExtent),
+      columns(static_cast<int>(ceil(2.0 * halfExtent / cellSize))),
+      cells(columns * columns),
+      relocationCount(0) {
+}
+
+int SpatialGrid::cellFor(double x, double y) const {
+    // Clamping keeps neighbouring positions in neighbouring cells, so no pair is missed
+    int cx = static_cast<int>(floor((x + halfExtent) / cellSize));
+    int cy = static_cast<int>(floor((y + halfExtent) / cellSize));
+    cx = constrain(cx, 0, columns - 1);
+    cy = constrain(cy, 0, columns - 1);
+    return cy * columns + cx;
+}
+
+void SpatialGrid::insert(int body, int cell) {
+    bodyCell[body] = cell;
+    bodySlot[body] = static_cast<int>(cells[cell].size());
+    cells[cell].push_back(body);
+}
+
+void SpatialGrid::remove(int body) {
+    std::vector<int>& cell = cells[bodyCell[body]];
+    int slot = bodySlot[body];
+    int last = cell.back();
+    cell[slot] = last;
+    bodySlot[last] = slot;
+    cell.pop_back();
+}
+
+void SpatialGrid::update(const BodyStore& bodies, bool rebuild) {
+    relocationCount = 0;
+
+    if (rebuild || bodyCell.size() != bodies.size()) {
+        // Full rebuild (planets were added or removed, so indices shifted)
+        for (auto& cell : cells) {
+            cell.clear();
+        }
+        bodyCell.resize(bodies.size());
+        bodySlot.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++) {
+            insert(static_cast<int>(i), cellFor(toDouble(bodies.x[i]), toDouble(bodies.y[i])));
+        }
+        relocationCount = bodies.size();
+        return;
+    }
+
+    // Incremental update: only move planets that crossed a cell boundary
+    for (size_t i = 0; i < bodies.size(); i++) {
+        int cell = cellFor(toDouble(bodies.x[i]), toDouble(bodies.y[i]));
+        if (cell != bodyCell[i]) {
+            remove(static_cast<int>(i));
+            insert(static_cast<int>(i), cell);
+            relocationCount++;
+        }
+    }
+}
+
+size_t SpatialGrid::getRelocationCount() const {
+    return relocationCount;
+}
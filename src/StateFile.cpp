@@ -0,0 +1,70 @@
+#include "StateFile.h"
+#include "Hal.h"
+#include "PhysicsEngine.h"
+#include "Renderer.h"
+#include "TouchHandler.h"
+#include <cstring>
+
+namespace {
+    const char MAGIC[4] = {'G', 'S', 'S', 'T'};  // File signature
+    constexpr uint16_t VERSION = 2;               // Format version (2: particles stored per field)
+}
+
+StateFile::StateFile(PhysicsEngine& physicsEngine, Renderer& renderer, TouchHandler& touchHandler)
+    : physicsEngine(physicsEngine), renderer(renderer), touchHandler(touchHandler) {
+}
+
+bool StateFile::save(const char* name) const {
+    char temporary[48];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", name);
+    FILE* file = hal::openFile(temporary, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = write(file);
+    written = fclose(file) == 0 && written;
+    return written && hal::renameFile(temporary, name);
+}
+
+bool StateFile::load(const char* name) {
+    FILE* file = hal::openFile(name, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool loaded = read(file);
+    fclose(file);
+    return loaded;
+}
+
+bool StateFile::write(FILE* file) const {
+    StateWriter writer(file);
+    for (char c : MAGIC) {
+        writer.write(c);
+    }
+    writer.write(VERSION);
+    writer.write(REAL_TYPE_ID);  // Values are stored in memory layout
+    writer.write(static_cast<uint8_t>(sizeof(Real)));
+    physicsEngine.saveState(writer);
+    renderer.saveState(writer);
+    touchHandler.saveState(writer);
+    return writer.ok();
+}
+
+bool StateFile::read(FILE* file) {
+    StateReader reader(file);
+    char magic[4];
+    uint16_t version = 0;
+    uint8_t scalarType = 0;
+    uint8_t scalarSize = 0;
+    for (char& c : magic) {
+        reader.read(c);
+    }
+    reader.read(version);
+    reader.read(scalarType);
+    reader.read(scalarSize);
+    if (!reader.ok() || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION ||
+        scalarType != REAL_TYPE_ID || scalarSize != sizeof(Real)) {
+        return false;
+    }
+    return physicsEngine.loadState(reader) && renderer.loadState(reader) && touchHandler.loadState(reader);
+}
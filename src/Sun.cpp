@@ -1,36 +1,59 @@
 #include "Sun.h"
 #include <cmath>
 
-Sun::Sun() : cachedColor(SunConstants::BASE_COLOR), lastColorUpdateTime(0) {
+Sun::Sun() : cachedColor(SunConstants::BASE_COLOR) {
 }
 
-void Sun::draw(M5Canvas& canvas, int centerX, int centerY) {
-    // Update cached color periodically (not every frame for optimization)
-    unsigned long currentTime = millis();
-    if (currentTime - lastColorUpdateTime > COLOR_UPDATE_INTERVAL) {
-        cachedColor = calculateColor();
-        lastColorUpdateTime = currentTime;
+void Sun::updateColor() {
+    cachedColor = calculateColor();
+}
+
+void Sun::draw(hal::Canvas& canvas, int centerX, int centerY) {
+    // Fill a random pre-rendered frame with the cached color
+    if (frames.empty()) {
+        rasterize(canvas, centerX, centerY, cachedColor);
+        return;
     }
-    
-    // Draw the sun using cached color
-    canvas.fillCircle(centerX, centerY, SunConstants::RADIUS, cachedColor);
+    pixel::Target target(canvas);
+    pixel::fillStencil(target, frames[hal::random(SunConstants::FRAME_COUNT)], centerX, centerY, cachedColor);
+}
+
+void Sun::prerender(hal::Display& display) {
+    int size = 2 * getDrawRadius() + 1;
+    hal::Canvas scratch(&display);
+    scratch.setColorDepth(16);
+    if (scratch.createSprite(size, size) == nullptr) {
+        return;
+    }
+    frames.resize(SunConstants::FRAME_COUNT);
+    for (pixel::Stencil& frame : frames) {
+        scratch.fillScreen(BLACK);
+        rasterize(scratch, size / 2, size / 2, TFT_WHITE);
+        frame.capture(scratch, size / 2, size / 2);
+    }
+}
+
+void Sun::rasterize(hal::Canvas& canvas, int centerX, int centerY, uint16_t color) {
+    // Draw the sun body
+    canvas.fillCircle(centerX, centerY, SunConstants::RADIUS, color);
     
     // Draw rays from the sun
     for (int i = 0; i < 10; i++) {
         // Random angle (0-359 degrees)
-        float angle = random(360) * DEG_TO_RAD;
+        float angle = hal::random(360) * DEG_TO_RAD;
         
         // Line start point (sun center)
         int startX = centerX;
         int startY = centerY;
         
-        // Line end point (15 pixels from sun center, at random angle)
-        int length = 10 + random(3);
-        int endX = centerX + length * cos(angle);
-        int endY = centerY + length * sin(angle);
+        // Line end point (15 pixels from sun center, at random angle; the offset is truncated
+        // on its own so a ray has the same shape wherever the sun is drawn)
+        int length = RAY_MIN_LENGTH + hal::random(RAY_LENGTH_VARIATION);
+        int endX = centerX + static_cast<int>(length * cos(angle));
+        int endY = centerY + static_cast<int>(length * sin(angle));
         
         // Draw line (same color as sun)
-        canvas.drawLine(startX, startY, endX, endY, cachedColor);
+        canvas.drawLine(startX, startY, endX, endY, color);
     }
 }
 
@@ -41,7 +64,7 @@ uint16_t Sun::calculateColor() {
     uint8_t baseB = SunConstants::BASE_COLOR & 0x1F;
     
     // Generate random brightness fluctuation (range 0.7-1.3)
-    float brightness = 1.0f + (random(-100, 101) / 100.0f) * SunConstants::BRIGHTNESS_FLUCTUATION;
+    float brightness = 1.0f + (hal::random(-100, 101) / 100.0f) * SunConstants::BRIGHTNESS_FLUCTUATION;
     
     // Apply brightness to color components (ensuring they stay within range)
     uint8_t r = constrain(baseR * brightness, 0, 31);
@@ -59,3 +82,8 @@ double Sun::getMass() const {
 int Sun::getRadius() const {
     return SunConstants::RADIUS;
 }
+
+int Sun::getDrawRadius() const {
+    int rayLength = RAY_MIN_LENGTH + RAY_LENGTH_VARIATION - 1;
+    return rayLength > SunConstants::RADIUS ? rayLength : SunConstants::RADIUS;
+}
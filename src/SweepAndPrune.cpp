@@ -0,0 +1,69 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+SweepAndPrune::SweepAndPrune() : testCount(0) {
+}
+
+void SweepAndPrune::findContacts(const BodyStore& bodies, bool rebuild, std::vector<std::pair<int, int>>& contacts) {
+    contacts.clear();
+    testCount = 0;
+    const size_t count = bodies.size();
+
+    // Left edges of the bounding boxes
+    left.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        left[i] = toDouble(bodies.x[i]) - bodies.radius[i];
+    }
+
+    // Keep the order of the previous step when possible (insertion sort is linear on nearly sorted input)
+    if (rebuild || order.size() != count) {
+        order.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            order[i] = static_cast<int>(i);
+        }
+        std::sort(order.begin(), order.end(), [this](int a, int b) { return left[a] < left[b]; });
+    } else {
+        for (size_t i = 1; i < count; i++) {
+            int body = order[i];
+            size_t j = i;
+            while (j > 0 && left[order[j - 1]] > left[body]) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = body;
+        }
+    }
+
+    // Sweep from left to right, testing each planet against those whose X interval is still open
+    active.clear();
+    for (int body : order) {
+        double x = toDouble(bodies.x[body]);
+        double y = toDouble(bodies.y[body]);
+        float radius = bodies.radius[body];
+
+        // Drop planets that end before this one starts
+        size_t kept = 0;
+        for (int other : active) {
+            if (toDouble(bodies.x[other]) + bodies.radius[other] >= left[body]) {
+                active[kept++] = other;
+            }
+        }
+        active.resize(kept);
+
+        // Narrow phase: circle overlap
+        for (int other : active) {
+            double dx = toDouble(bodies.x[other]) - x;
+            double dy = toDouble(bodies.y[other]) - y;
+            double reach = bodies.radius[other] + radius;
+            testCount++;
+            if (dx*dx + dy*dy < reach * reach) {
+                contacts.push_back(std::make_pair(std::min(body, other), std::max(body, other)));
+            }
+        }
+        active.push_back(body);
+    }
+}
+
+size_t SweepAndPrune::getTestCount() const {
+    return testCount;
+}
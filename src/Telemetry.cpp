@@ -0,0 +1,176 @@
+#include "Telemetry.h"
+#include "Hal.h"
+#include "Constants.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace TelemetryFormat;
+
+Telemetry::Telemetry(Profiler* profiler)
+    : profiler(profiler), enabled(false), budget(0.0f), lastRefill(0),
+      sequence(0), sinceKeyframe(0), keyframeDue(true), droppedSinceSent(0),
+      sentCount(0), droppedCount(0) {
+}
+
+void Telemetry::setEnabled(bool enable) {
+    if (enable && !enabled) {
+        sent.clear();
+        keyframeDue = true;
+        budget = static_cast<float>(TelemetryConstants::BURST_BYTES);
+        lastRefill = hal::millis();
+        droppedSinceSent = 0;
+        sentCount = 0;
+        droppedCount = 0;
+    }
+    enabled = enable;
+}
+
+bool Telemetry::isEnabled() const {
+    return enabled;
+}
+
+bool Telemetry::update(const SimulationSnapshot& snapshot, uint32_t now) {
+    if (!enabled) {
+        return false;
+    }
+
+    // Refill the byte budget for the time since the last frame was due
+    budget = std::min(budget + (now - lastRefill) * (TelemetryConstants::BYTES_PER_SECOND / 1000.0f),
+                      static_cast<float>(TelemetryConstants::BURST_BYTES));
+    lastRefill = now;
+
+    bool keyframe = keyframeDue || sinceKeyframe >= TelemetryConstants::KEYFRAME_INTERVAL;
+
+    // Drop rather than wait: the next frame is encoded against what was actually sent
+    if (!encode(snapshot, keyframe) || frame.size() > budget || frame.size() > hal::serialWritable()) {
+        droppedSinceSent++;
+        droppedCount++;
+        return false;
+    }
+    hal::writeSerial(frame.data(), frame.size());
+    budget -= frame.size();
+    sent.swap(next);
+    sequence++;
+    sentCount++;
+    droppedSinceSent = 0;
+    sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+    keyframeDue = false;
+    return true;
+}
+
+uint32_t Telemetry::getSentCount() const {
+    return sentCount;
+}
+
+uint32_t Telemetry::getDroppedCount() const {
+    return droppedCount;
+}
+
+bool Telemetry::encode(const SimulationSnapshot& snapshot, bool keyframe) {
+    const BodyStore& bodies = snapshot.bodies;
+    frame.clear();
+    next.clear();
+
+    // Header (the payload length is filled in at the end)
+    frame.push_back(SYNC_0);
+    frame.push_back(SYNC_1);
+    frame.push_back(static_cast<uint8_t>(keyframe ? FrameType::KEYFRAME : FrameType::DELTA));
+    frame.push_back(0);
+    frame.push_back(0);
+
+    putVarint(sequence);
+    putVarint(snapshot.step);
+    putVarint(droppedSinceSent);
+    putVarint(profiler != nullptr ? profiler->getStats(ProfileStage::PHYSICS).p50 : 0);
+    putVarint(profiler != nullptr ? profiler->getStats(ProfileStage::FRAME).p50 : 0);
+
+    if (keyframe) {
+        putVarint(static_cast<uint32_t>(bodies.size()));
+        for (size_t i = 0; i < bodies.size(); i++) {
+            next.push_back(quantize(bodies, i));
+            putBody(next.back());
+        }
+    } else {
+        known.assign(bodies.size(), 0);
+
+        // Bodies the decoder knows that are gone (merged, fallen into the sun or out of bounds)
+        uint32_t removed = 0;
+        for (const Body& body : sent) {
+            if (bodies.indexOf(body.id) < 0) {
+                removed++;
+            }
+        }
+        putVarint(removed);
+        for (const Body& body : sent) {
+            if (bodies.indexOf(body.id) < 0) {
+                putVarint(body.id);
+            }
+        }
+
+        // Bodies the decoder knows, in its order: movement since the last frame sent
+        putVarint(static_cast<uint32_t>(sent.size() - removed));
+        for (const Body& body : sent) {
+            int index = bodies.indexOf(body.id);
+            if (index < 0) {
+                continue;
+            }
+            known[index] = 1;
+            Body current = quantize(bodies, index);
+            putSigned(current.x - body.x);
+            putSigned(current.y - body.y);
+            putSigned(current.vx - body.vx);
+            putSigned(current.vy - body.vy);
+            next.push_back(current);
+        }
+
+        // Bodies spawned since the last frame sent
+        putVarint(static_cast<uint32_t>(bodies.size() - (sent.size() - removed)));
+        for (size_t i = 0; i < bodies.size(); i++) {
+            if (!known[i]) {
+                next.push_back(quantize(bodies, i));
+                putBody(next.back());
+            }
+        }
+    }
+
+    size_t payload = frame.size() - HEADER_SIZE;
+    if (payload > MAX_PAYLOAD_SIZE) {
+        return false;
+    }
+    frame[3] = static_cast<uint8_t>(payload);
+    frame[4] = static_cast<uint8_t>(payload >> 8);
+    uint16_t crc = crc16(frame.data() + 2, frame.size() - 2);
+    frame.push_back(static_cast<uint8_t>(crc));
+    frame.push_back(static_cast<uint8_t>(crc >> 8));
+    return true;
+}
+
+Telemetry::Body Telemetry::quantize(const BodyStore& bodies, size_t index) {
+    Body body;
+    body.id = bodies.id[index];
+    body.x = static_cast<int32_t>(lround(toDouble(bodies.x[index]) * POSITION_SCALE));
+    body.y = static_cast<int32_t>(lround(toDouble(bodies.y[index]) * POSITION_SCALE));
+    body.vx = static_cast<int32_t>(lround(toDouble(bodies.vx[index]) * VELOCITY_SCALE));
+    body.vy = static_cast<int32_t>(lround(toDouble(bodies.vy[index]) * VELOCITY_SCALE));
+    return body;
+}
+
+void Telemetry::putBody(const Body& body) {
+    putVarint(body.id);
+    putSigned(body.x);
+    putSigned(body.y);
+    putSigned(body.vx);
+    putSigned(body.vy);
+}
+
+void Telemetry::putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        frame.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    frame.push_back(static_cast<uint8_t>(value));
+}
+
+void Telemetry::putSigned(int32_t value) {
+    putVarint(zigzag(value));
+}
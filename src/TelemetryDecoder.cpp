@@ -0,0 +1,210 @@
+#include "TelemetryDecoder.h"
+#include "TelemetryFormat.h"
+#include <algorithm>
+
+using namespace TelemetryFormat;
+
+namespace {
+    /**
+     * Sequential reader of a frame payload
+     */
+    class PayloadReader {
+    public:
+        PayloadReader(const uint8_t* bytes, size_t size) : bytes(bytes), size(size), offset(0), failed(false) {}
+
+        uint32_t varint() {
+            uint32_t value = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                if (offset >= size) {
+                    failed = true;
+                    return 0;
+                }
+                uint8_t byte = bytes[offset++];
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            failed = true;
+            return 0;
+        }
+
+        int32_t signedVarint() {
+            return unzigzag(varint());
+        }
+
+        TelemetryDecoder::Body body() {
+            TelemetryDecoder::Body body;
+            body.id = varint();
+            body.x = signedVarint();
+            body.y = signedVarint();
+            body.vx = signedVarint();
+            body.vy = signedVarint();
+            return body;
+        }
+
+        // A count larger than the bytes left cannot be valid (every entry takes at least one byte)
+        uint32_t count() {
+            uint32_t value = varint();
+            if (value > size - offset) {
+                failed = true;
+                return 0;
+            }
+            return value;
+        }
+
+        bool ok() const { return !failed && offset == size; }
+
+    private:
+        const uint8_t* bytes;
+        size_t size;
+        size_t offset;
+        bool failed;
+    };
+
+    bool contains(const std::vector<uint32_t>& ids, uint32_t id) {
+        return std::find(ids.begin(), ids.end(), id) != ids.end();
+    }
+
+    bool containsBody(const std::vector<TelemetryDecoder::Body>& bodies, uint32_t id) {
+        return std::find_if(bodies.begin(), bodies.end(),
+                            [id](const TelemetryDecoder::Body& body) { return body.id == id; }) != bodies.end();
+    }
+}
+
+TelemetryDecoder::TelemetryDecoder(FrameHandler onFrame, TextHandler onText)
+    : onFrame(onFrame), onText(onText), frame(), synced(false), nextSequence(0), stats() {
+}
+
+void TelemetryDecoder::feed(const uint8_t* data, size_t size) {
+    buffer.insert(buffer.end(), data, data + size);
+    process();
+}
+
+void TelemetryDecoder::process() {
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        if (buffer[offset] != SYNC_0) {
+            passText(buffer[offset++]);
+            continue;
+        }
+        if (buffer.size() - offset < HEADER_SIZE) {
+            break;  // Wait for the rest of the header
+        }
+        if (buffer[offset + 1] != SYNC_1) {
+            passText(buffer[offset++]);
+            continue;
+        }
+        size_t payloadSize = buffer[offset + 3] | (buffer[offset + 4] << 8);
+        size_t frameSize = HEADER_SIZE + payloadSize + CRC_SIZE;
+        if (buffer.size() - offset < frameSize) {
+            break;  // Wait for the rest of the frame
+        }
+        const uint8_t* bytes = buffer.data() + offset;
+        uint16_t crc = bytes[frameSize - 2] | (bytes[frameSize - 1] << 8);
+        if (crc16(bytes + 2, frameSize - 2 - CRC_SIZE) != crc) {
+            // Not a frame after all, or a corrupted one: resync at the next byte
+            stats.crcErrors++;
+            passText(buffer[offset++]);
+            continue;
+        }
+        decodeFrame(bytes[2], bytes + HEADER_SIZE, payloadSize);
+        offset += frameSize;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+}
+
+void TelemetryDecoder::decodeFrame(uint8_t type, const uint8_t* payload, size_t size) {
+    PayloadReader reader(payload, size);
+    frame.sequence = reader.varint();
+    frame.step = reader.varint();
+    frame.dropped = reader.varint();
+    frame.physicsMicros = reader.varint();
+    frame.frameMicros = reader.varint();
+    frame.keyframe = type == static_cast<uint8_t>(FrameType::KEYFRAME);
+    frame.spawned.clear();
+    frame.removed.clear();
+
+    if (!frame.keyframe && type != static_cast<uint8_t>(FrameType::DELTA)) {
+        stats.malformed++;
+        return;
+    }
+    if (synced && frame.sequence != nextSequence) {
+        stats.gaps++;
+        synced = false;
+    }
+    if (!frame.keyframe && !synced) {
+        stats.skipped++;
+        return;
+    }
+
+    decoded.clear();
+    if (frame.keyframe) {
+        uint32_t count = reader.count();
+        for (uint32_t i = 0; i < count; i++) {
+            decoded.push_back(reader.body());
+        }
+
+        // Spawns and removals are only known relative to a synced state
+        if (synced) {
+            for (const Body& body : decoded) {
+                if (!containsBody(bodies, body.id)) {
+                    frame.spawned.push_back(body.id);
+                }
+            }
+            for (const Body& body : bodies) {
+                if (!containsBody(decoded, body.id)) {
+                    frame.removed.push_back(body.id);
+                }
+            }
+        }
+    } else {
+        uint32_t removedCount = reader.count();
+        for (uint32_t i = 0; i < removedCount; i++) {
+            frame.removed.push_back(reader.varint());
+        }
+        uint32_t kept = reader.count();
+        for (const Body& previous : bodies) {
+            if (contains(frame.removed, previous.id)) {
+                continue;
+            }
+            Body body = previous;
+            body.x += reader.signedVarint();
+            body.y += reader.signedVarint();
+            body.vx += reader.signedVarint();
+            body.vy += reader.signedVarint();
+            decoded.push_back(body);
+        }
+        uint32_t added = reader.count();
+        for (uint32_t i = 0; i < added; i++) {
+            decoded.push_back(reader.body());
+            frame.spawned.push_back(decoded.back().id);
+        }
+        if (kept != decoded.size() - added) {
+            stats.malformed++;
+            synced = false;
+            return;
+        }
+    }
+    if (!reader.ok()) {
+        stats.malformed++;
+        synced = false;
+        return;
+    }
+
+    bodies.swap(decoded);
+    synced = true;
+    nextSequence = frame.sequence + 1;
+    stats.frames++;
+    stats.keyframes += frame.keyframe ? 1 : 0;
+    stats.dropped += frame.dropped;
+    if (onFrame) {
+        onFrame(frame);
+    }
+}
+
+void TelemetryDecoder::passText(uint8_t byte) {
+    if (onText) {
+        onText(byte);
+    }
+}
@@ -0,0 +1,128 @@
+#if !defined(ARDUINO)
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned count)
+    : threadCount(count > 0 ? count : std::max(1u, std::thread::hardware_concurrency())),
+      queues(new Queue[threadCount]()),
+      job(nullptr),
+      generation(0),
+      busyWorkers(0),
+      stopping(false) {
+    for (unsigned i = 1; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::getThreadCount() const {
+    return threadCount;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (grain == 0) {
+        grain = 1;
+    }
+    if (workers.empty() || count <= grain) {
+        if (count > 0) {
+            body(0, count);
+        }
+        return;
+    }
+
+    // Deal each thread a contiguous run of chunks (neighbouring indices stay on one core)
+    size_t chunks = (count + grain - 1) / grain;
+    for (unsigned q = 0; q < threadCount; q++) {
+        Queue& queue = queues[q];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.ranges.clear();
+        for (size_t c = chunks * q / threadCount; c < chunks * (q + 1) / threadCount; c++) {
+            queue.ranges.push_back({c * grain, std::min(count, (c + 1) * grain)});
+        }
+        queue.front = 0;
+        queue.back = queue.ranges.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        generation++;
+        busyWorkers = static_cast<unsigned>(workers.size());
+    }
+    wake.notify_all();
+
+    runChunks(0, body);
+
+    // body lives on the caller's stack, so wait until no worker can still touch it
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    uint64_t seen = 0;
+    while (true) {
+        const std::function<void(size_t, size_t)>* body;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            body = job;
+        }
+
+        runChunks(index, *body);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) {
+                done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::runChunks(unsigned index, const std::function<void(size_t, size_t)>& body) {
+    Range range;
+    while (take(index, range)) {
+        body(range.begin, range.end);
+    }
+}
+
+bool ThreadPool::take(unsigned index, Range& range) {
+    // Own chunks first, in order
+    {
+        Queue& own = queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.front < own.back) {
+            range = own.ranges[own.front++];
+            return true;
+        }
+    }
+
+    // Then steal the last chunk of another thread (the one its owner would reach last)
+    for (unsigned k = 1; k < threadCount; k++) {
+        Queue& victim = queues[(index + k) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.front < victim.back) {
+            range = victim.ranges[--victim.back];
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -1,29 +1,33 @@
 #include "TouchHandler.h"
 #include "Constants.h"
 #include "Planet.h"
+#include "StateFile.h"
 
-TouchHandler::TouchHandler(PhysicsEngine& physicsEngine, Renderer& renderer)
-    : physicsEngine(physicsEngine), renderer(renderer),
-      isTouching(false), touchStartX(0), touchStartY(0) {
+TouchHandler::TouchHandler(SimulationPipeline& pipeline, Renderer& renderer)
+    : pipeline(pipeline), renderer(renderer),
+      isTouching(false), touchStartX(0), touchStartY(0), touchStartStep(0), touchX(0), touchY(0) {
 }
 
 bool TouchHandler::update() {
+    return update(hal::readTouch());
+}
+
+bool TouchHandler::update(const hal::TouchPoint& touch) {
     // Process touch operations
-    if (M5.Touch.getCount() > 0) {
-        auto touch = M5.Touch.getDetail();
-        
+    touchX = touch.x;
+    touchY = touch.y;
+    if (touch.touched) {
         // When touch begins
-        if (!isTouching && touch.isPressed()) {
+        if (!isTouching && touch.pressed) {
             isTouching = true;
             touchStartX = touch.x;
             touchStartY = touch.y;
+            touchStartStep = pipeline.getSnapshot().step;
             // Play a tone as feedback
-            M5.Speaker.tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+            hal::tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
         }
     } else if (isTouching) {
-        // When touch ends
-        auto touch = M5.Touch.getDetail();
-        
+        // When touch ends (at the last reported position)
         // Calculate initial velocity from drag distance and direction
         double dx = touch.x - touchStartX;
         double dy = touch.y - touchStartY;
@@ -37,13 +41,17 @@ bool TouchHandler::update() {
         double planetY = touchStartY - renderer.getCenterY();
         
         // Generate color for both planet and ripple
-        uint16_t planetColor = Planet::randomPastelColor();
+        uint16_t planetColor = Planet::randomPastelColor(colorRandom);
         
         // Create ripple effect at planet creation position
         renderer.createRipple(planetX, planetY, planetColor);
         
-        // Add new planet with the same color
-        physicsEngine.addPlanet(planetX, planetY, vx, vy, planetColor);
+        // Add new planet with the same color (on the physics task)
+        PlanetSpawn spawn = {planetX, planetY, vx, vy, planetColor,
+                             static_cast<int16_t>(touchStartX), static_cast<int16_t>(touchStartY),
+                             static_cast<int16_t>(touch.x), static_cast<int16_t>(touch.y),
+                             touchStartStep, 0};
+        pipeline.requestPlanet(spawn);
         
         // Reset touch state
         isTouching = false;
@@ -59,3 +67,28 @@ int TouchHandler::getTouchStartX() const {
 int TouchHandler::getTouchStartY() const {
     return touchStartY;
 }
+
+int TouchHandler::getTouchX() const {
+    return touchX;
+}
+
+int TouchHandler::getTouchY() const {
+    return touchY;
+}
+
+void TouchHandler::setSeed(uint32_t seed) {
+    colorRandom.seed(seed);
+}
+
+void TouchHandler::saveState(StateWriter& writer) const {
+    writer.write(colorRandom.getState());
+}
+
+bool TouchHandler::loadState(StateReader& reader) {
+    uint32_t state = 0;
+    if (!reader.read(state)) {
+        return false;
+    }
+    colorRandom.setState(state);
+    return true;
+}
@@ -0,0 +1,283 @@
+#include "TrailPool.h"
+#include "StateFile.h"
+#include <algorithm>
+
+static_assert(TrailConstants::POOL_POINTS >= BarnesHutConstants::MAX_PLANET_COUNT,
+              "every planet needs at least one trail point");
+static_assert(TrailConstants::MAX_POOL_POINTS >= PlanetConstants::MAX_LIMIT,
+              "every planet needs at least one trail point at the largest planet limit");
+
+namespace {
+    /**
+     * Clamp a coordinate to the int16 range
+     */
+    int16_t toPoint(int value) {
+        if (value > INT16_MAX) return INT16_MAX;
+        if (value < INT16_MIN) return INT16_MIN;
+        return static_cast<int16_t>(value);
+    }
+}
+
+TrailPool::TrailPool(size_t budget) : budget(budget), maxLength(PlanetConstants::TRAIL_LENGTH), fragmented(false) {
+}
+
+void TrailPool::reserve(size_t capacity) {
+    pointX.reserve(budget);
+    pointY.reserve(budget);
+    start.reserve(capacity);
+    length.reserve(capacity);
+    head.reserve(capacity);
+    layout.reserve(capacity);
+}
+
+void TrailPool::add(int x, int y) {
+    if (fragmented) {
+        compact();
+    }
+    size_t index = start.size();
+    start.push_back(static_cast<uint32_t>(pointX.size()));
+    if ((index + 1) * maxLength <= budget) {
+        // Every trail stays at full length: append the new one behind the others
+        length.push_back(static_cast<uint16_t>(maxLength));
+        head.push_back(static_cast<uint16_t>(maxLength - 1));
+        pointX.resize(pointX.size() + maxLength);
+        pointY.resize(pointY.size() + maxLength);
+        if (layout.size() == index) {
+            layout.push_back(static_cast<uint16_t>(index));
+        }
+    } else {
+        // Append an empty trail, then let it take its share from the others
+        length.push_back(0);
+        head.push_back(0);
+        redistribute(false);
+    }
+
+    // Initialize trail positions
+    std::fill(pointX.begin() + start[index], pointX.begin() + start[index] + length[index], toPoint(x));
+    std::fill(pointY.begin() + start[index], pointY.begin() + start[index] + length[index], toPoint(y));
+}
+
+void TrailPool::remove(size_t index) {
+    // Move the last trail's handle into the hole; the removed points are reclaimed by compact()
+    size_t last = start.size() - 1;
+    start[index] = start[last];
+    length[index] = length[last];
+    head[index] = head[last];
+    start.pop_back();
+    length.pop_back();
+    head.pop_back();
+    fragmented = true;
+}
+
+void TrailPool::compact() {
+    if (!fragmented) {
+        return;
+    }
+
+    // Slide the remaining trails towards the front in pool order (no trail overtakes another)
+    sortLayout();
+    uint32_t nextStart = 0;
+    for (uint16_t i : layout) {
+        if (start[i] != nextStart) {
+            std::copy(pointX.begin() + start[i], pointX.begin() + start[i] + length[i], pointX.begin() + nextStart);
+            std::copy(pointY.begin() + start[i], pointY.begin() + start[i] + length[i], pointY.begin() + nextStart);
+            start[i] = nextStart;
+        }
+        nextStart += length[i];
+    }
+    pointX.resize(nextStart);
+    pointY.resize(nextStart);
+    fragmented = false;
+
+    // Hand the freed points to the remaining trails
+    redistribute(true);
+}
+
+void TrailPool::clear() {
+    pointX.clear();
+    pointY.clear();
+    start.clear();
+    length.clear();
+    head.clear();
+    layout.clear();
+    fragmented = false;
+}
+
+void TrailPool::setBudget(size_t newBudget, int newMaxLength) {
+    if (newBudget == budget && newMaxLength == maxLength) {
+        return;
+    }
+    if (fragmented) {
+        compact();
+    }
+    size_t count = start.size();
+    bool growing = std::min(newBudget, count * newMaxLength) > std::min(budget, count * maxLength);
+    budget = newBudget;
+    maxLength = newMaxLength;
+    pointX.reserve(budget);
+    pointY.reserve(budget);
+    redistribute(growing);
+}
+
+void TrailPool::record(size_t index, int x, int y) {
+    if (length[index] == 0) {
+        return;
+    }
+
+    // Update trail positions using ring buffer (optimized - O(1) instead of O(n))
+    head[index] = head[index] + 1 == length[index] ? 0 : head[index] + 1;
+    size_t base = start[index] + head[index];
+    pointX[base] = toPoint(x);
+    pointY[base] = toPoint(y);
+}
+
+void TrailPool::sortLayout() {
+    // A trail appended behind the others extends the layout of the last redistribution
+    size_t last = start.size() - 1;
+    if (layout.size() == last && (last == 0 || start[last] >= start[layout.back()])) {
+        layout.push_back(static_cast<uint16_t>(last));
+        return;
+    }
+
+    layout.resize(start.size());
+    for (size_t i = 0; i < layout.size(); i++) {
+        layout[i] = static_cast<uint16_t>(i);
+    }
+    std::sort(layout.begin(), layout.end(), [this](uint16_t a, uint16_t b) { return start[a] < start[b]; });
+}
+
+int TrailPool::shareOf(size_t count, size_t rank) const {
+    // Equal shares (the remainder goes to the trails at the front of the pool), capped at the maximum length
+    size_t share = budget / count + (rank < budget % count ? 1 : 0);
+    return static_cast<int>(std::min<size_t>(share, maxLength));
+}
+
+void TrailPool::redistribute(bool growing) {
+    size_t count = length.size();
+    if (count == 0) {
+        pointX.clear();
+        pointY.clear();
+        return;
+    }
+
+    sortLayout();
+    size_t oldTotal = pointX.size();
+    size_t newTotal = 0;
+    for (size_t i = 0; i < count; i++) {
+        newTotal += shareOf(count, i);
+    }
+    if (newTotal > oldTotal) {
+        pointX.resize(newTotal);
+        pointY.resize(newTotal);
+    }
+
+    // The new layout keeps the pool order. Shrinking trails move towards the front, so they
+    // are processed front to back; growing ones back to front. Either way no trail overwrites
+    // one that has not moved yet.
+    uint32_t newStart = growing ? static_cast<uint32_t>(newTotal) : 0;
+    for (size_t n = 0; n < count; n++) {
+        size_t rank = growing ? count - 1 - n : n;
+        size_t i = layout[rank];
+        int oldLength = length[i];
+        int newLength = shareOf(count, rank);
+        if (growing) {
+            newStart -= newLength;
+        }
+        if (newLength == oldLength && newStart == start[i]) {
+            // Nothing to move (every trail keeps its full length while the budget allows)
+            if (!growing) {
+                newStart += newLength;
+            }
+            continue;
+        }
+        auto xs = pointX.begin() + start[i];
+        auto ys = pointY.begin() + start[i];
+
+        // Put the ring in order (oldest first, newest last)
+        if (oldLength > 0) {
+            std::rotate(xs, xs + head[i] + 1, xs + oldLength);
+            std::rotate(ys, ys + head[i] + 1, ys + oldLength);
+        }
+
+        // Keep the newest points, then repeat the oldest kept one in front of them
+        int kept = std::min(oldLength, newLength);
+        auto newXs = pointX.begin() + newStart;
+        auto newYs = pointY.begin() + newStart;
+        if (kept > 0) {
+            auto sourceX = xs + (oldLength - kept);
+            auto sourceY = ys + (oldLength - kept);
+            auto targetX = newXs + (newLength - kept);
+            auto targetY = newYs + (newLength - kept);
+            if (growing) {
+                std::copy_backward(sourceX, sourceX + kept, targetX + kept);
+                std::copy_backward(sourceY, sourceY + kept, targetY + kept);
+            } else {
+                std::copy(sourceX, sourceX + kept, targetX);
+                std::copy(sourceY, sourceY + kept, targetY);
+            }
+            std::fill(newXs, targetX, *targetX);
+            std::fill(newYs, targetY, *targetY);
+        }
+
+        start[i] = newStart;
+        length[i] = newLength;
+        head[i] = newLength > 0 ? newLength - 1 : 0;
+        if (!growing) {
+            newStart += newLength;
+        }
+    }
+
+    if (newTotal < oldTotal) {
+        pointX.resize(newTotal);
+        pointY.resize(newTotal);
+    }
+}
+
+void TrailPool::saveState(StateWriter& writer) const {
+    writer.write(static_cast<uint32_t>(budget));
+    writer.writeArray(pointX);
+    writer.writeArray(pointY);
+    writer.writeArray(start);
+    writer.writeArray(length);
+    writer.writeArray(head);
+    writer.writeArray(layout);
+    writer.write(static_cast<uint8_t>(fragmented));
+}
+
+bool TrailPool::loadState(StateReader& reader, size_t maxCount) {
+    uint32_t savedBudget = 0;
+    uint8_t savedFragmented = 0;
+    reader.read(savedBudget);
+    reader.readArray(pointX, budget);
+    reader.readArray(pointY, budget);
+    reader.readArray(start, maxCount);
+    reader.readArray(length, maxCount);
+    reader.readArray(head, maxCount);
+    reader.readArray(layout, maxCount);
+    reader.read(savedFragmented);
+    fragmented = savedFragmented != 0;
+
+    // Every trail must lie inside the pool, no longer than the maximum, with its ring position inside the trail
+    size_t count = start.size();
+    bool valid = reader.ok() && savedBudget == budget && pointY.size() == pointX.size() &&
+        length.size() == count && head.size() == count;
+    for (size_t i = 0; valid && i < count; i++) {
+        valid = start[i] + length[i] <= pointX.size() && length[i] <= maxLength &&
+            (head[i] < length[i] || (head[i] == 0 && length[i] == 0));
+    }
+
+    // Rebuild the layout rather than trust the saved one (it is stale after removals), then
+    // check that no two trails share a point
+    layout.clear();
+    if (valid && count > 0) {
+        sortLayout();
+    }
+    for (size_t rank = 1; valid && rank < count; rank++) {
+        valid = start[layout[rank - 1]] + length[layout[rank - 1]] <= start[layout[rank]];
+    }
+    if (!valid) {
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -1,57 +1,384 @@
-#include <M5Unified.h>
+#include "Hal.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "Constants.h"
 #include "PhysicsEngine.h"
+#include "SimulationPipeline.h"
 #include "Renderer.h"
 #include "TouchHandler.h"
 #include "Sun.h"
+#include "Profiler.h"
+#include "InputLog.h"
+#include "StateFile.h"
+#include "Telemetry.h"
+#include "ThreadPool.h"
+#include "Scheduler.h"
+#include "Random.h"
 
 // Global variables
-Renderer renderer(M5.Display);
-PhysicsEngine physicsEngine(renderer);
-TouchHandler touchHandler(physicsEngine, renderer);
+Profiler profiler;
+Renderer renderer(hal::getDisplay(), &profiler);
+PhysicsEngine physicsEngine;
+SimulationPipeline pipeline(physicsEngine, &profiler);
+TouchHandler touchHandler(pipeline, renderer);
+InputRecorder recorder;
+InputReplay replay;
+StateFile state(physicsEngine, renderer, touchHandler);
+Telemetry telemetry(&profiler);
+Scheduler scheduler;
 
-void setup() {
-  // Initialize M5 device
-  auto cfg = M5.config();
-  M5.begin(cfg);
+// Input log files (every session is recorded; holding button C at boot replays the last one)
+const char* recordFile = InputLogConstants::FILE_NAME;
+const char* replayFile = nullptr;
 
-  // Set volume
-  M5.Speaker.setVolume(ToneConstants::SPEAKER_VOLUME);
+// Saved session (restored at boot unless button B is held, saved periodically and on button C)
+const char* stateFile = StateConstants::FILE_NAME;
+int saveJob = -1;  // Scheduler job of the periodic save (-1 while not saving)
 
-  // Play boot sound
-  M5.Speaker.tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
-  delay(100);
-  M5.Speaker.tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
-  delay(100);
-  M5.Speaker.tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+// Touch state of the last input poll
+bool isTouching = false;
 
-  // Initialize random seed
-  randomSeed(millis());
-  
-  // Initialize renderer
-  renderer.init();
+/**
+ * Save the session, holding the physics task while its state is written
+ */
+void saveState() {
+  ProfileScope scope(&profiler, ProfileStage::SAVE);
+  pipeline.pause();
+  bool saved = state.save(stateFile);
+  pipeline.resume();
+  if (!saved) {
+    hal::print("state: save failed\n");
+  }
+  if (saveJob >= 0) {
+    scheduler.restart(saveJob);
+  }
 }
 
-void loop() {
-  M5.update();  // Update button states
+/**
+ * Poll the buttons, serial port and touch panel (replay: feed the recorded touches and step physics)
+ */
+void pollInput() {
+  {
+    ProfileScope scope(&profiler, ProfileStage::INPUT);
+    hal::update();  // Update button states
+  }
   
-  // Process touch operations
-  bool isTouching = touchHandler.update();
+  // Button A toggles the profiler overlay; button B or 'p' on the serial port dumps it
+  int command = hal::readSerial();
+  if (hal::wasButtonPressed(hal::Button::A)) {
+    profiler.toggleOverlay();
+  }
+  if (hal::wasButtonPressed(hal::Button::B) || command == 'p') {
+    profiler.dump();
+    scheduler.dump();
+  }
   
-  // Update physics simulation
-  physicsEngine.update();
+  // 't' on the serial port starts or stops the telemetry stream
+  if (command == 't') {
+    telemetry.setEnabled(!telemetry.isEnabled());
+  }
+
+  // Button C saves the session now (it is also saved every SAVE_INTERVAL)
+  if (saveJob >= 0 && hal::wasButtonPressed(hal::Button::C)) {
+    saveState();
+  }
   
-  // Remove planets that are out of bounds
-  physicsEngine.removeOutOfBoundsPlanets(
-    renderer.getMaxBoundsX(), 
-    renderer.getMaxBoundsY()
-  );
+  // Process touch operations (recorded touches due at this step when replaying)
+  {
+    ProfileScope scope(&profiler, ProfileStage::TOUCH);
+    isTouching = replay.isOpen() ? replay.feed(physicsEngine, touchHandler) : touchHandler.update();
+  }
   
-  // Render
+  // Replay runs one physics step per poll
+  if (replay.isOpen()) {
+    pipeline.runStep();
+  }
+}
+
+/**
+ * Take the latest physics snapshot and start the effects it triggered
+ */
+void takeSnapshot() {
+  ProfileScope scope(&profiler, ProfileStage::SNAPSHOT);
+  if (pipeline.acquireSnapshot()) {
+    renderer.handleEvents(pipeline.getSnapshot().events);
+  }
+  recorder.update(pipeline);
+}
+
+/**
+ * Draw a frame of the latest snapshot and start pushing it to the display
+ */
+void drawFrame() {
+  takeSnapshot();
   renderer.render(
-    physicsEngine, 
+    pipeline.getSnapshot(), 
     isTouching, 
     touchHandler.getTouchStartX(), 
-    touchHandler.getTouchStartY()
+    touchHandler.getTouchStartY(),
+    touchHandler.getTouchX(),
+    touchHandler.getTouchY()
   );
+  profiler.endFrame(true);
+}
+
+/**
+ * Stream the latest snapshot over serial (dropped rather than waited for when the link is busy)
+ */
+void sendTelemetry() {
+  if (!telemetry.isEnabled()) {
+    return;
+  }
+  takeSnapshot();
+  ProfileScope scope(&profiler, ProfileStage::TELEMETRY);
+  telemetry.update(pipeline.getSnapshot(), hal::millis());
+}
+
+void setup() {
+  // Initialize M5 device
+  hal::begin();
+
+  // Set volume
+  hal::setVolume(ToneConstants::SPEAKER_VOLUME);
+
+  // Button C held at boot replays the last session, button B starts an empty one
+  hal::beginStorage();
+  hal::update();
+  if (hal::isButtonPressed(hal::Button::C)) {
+    replayFile = InputLogConstants::FILE_NAME;
+  }
+  bool freshStart = hal::isButtonPressed(hal::Button::B);
+
+  // Load the session to replay, which brings its own seed and engine settings (or start state)
+  uint32_t seed = hal::millis();
+  bool restored = false;
+  if (replayFile != nullptr && replay.open(replayFile, &state) && replay.configure(physicsEngine)) {
+    seed = replay.getHeader().seed;
+    restored = replay.getHeader().startsFromState;
+  } else if (!freshStart && stateFile != nullptr) {
+    // Otherwise resume where the last session was saved
+    uint32_t start = hal::micros();
+    restored = state.load(stateFile);
+    if (restored) {
+      char line[64];
+      snprintf(line, sizeof(line), "state: resumed %u planets in %lu us\n",
+               static_cast<unsigned>(physicsEngine.getBodies().size()),
+               static_cast<unsigned long>(hal::micros() - start));
+      hal::print(line);
+    }
+  }
+
+  // Play boot sound (skipped when resuming, so the session continues right away)
+  if (!restored) {
+    hal::tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+    hal::delay(100);
+    hal::tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+    hal::delay(100);
+    hal::tone(ToneConstants::TOUCH_TONE_FREQUENCY, ToneConstants::TONE_DURATION);
+  }
+
+  // Initialize random seeds (effects, and planet colors unless restored with the session)
+  hal::randomSeed(seed);
+  if (!restored) {
+    touchHandler.setSeed(seed);
+  }
+  
+  // Initialize renderer
+  renderer.init();
+
+  if (replay.isOpen()) {
+    // Replay steps physics in lockstep with the recorded touches on this task
+    pipeline.startLockstep(renderer.getMaxBoundsX(), renderer.getMaxBoundsY());
+  } else {
+    // Record the session, then start physics on its own task
+    if (recordFile != nullptr) {
+      recorder.open(recordFile, seed, physicsEngine, pipeline, restored ? &state : nullptr);
+    }
+    pipeline.start(renderer.getMaxBoundsX(), renderer.getMaxBoundsY());
+  }
+
+  // Periodic jobs of the render loop (input first, so a frame shows the latest touch);
+  // a replay polls on every pass, since each poll steps the physics
+  int inputJob = scheduler.add("input", SchedulerConstants::INPUT_INTERVAL * 1000,
+                               SchedulerConstants::INPUT_PRIORITY, pollInput);
+  if (replay.isOpen()) {
+    scheduler.setPeriod(inputJob, 0);
+  }
+  scheduler.add("frame", RenderConstants::DRAW_INTERVAL * 1000, SchedulerConstants::FRAME_PRIORITY, drawFrame);
+  scheduler.add("sun", SunConstants::COLOR_UPDATE_INTERVAL * 1000, SchedulerConstants::EFFECT_PRIORITY,
+                []() { renderer.updateSunColor(); });
+  scheduler.add("telemetry", TelemetryConstants::INTERVAL * 1000, SchedulerConstants::EFFECT_PRIORITY,
+                sendTelemetry);
+
+  // The session is saved every SAVE_INTERVAL from now (not while replaying)
+  if (!replay.isOpen() && stateFile != nullptr) {
+    saveJob = scheduler.add("save", StateConstants::SAVE_INTERVAL * 1000, SchedulerConstants::SAVE_PRIORITY,
+                            saveState);
+    scheduler.restart(saveJob);
+  }
+}
+
+void loop() {
+  // Run the jobs that are due, then sleep until the next deadline
+  scheduler.runOnce();
+}
+
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+/**
+ * Scripted touch source for headless runs: every FLING_INTERVAL a touch starts on a
+ * circle around the center and drags tangentially for FLING_HOLD, then releases
+ * @param now Milliseconds since start
+ */
+static void scriptTouch(uint32_t now) {
+  uint32_t fling = now / NativeConstants::FLING_INTERVAL;
+  uint32_t phase = now % NativeConstants::FLING_INTERVAL;
+
+  // Golden-angle spacing spreads the start points around the sun
+  double angle = fling * 2.399963;
+  double startX = renderer.getCenterX() + NativeConstants::FLING_RADIUS * cos(angle);
+  double startY = renderer.getCenterY() + NativeConstants::FLING_RADIUS * sin(angle);
+  double progress = phase < NativeConstants::FLING_HOLD ? (double)phase / NativeConstants::FLING_HOLD : 1.0;
+  double drag = NativeConstants::FLING_LENGTH * progress;
+
+  hal::TouchPoint touch;
+  touch.touched = phase < NativeConstants::FLING_HOLD;
+  touch.pressed = touch.touched;
+  touch.x = static_cast<int>(startX - drag * sin(angle));
+  touch.y = static_cast<int>(startY + drag * cos(angle));
+  hal::setTouch(touch);
+}
+
+/**
+ * Put planets on random circular orbits around the sun (headless load tests)
+ * @param count Number of planets
+ * @param seed Seed of the orbits and colors
+ */
+static void addOrbits(int count, uint32_t seed) {
+  Random random(seed);
+  for (int i = 0; i < count; i++) {
+    // Uniform over the annulus between MIN_ORBIT and MAX_ORBIT
+    double minSquared = NativeConstants::MIN_ORBIT * NativeConstants::MIN_ORBIT;
+    double maxSquared = NativeConstants::MAX_ORBIT * NativeConstants::MAX_ORBIT;
+    double radius = sqrt(minSquared + random.next(1 << 16) / 65536.0 * (maxSquared - minSquared));
+    double angle = random.next(1 << 16) / 65536.0 * 2.0 * M_PI;
+    double speed = sqrt(StepUnits::SUN_GM / radius) / StepUnits::VELOCITY;
+    physicsEngine.addPlanet(radius * cos(angle), radius * sin(angle), -speed * sin(angle), speed * cos(angle),
+                            Planet::randomPastelColor(random), PlanetConstants::MASS * NativeConstants::ORBIT_MASS_SCALE);
+  }
+}
+
+/**
+ * Headless entry point: runs setup() and loop() at full host speed
+ * Usage: gravsim [duration in milliseconds] [--record FILE | --replay FILE] [--state FILE] [--telemetry]
+ *                [--threads N] [--transfer NS] [--solver NAME] [--bodies N]
+ * Without --replay the touches are scripted; a replay ends with the log.
+ * With --state the session is resumed from FILE if it exists and saved to it at the end.
+ * With --telemetry the telemetry stream is written to stdout along with the text output.
+ * --threads sets the threads of the force passes (default: one per hardware thread).
+ * --transfer sets the simulated display transfer time in nanoseconds per pixel (0 is instant).
+ * --solver selects the force solver (pairwise, barnes-hut or cell-list).
+ * --bodies lifts the planet limit of the solver to N (up to PlanetConstants::MAX_LIMIT) and starts
+ * with N planets on random orbits; it cannot be combined with --record or --replay.
+ */
+int main(int argc, char** argv) {
+  uint32_t duration = NativeConstants::RUN_DURATION;
+  recordFile = nullptr;
+  stateFile = nullptr;
+  bool streaming = false;
+  unsigned threads = 0;
+  uint32_t transferNanos = NativeConstants::TRANSFER_NANOS;
+  ForceSolver solver = ForceSolver::PAIRWISE;
+  unsigned bodies = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordFile = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayFile = argv[++i];
+    } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+      stateFile = argv[++i];
+    } else if (strcmp(argv[i], "--telemetry") == 0) {
+      streaming = true;
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--transfer") == 0 && i + 1 < argc) {
+      transferNanos = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--solver") == 0 && i + 1 < argc) {
+      const char* name = argv[++i];
+      if (strcmp(name, "pairwise") == 0) {
+        solver = ForceSolver::PAIRWISE;
+      } else if (strcmp(name, "barnes-hut") == 0) {
+        solver = ForceSolver::BARNES_HUT;
+      } else if (strcmp(name, "cell-list") == 0) {
+        solver = ForceSolver::CELL_LIST;
+      } else {
+        fprintf(stderr, "unknown solver %s\n", name);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--bodies") == 0 && i + 1 < argc) {
+      bodies = strtoul(argv[++i], nullptr, 10);
+    } else {
+      duration = strtoul(argv[i], nullptr, 10);
+    }
+  }
+
+  // Results do not depend on the thread count, so logs replay with any --threads
+  // (a log recorded without a pool, e.g. on the device, replays without it)
+  ThreadPool threadPool(threads);
+  physicsEngine.setThreadPool(&threadPool);
+  hal::getDisplay().setTransferNanos(transferNanos);
+
+  // The solver and the planets are set up before setup() (a loaded state or replay brings its own)
+  if (bodies > 0 && (recordFile != nullptr || replayFile != nullptr)) {
+    fprintf(stderr, "--bodies cannot be recorded or replayed\n");
+    return 2;
+  }
+  physicsEngine.setForceSolver(solver);
+  if (bodies > 0) {
+    physicsEngine.setPlanetLimit(bodies);
+    addOrbits(physicsEngine.getMaxPlanetCount(), bodies);
+  }
+
+  setup();
+  if (replayFile != nullptr && !replay.isOpen()) {
+    fprintf(stderr, "cannot replay %s\n", replayFile);
+    return 2;
+  }
+  hal::pressButton(hal::Button::A);  // Show the overlay so its cost is part of the profile
+  telemetry.setEnabled(streaming);
+  uint32_t frames = 0;
+  while (hal::millis() < duration && !(replay.isOpen() && replay.isFinished())) {
+    if (!replay.isOpen()) {
+      scriptTouch(hal::millis());
+    }
+    loop();
+    frames++;
+  }
+  renderer.flush();
+  pipeline.stop();
+  pipeline.acquireSnapshot();
+  recorder.close(pipeline);
+  if (stateFile != nullptr && !replay.isOpen() && !state.save(stateFile)) {
+    fprintf(stderr, "cannot save %s\n", stateFile);
+  }
+
+  const SimulationSnapshot& snapshot = pipeline.getSnapshot();
+  printf("loops %u steps %u planets %u tones %u pushed %llu pixels\n",
+         static_cast<unsigned>(frames), static_cast<unsigned>(snapshot.step),
+         static_cast<unsigned>(snapshot.bodies.size()), static_cast<unsigned>(hal::getToneCount()),
+         static_cast<unsigned long long>(hal::getDisplay().getPushedPixels()));
+  if (telemetry.isEnabled()) {
+    printf("telemetry %u frames sent %u dropped\n", static_cast<unsigned>(telemetry.getSentCount()),
+           static_cast<unsigned>(telemetry.getDroppedCount()));
+  }
+  printf("threads %u\n", threadPool.getThreadCount());
+  const DisplayTransport& transport = renderer.getTransport();
+  printf("transfers %u: %llu us sending, %llu us waited, %u torn\n", static_cast<unsigned>(transport.getTransferCount()),
+         static_cast<unsigned long long>(transport.getTransferMicros()),
+         static_cast<unsigned long long>(transport.getWaitMicros()), static_cast<unsigned>(transport.getTornCount()));
+  profiler.dump();
+  scheduler.dump();
+  return replay.getMismatchCount() > 0 ? 1 : 0;
 }
+#endif
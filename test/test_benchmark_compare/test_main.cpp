@@ -0,0 +1,102 @@
+/**
+ * Regression gate on the pixel kernels (tools/Benchmark.cpp)
+ *
+ * Runs the raster benchmarks with --check-ratios, which fails when a kernel
+ * is not faster than the canvas call it replaces by its margin. Both are
+ * timed in the same run, so the gate holds on any host without a stored
+ * baseline. The ratio check and compare mode themselves are checked with
+ * limits and baselines that must and must not flag a regression.
+ *
+ *   pio test -e benchmark
+ */
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Entry point of tools/Benchmark.cpp (its main is left out of test builds)
+int runBenchmark(int argc, char** argv);
+
+namespace {
+    const char* const FILTER = "raster/";                   // Benchmarks the gate runs
+    const char* const FAST_FILTER = "raster/pixel-kernel";  // Single quick benchmark for the compare checks
+    const char* const PAIR_FILTER = "raster/pixel-";        // Quick kernel/canvas pair for the ratio checks
+
+    /**
+     * Run the benchmark program with arguments
+     * @param args Arguments (without the program name)
+     * @return Exit code
+     */
+    int run(std::vector<const char*> args) {
+        args.insert(args.begin(), "benchmark");
+        return runBenchmark(static_cast<int>(args.size()), const_cast<char**>(args.data()));
+    }
+
+    /**
+     * Write a baseline with one result for the fast benchmark
+     * @param nsPerOp Baseline time (nanoseconds per operation)
+     * @return Path of the file
+     */
+    const char* writeBaseline(double nsPerOp) {
+        static char path[32];
+        std::snprintf(path, sizeof(path), "/tmp/baselineXXXXXX.json");
+        int fd = mkstemps(path, 5);
+        TEST_ASSERT_TRUE(fd >= 0);
+        FILE* file = fdopen(fd, "w");
+        TEST_ASSERT_NOT_NULL(file);
+        std::fprintf(file, "{\n  \"scalar\": \"any\",\n  \"benchmarks\": [\n"
+                     "    {\"name\": \"%s\", \"n\": 0, \"ns_per_op\": %.1f, \"bodies_per_s\": 0, \"pixels_per_s\": 0}\n"
+                     "  ]\n}\n", FAST_FILTER, nsPerOp);
+        std::fclose(file);
+        return path;
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_compare_flags_slowdown() {
+    // Nothing runs in a tenth of a nanosecond
+    const char* path = writeBaseline(0.1);
+    TEST_ASSERT_EQUAL(1, run({"--filter", FAST_FILTER, "--compare", path}));
+    std::remove(path);
+}
+
+void test_compare_accepts_speedup() {
+    const char* path = writeBaseline(1e12);
+    TEST_ASSERT_EQUAL(0, run({"--filter", FAST_FILTER, "--compare", path}));
+    std::remove(path);
+}
+
+void test_compare_rejects_missing_baseline() {
+    TEST_ASSERT_EQUAL(2, run({"--filter", FAST_FILTER, "--compare", "test/test_benchmark_compare/missing.json"}));
+}
+
+void test_ratio_check_flags_slow_kernel() {
+    // No kernel is a hundred times faster than the canvas
+    TEST_ASSERT_EQUAL(1, run({"--filter", PAIR_FILTER, "--ratio-limit", "0.01"}));
+}
+
+void test_ratio_check_accepts_fast_kernel() {
+    TEST_ASSERT_EQUAL(0, run({"--filter", PAIR_FILTER, "--ratio-limit", "100"}));
+}
+
+void test_kernels_beat_canvas() {
+    TEST_ASSERT_EQUAL(0, run({"--filter", FILTER, "--check-ratios"}));
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_compare_flags_slowdown);
+    RUN_TEST(test_compare_accepts_speedup);
+    RUN_TEST(test_compare_rejects_missing_baseline);
+    RUN_TEST(test_ratio_check_flags_slow_kernel);
+    RUN_TEST(test_ratio_check_accepts_fast_kernel);
+    RUN_TEST(test_kernels_beat_canvas);
+    return UNITY_END();
+}
@@ -0,0 +1,283 @@
+/**
+ * Tests of the planet store (include/BodyStore.h)
+ *
+ * Random sequences of adds, swap-and-pop removals and clears run against a
+ * model that keeps the planets in the order swap and pop leaves them. After
+ * each operation every array must match the model, every live ID must map to
+ * its index and every removed ID must be stale. Saved states must load back
+ * unchanged; states with flipped bits or cut short must either be rejected or
+ * load as a store whose slot map still agrees with its arrays.
+ *
+ *   pio test -e native -f test_body_store
+ */
+#include <unity.h>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "BodyStore.h"
+#include "StateFile.h"
+
+namespace {
+    constexpr size_t CAPACITY = 64;     // Slots of the store (small, so it often runs full)
+    constexpr int OPERATIONS = 5000;    // Random operations per sequence
+    constexpr int SEQUENCES = 8;        // Sequences (seeds) per test
+    constexpr int CORRUPTIONS = 2000;   // Damaged copies of a saved state
+
+    /**
+     * A planet as the model keeps it (every value derived from one number)
+     */
+    struct ModelBody {
+        BodyId id;        // ID returned by add
+        int value;        // Value the planet's fields were derived from
+        uint32_t serial;  // Order of addition
+    };
+
+    /**
+     * Add a planet whose fields are all derived from one value
+     * @param store Store
+     * @param value Value (0 to 255)
+     * @return ID returned by add
+     */
+    BodyId addBody(BodyStore& store, int value) {
+        return store.add(Real(value), Real(-value), Real(value / 2), Real(-value / 2), Real(value + 1),
+                         static_cast<float>(value) + 0.5f, static_cast<uint16_t>(value * 257));
+    }
+
+    /**
+     * Check that the store holds the model's planets in the model's order
+     * @param store Store
+     * @param model Model planets
+     * @param dead IDs of removed planets
+     */
+    void check(const BodyStore& store, const std::vector<ModelBody>& model, const std::vector<BodyId>& dead) {
+        TEST_ASSERT_EQUAL(model.size(), store.size());
+        TEST_ASSERT_EQUAL(CAPACITY, store.capacity());
+        for (size_t i = 0; i < model.size(); i++) {
+            int value = model[i].value;
+            TEST_ASSERT_EQUAL_INT(value, toInt(store.x[i]));
+            TEST_ASSERT_EQUAL_INT(-value, toInt(store.y[i]));
+            TEST_ASSERT_EQUAL_INT(value / 2, toInt(store.vx[i]));
+            TEST_ASSERT_EQUAL_INT(-value / 2, toInt(store.vy[i]));
+            TEST_ASSERT_EQUAL_INT(value, toInt(store.prevX[i]));
+            TEST_ASSERT_EQUAL_INT(-value, toInt(store.prevY[i]));
+            TEST_ASSERT_EQUAL_INT(value + 1, toInt(store.gm[i]));
+            TEST_ASSERT_TRUE(store.radius[i] == static_cast<float>(value) + 0.5f);
+            TEST_ASSERT_EQUAL(value * 257, store.color[i]);
+            TEST_ASSERT_EQUAL_UINT32(model[i].id, store.id[i]);
+            TEST_ASSERT_EQUAL_UINT32(model[i].serial, store.serial[i]);
+            TEST_ASSERT_EQUAL_INT(static_cast<int>(i), store.indexOf(model[i].id));
+        }
+        for (BodyId id : dead) {
+            TEST_ASSERT_EQUAL_INT(-1, store.indexOf(id));
+        }
+        TEST_ASSERT_EQUAL_INT(-1, store.indexOf(BodyStore::INVALID_ID));
+
+        // The oldest planet has the smallest serial
+        if (!model.empty()) {
+            size_t oldest = 0;
+            for (size_t i = 1; i < model.size(); i++) {
+                if (model[i].serial < model[oldest].serial) {
+                    oldest = i;
+                }
+            }
+            TEST_ASSERT_EQUAL(oldest, store.oldest());
+        }
+    }
+
+    /**
+     * Run random operations on a store and its model, checking after each one
+     * @param seed Seed of the sequence
+     * @param store Store (output)
+     * @param model Model planets (output)
+     */
+    void runSequence(uint32_t seed, BodyStore& store, std::vector<ModelBody>& model) {
+        std::mt19937 random(seed);
+        std::vector<BodyId> dead;
+        uint32_t nextSerial = 0;
+        store.reserve(CAPACITY);
+        for (int n = 0; n < OPERATIONS; n++) {
+            int kind = static_cast<int>(random() % 100);
+            if (kind < 55) {
+                // Adding to a full store changes nothing
+                int value = static_cast<int>(random() % 256);
+                BodyId id = addBody(store, value);
+                if (model.size() == CAPACITY) {
+                    TEST_ASSERT_EQUAL_UINT32(BodyStore::INVALID_ID, id);
+                } else {
+                    TEST_ASSERT_TRUE(id != BodyStore::INVALID_ID);
+                    model.push_back({id, value, nextSerial++});
+                }
+            } else if (kind < 99 && !model.empty()) {
+                // Swap and pop: the last planet takes the place of the removed one
+                size_t index = random() % model.size();
+                dead.push_back(model[index].id);
+                store.remove(index);
+                model[index] = model.back();
+                model.pop_back();
+            } else if (kind == 99) {
+                for (const ModelBody& body : model) {
+                    dead.push_back(body.id);
+                }
+                store.clear();
+                model.clear();
+            }
+            if (dead.size() > 4 * CAPACITY) {
+                dead.erase(dead.begin(), dead.begin() + CAPACITY);
+            }
+            check(store, model, dead);
+        }
+    }
+
+    /**
+     * Save a store into a buffer
+     * @param store Store
+     * @return Bytes of the saved state
+     */
+    std::vector<uint8_t> save(const BodyStore& store) {
+        FILE* file = tmpfile();
+        TEST_ASSERT_NOT_NULL(file);
+        StateWriter writer(file);
+        store.saveState(writer);
+        TEST_ASSERT_TRUE(writer.ok());
+        std::vector<uint8_t> bytes(ftell(file));
+        rewind(file);
+        TEST_ASSERT_EQUAL(bytes.size(), fread(bytes.data(), 1, bytes.size(), file));
+        fclose(file);
+        return bytes;
+    }
+
+    /**
+     * Load a store from a buffer
+     * @param store Store (output)
+     * @param bytes Saved state
+     * @return Result of loadState
+     */
+    bool load(BodyStore& store, const std::vector<uint8_t>& bytes) {
+        FILE* file = tmpfile();
+        TEST_ASSERT_NOT_NULL(file);
+        fwrite(bytes.data(), 1, bytes.size(), file);
+        rewind(file);
+        StateReader reader(file);
+        bool loaded = store.loadState(reader, CAPACITY);
+        fclose(file);
+        return loaded;
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_operations_match_model() {
+    for (uint32_t seed = 1; seed <= SEQUENCES; seed++) {
+        BodyStore store;
+        std::vector<ModelBody> model;
+        runSequence(seed, store, model);
+    }
+}
+
+void test_full_store_rejects_add() {
+    BodyStore store;
+    store.reserve(CAPACITY);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        TEST_ASSERT_TRUE(addBody(store, 1) != BodyStore::INVALID_ID);
+    }
+    uint32_t before = store.checksum();
+    TEST_ASSERT_EQUAL_UINT32(BodyStore::INVALID_ID, addBody(store, 2));
+    TEST_ASSERT_EQUAL(CAPACITY, store.size());
+    TEST_ASSERT_EQUAL_UINT32(before, store.checksum());
+
+    // A freed slot is reused under a new generation
+    BodyId removed = store.id[0];
+    store.remove(0);
+    BodyId reused = addBody(store, 3);
+    TEST_ASSERT_EQUAL_UINT32(removed & 0xFFFF, reused & 0xFFFF);
+    TEST_ASSERT_TRUE(reused != removed);
+    TEST_ASSERT_EQUAL_INT(-1, store.indexOf(removed));
+}
+
+void test_state_round_trip() {
+    for (uint32_t seed = 1; seed <= SEQUENCES; seed++) {
+        BodyStore store;
+        std::vector<ModelBody> model;
+        runSequence(seed, store, model);
+
+        BodyStore loaded;
+        TEST_ASSERT_TRUE(load(loaded, save(store)));
+        TEST_ASSERT_EQUAL_UINT32(store.checksum(), loaded.checksum());
+        check(loaded, model, std::vector<BodyId>());
+
+        // The free slots come back in the same order, so both stores hand out the same IDs
+        while (store.size() < CAPACITY) {
+            TEST_ASSERT_EQUAL_UINT32(addBody(store, 7), addBody(loaded, 7));
+        }
+        TEST_ASSERT_EQUAL_UINT32(BodyStore::INVALID_ID, addBody(loaded, 7));
+        TEST_ASSERT_EQUAL_UINT32(store.checksum(), loaded.checksum());
+    }
+}
+
+void test_damaged_state_is_rejected_or_consistent() {
+    BodyStore store;
+    std::vector<ModelBody> model;
+    runSequence(SEQUENCES + 1, store, model);
+    const std::vector<uint8_t> saved = save(store);
+
+    std::mt19937 random(11);
+    int rejected = 0;
+    for (int n = 0; n < CORRUPTIONS; n++) {
+        // Flip a few bits, or cut the state short
+        std::vector<uint8_t> bytes = saved;
+        if (n % 10 == 0) {
+            bytes.resize(random() % bytes.size());
+        } else {
+            for (int flips = 1 + random() % 3; flips > 0; flips--) {
+                bytes[random() % bytes.size()] ^= static_cast<uint8_t>(1u << (random() % 8));
+            }
+        }
+
+        BodyStore loaded;
+        if (!load(loaded, bytes)) {
+            TEST_ASSERT_EQUAL(0, loaded.size());
+            TEST_ASSERT_EQUAL(0, loaded.capacity());
+            rejected++;
+            continue;
+        }
+
+        // Whatever loaded keeps IDs and indices in step, through adds until full and removals until empty
+        TEST_ASSERT_TRUE(loaded.size() <= loaded.capacity());
+        for (size_t i = 0; i < loaded.size(); i++) {
+            TEST_ASSERT_EQUAL_INT(static_cast<int>(i), loaded.indexOf(loaded.id[i]));
+        }
+        size_t room = loaded.capacity() - loaded.size();
+        for (size_t i = 0; i < room; i++) {
+            BodyId id = addBody(loaded, 9);
+            TEST_ASSERT_TRUE(id != BodyStore::INVALID_ID);
+            TEST_ASSERT_EQUAL_INT(static_cast<int>(loaded.size() - 1), loaded.indexOf(id));
+        }
+        TEST_ASSERT_EQUAL_UINT32(BodyStore::INVALID_ID, addBody(loaded, 9));
+        while (!loaded.empty()) {
+            BodyId id = loaded.id[0];
+            loaded.remove(0);
+            TEST_ASSERT_EQUAL_INT(-1, loaded.indexOf(id));
+            if (!loaded.empty()) {
+                TEST_ASSERT_EQUAL_INT(0, loaded.indexOf(loaded.id[0]));
+            }
+        }
+    }
+
+    // Flips in the slot map are caught (the planet values themselves are not checked)
+    TEST_ASSERT_TRUE(rejected > CORRUPTIONS / 10);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_operations_match_model);
+    RUN_TEST(test_full_store_rejects_add);
+    RUN_TEST(test_state_round_trip);
+    RUN_TEST(test_damaged_state_is_rejected_or_consistent);
+    return UNITY_END();
+}
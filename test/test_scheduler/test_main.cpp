@@ -0,0 +1,221 @@
+/**
+ * Tests of the job scheduler (include/Scheduler.h)
+ *
+ * The scheduler runs on a fake clock: sleeping jumps the clock to the wake-up
+ * time and jobs advance it by the time they take, so deadlines, late starts,
+ * skipped periods and idle time are exact. The same checks run with the clock
+ * starting just before the 32-bit microsecond counter wraps.
+ *
+ *   pio test -e native -f test_scheduler
+ */
+#include <unity.h>
+#include <vector>
+#include "Scheduler.h"
+
+namespace {
+    constexpr uint32_t PERIOD = 10000;                                    // Period of the test jobs (microseconds)
+    constexpr uint32_t LATE = SchedulerConstants::LATE_TOLERANCE + 1000;  // A start delay counted as late
+    constexpr uint32_t BEFORE_WRAP = 0xFFFFFFFFu - 25000;                 // Start time shortly before the clock wraps
+
+    uint32_t fakeNow = 0;      // Current time of the fake clock
+    uint32_t sleepCount = 0;   // Calls of fakeSleep
+
+    uint32_t fakeClock() {
+        return fakeNow;
+    }
+
+    void fakeSleep(uint32_t deadlineMicros) {
+        fakeNow = deadlineMicros;
+        sleepCount++;
+    }
+
+    /**
+     * Get a job that takes some time on the fake clock
+     * @param cost Time the job takes (microseconds)
+     * @param runs Counter of the runs (output)
+     * @return Job
+     */
+    Scheduler::Job busyJob(uint32_t cost, int& runs) {
+        return [cost, &runs]() {
+            fakeNow += cost;
+            runs++;
+        };
+    }
+
+    /**
+     * Check the cadence of a job that falls behind by different amounts
+     * @param start Time the job is added
+     */
+    void checkCadence(uint32_t start) {
+        fakeNow = start;
+        Scheduler scheduler(fakeClock, fakeSleep);
+        int runs = 0;
+        int id = scheduler.add("job", PERIOD, 1, busyJob(0, runs));
+
+        // On time: sleeps until the next deadline
+        scheduler.runOnce();
+        TEST_ASSERT_EQUAL(1, runs);
+        TEST_ASSERT_EQUAL_UINT32(start + PERIOD, fakeNow);
+
+        // Late, but less than a period: the next deadline stays on the grid, not one period after now
+        fakeNow = start + PERIOD + LATE;
+        scheduler.runOnce();
+        TEST_ASSERT_EQUAL(2, runs);
+        TEST_ASSERT_EQUAL(1, scheduler.getStats(id).lateRuns);
+        TEST_ASSERT_EQUAL(LATE, scheduler.getStats(id).maxLateMicros);
+        TEST_ASSERT_EQUAL(0, scheduler.getStats(id).skippedPeriods);
+        TEST_ASSERT_EQUAL_UINT32(start + 2 * PERIOD, fakeNow);
+
+        // One microsecond short of a period behind: still nothing skipped, the next run follows right away
+        fakeNow = start + 3 * PERIOD - 1;
+        scheduler.runOnce();
+        TEST_ASSERT_EQUAL(3, runs);
+        TEST_ASSERT_EQUAL(0, scheduler.getStats(id).skippedPeriods);
+        TEST_ASSERT_EQUAL_UINT32(start + 3 * PERIOD, fakeNow);
+
+        // Exactly a period behind: the deadline the run lands on is dropped rather than run back to back
+        fakeNow = start + 4 * PERIOD;
+        scheduler.runOnce();
+        TEST_ASSERT_EQUAL(4, runs);
+        TEST_ASSERT_EQUAL(1, scheduler.getStats(id).skippedPeriods);
+        TEST_ASSERT_EQUAL_UINT32(start + 5 * PERIOD, fakeNow);
+
+        // Two and a half periods behind: two deadlines dropped, back on the grid
+        fakeNow = start + 7 * PERIOD + PERIOD / 2;
+        scheduler.runOnce();
+        TEST_ASSERT_EQUAL(5, runs);
+        TEST_ASSERT_EQUAL(3, scheduler.getStats(id).skippedPeriods);
+        TEST_ASSERT_EQUAL_UINT32(start + 8 * PERIOD, fakeNow);
+
+        // Every deadline so far was either run or counted as skipped
+        TEST_ASSERT_EQUAL(8, scheduler.getStats(id).runs + scheduler.getStats(id).skippedPeriods);
+        TEST_ASSERT_EQUAL(4, scheduler.getStats(id).lateRuns);
+        TEST_ASSERT_EQUAL(PERIOD * 5 / 2, scheduler.getStats(id).maxLateMicros);
+    }
+
+    /**
+     * Check the idle and elapsed time of a job that takes a quarter of its period
+     * @param start Time the job is added
+     */
+    void checkIdleTime(uint32_t start) {
+        fakeNow = start;
+        Scheduler scheduler(fakeClock, fakeSleep);
+        int runs = 0;
+        scheduler.add("job", PERIOD, 1, busyJob(PERIOD / 4, runs));
+        for (int pass = 0; pass < 10; pass++) {
+            scheduler.runOnce();
+        }
+        TEST_ASSERT_EQUAL(10, runs);
+        TEST_ASSERT_EQUAL(10 * PERIOD, scheduler.getElapsedMicros());
+        TEST_ASSERT_EQUAL(10 * (PERIOD - PERIOD / 4), scheduler.getIdleMicros());
+    }
+}
+
+void setUp() {
+    fakeNow = 0;
+    sleepCount = 0;
+}
+
+void tearDown() {
+}
+
+void test_due_jobs_run_by_priority() {
+    Scheduler scheduler(fakeClock, fakeSleep);
+    std::vector<int> order;
+    scheduler.add("low", PERIOD, 1, [&order]() { order.push_back(0); });
+    scheduler.add("high", PERIOD, 3, [&order]() { order.push_back(1); });
+    scheduler.add("middle", PERIOD, 2, [&order]() { order.push_back(2); });
+    scheduler.runOnce();
+    TEST_ASSERT_EQUAL(3, order.size());
+    TEST_ASSERT_EQUAL(1, order[0]);
+    TEST_ASSERT_EQUAL(2, order[1]);
+    TEST_ASSERT_EQUAL(0, order[2]);
+}
+
+void test_equal_priorities_run_by_deadline() {
+    // The job added later has the later deadline, so it runs second when both are due
+    Scheduler scheduler(fakeClock, fakeSleep);
+    std::vector<int> order;
+    fakeNow = 500;
+    int second = scheduler.add("second", PERIOD, 1, [&order]() { order.push_back(1); });
+    fakeNow = 100;
+    scheduler.add("first", PERIOD, 1, [&order]() { order.push_back(0); });
+    fakeNow = 1000;
+    scheduler.runOnce();
+    TEST_ASSERT_EQUAL(2, order.size());
+    TEST_ASSERT_EQUAL(0, order[0]);
+    TEST_ASSERT_EQUAL(1, order[1]);
+    TEST_ASSERT_EQUAL(1, scheduler.getStats(second).runs);
+}
+
+void test_each_job_runs_once_per_pass() {
+    // A job that runs on every pass keeps the loop from sleeping but still runs once per pass
+    Scheduler scheduler(fakeClock, fakeSleep);
+    int everyPass = 0;
+    int periodic = 0;
+    int id = scheduler.add("every", 0, 1, busyJob(PERIOD, everyPass));
+    scheduler.add("periodic", PERIOD, 2, busyJob(0, periodic));
+    for (int pass = 0; pass < 5; pass++) {
+        scheduler.runOnce();
+    }
+    TEST_ASSERT_EQUAL(5, everyPass);
+    TEST_ASSERT_EQUAL(5, periodic);
+    TEST_ASSERT_EQUAL(0, sleepCount);
+    TEST_ASSERT_EQUAL(0, scheduler.getIdleMicros());
+    TEST_ASSERT_EQUAL(5 * PERIOD, scheduler.getElapsedMicros());
+    TEST_ASSERT_EQUAL(0, scheduler.getStats(id).lateRuns);
+}
+
+void test_late_run_keeps_cadence() {
+    checkCadence(0);
+}
+
+void test_late_run_keeps_cadence_across_wrap() {
+    checkCadence(BEFORE_WRAP);
+}
+
+void test_restart_moves_deadline() {
+    Scheduler scheduler(fakeClock, fakeSleep);
+    int runs = 0;
+    int id = scheduler.add("job", PERIOD, 1, busyJob(0, runs));
+    fakeNow = 300;
+    scheduler.restart(id);
+    fakeNow = PERIOD;
+    scheduler.runOnce();
+    TEST_ASSERT_EQUAL(0, runs);
+    TEST_ASSERT_EQUAL_UINT32(PERIOD + 300, fakeNow);
+    scheduler.runOnce();
+    TEST_ASSERT_EQUAL(1, runs);
+}
+
+void test_idle_and_elapsed_time() {
+    checkIdleTime(0);
+}
+
+void test_idle_and_elapsed_time_across_wrap() {
+    checkIdleTime(BEFORE_WRAP);
+}
+
+void test_job_limit() {
+    Scheduler scheduler(fakeClock, fakeSleep);
+    for (int i = 0; i < SchedulerConstants::MAX_JOBS; i++) {
+        TEST_ASSERT_EQUAL(i, scheduler.add("job", PERIOD, 1, []() {}));
+    }
+    TEST_ASSERT_EQUAL(-1, scheduler.add("extra", PERIOD, 1, []() {}));
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_due_jobs_run_by_priority);
+    RUN_TEST(test_equal_priorities_run_by_deadline);
+    RUN_TEST(test_each_job_runs_once_per_pass);
+    RUN_TEST(test_late_run_keeps_cadence);
+    RUN_TEST(test_late_run_keeps_cadence_across_wrap);
+    RUN_TEST(test_restart_moves_deadline);
+    RUN_TEST(test_idle_and_elapsed_time);
+    RUN_TEST(test_idle_and_elapsed_time_across_wrap);
+    RUN_TEST(test_job_limit);
+    return UNITY_END();
+}
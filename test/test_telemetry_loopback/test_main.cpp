@@ -0,0 +1,281 @@
+/**
+ * Loopback test of the serial telemetry stream over a pseudo-terminal
+ *
+ * Telemetry writes its frames to the device end of a pty pair through the
+ * native HAL's serial output, and TelemetryDecoder reads them back from the
+ * host end, as tools/TelemetryDecoder.cpp does with a real serial port.
+ * Corrupted and truncated frames are injected between the good ones to check
+ * that the checksum rejects them and the decoder resyncs at the next keyframe.
+ *
+ *   pio test -e native -f test_telemetry_loopback
+ */
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "Hal.h"
+#include "Constants.h"
+#include "SimulationSnapshot.h"
+#include "Telemetry.h"
+#include "TelemetryDecoder.h"
+#include "TelemetryFormat.h"
+
+namespace {
+    constexpr int BODY_COUNT = 4;         // Planets in the streamed snapshot
+    constexpr int READ_TIMEOUT = 50;      // Time to wait for more bytes on the host end (milliseconds)
+    constexpr size_t WRITE_RESERVE = 256; // Free serial buffer kept before each frame, so none is dropped
+
+    int hostEnd = -1;           // Host end of the pty (the decoder reads it)
+    int deviceEnd = -1;         // Device end of the pty (the serial port Telemetry writes to)
+    FILE* serial = nullptr;     // Device end as the HAL's serial output
+    SimulationSnapshot snapshot;
+    uint32_t now = 0;           // Time passed to Telemetry::update (milliseconds)
+    std::string text;           // Serial text received outside frames
+
+    /**
+     * Move the planets a little and advance the snapshot by a step
+     */
+    void advance() {
+        BodyStore& bodies = snapshot.bodies;
+        for (size_t i = 0; i < bodies.size(); i++) {
+            bodies.x[i] = Real(toDouble(bodies.x[i]) + toDouble(bodies.vx[i]));
+            bodies.y[i] = Real(toDouble(bodies.y[i]) + toDouble(bodies.vy[i]));
+        }
+        snapshot.step++;
+        now += TelemetryConstants::INTERVAL;
+    }
+
+    /**
+     * Advance the snapshot and let Telemetry write a frame of it to the serial port
+     * @param telemetry Encoder
+     * @return true if the frame was written
+     */
+    bool sendFrame(Telemetry& telemetry) {
+        advance();
+        while (hal::serialWritable() < WRITE_RESERVE) {
+            hal::delay(1);
+        }
+        bool sent = telemetry.update(snapshot, now);
+        fflush(serial);
+        return sent;
+    }
+
+    /**
+     * Let Telemetry encode the next frame into memory instead of the serial port
+     * (so it can be damaged before it is written)
+     * @param telemetry Encoder
+     * @return Bytes of the frame
+     */
+    std::vector<uint8_t> captureFrame(Telemetry& telemetry) {
+        FILE* capture = tmpfile();
+        TEST_ASSERT_NOT_NULL(capture);
+        hal::setSerialOutput(capture);
+        bool sent = sendFrame(telemetry);
+        hal::setSerialOutput(serial);
+        TEST_ASSERT_TRUE(sent);
+
+        std::vector<uint8_t> bytes(ftell(capture));
+        rewind(capture);
+        TEST_ASSERT_EQUAL(bytes.size(), fread(bytes.data(), 1, bytes.size(), capture));
+        fclose(capture);
+        return bytes;
+    }
+
+    /**
+     * Write raw bytes to the serial port
+     * @param bytes Bytes
+     * @param size Number of bytes
+     */
+    void writeRaw(const uint8_t* bytes, size_t size) {
+        TEST_ASSERT_EQUAL(static_cast<ssize_t>(size), write(deviceEnd, bytes, size));
+    }
+
+    /**
+     * Feed everything that arrived on the host end to the decoder
+     * @param decoder Decoder
+     */
+    void receive(TelemetryDecoder& decoder) {
+        pollfd fd = {hostEnd, POLLIN, 0};
+        uint8_t chunk[1024];
+        while (poll(&fd, 1, READ_TIMEOUT) > 0) {
+            ssize_t received = read(hostEnd, chunk, sizeof(chunk));
+            if (received <= 0) {
+                break;
+            }
+            decoder.feed(chunk, received);
+        }
+    }
+
+    /**
+     * Check that the decoder holds the planets of the snapshot as Telemetry quantizes them
+     * @param decoder Decoder
+     */
+    void checkBodies(const TelemetryDecoder& decoder) {
+        const BodyStore& bodies = snapshot.bodies;
+        const std::vector<TelemetryDecoder::Body>& decoded = decoder.getBodies();
+        TEST_ASSERT_TRUE(decoder.isSynced());
+        TEST_ASSERT_EQUAL(bodies.size(), decoded.size());
+        for (const TelemetryDecoder::Body& body : decoded) {
+            int index = bodies.indexOf(body.id);
+            TEST_ASSERT_TRUE(index >= 0);
+            TEST_ASSERT_EQUAL_INT32(lround(toDouble(bodies.x[index]) * TelemetryFormat::POSITION_SCALE), body.x);
+            TEST_ASSERT_EQUAL_INT32(lround(toDouble(bodies.y[index]) * TelemetryFormat::POSITION_SCALE), body.y);
+            TEST_ASSERT_EQUAL_INT32(lround(toDouble(bodies.vx[index]) * TelemetryFormat::VELOCITY_SCALE), body.vx);
+            TEST_ASSERT_EQUAL_INT32(lround(toDouble(bodies.vy[index]) * TelemetryFormat::VELOCITY_SCALE), body.vy);
+        }
+    }
+
+    /**
+     * Send frames until the decoder has decoded the next keyframe
+     * @param telemetry Encoder
+     * @param decoder Decoder
+     */
+    void resync(Telemetry& telemetry, TelemetryDecoder& decoder) {
+        uint32_t keyframes = decoder.getStats().keyframes;
+        for (uint32_t i = 0; i <= TelemetryConstants::KEYFRAME_INTERVAL && decoder.getStats().keyframes == keyframes; i++) {
+            TEST_ASSERT_TRUE(sendFrame(telemetry));
+            receive(decoder);
+        }
+        checkBodies(decoder);
+    }
+
+    TelemetryDecoder makeDecoder() {
+        return TelemetryDecoder(TelemetryDecoder::FrameHandler(), [](uint8_t byte) { text.push_back(static_cast<char>(byte)); });
+    }
+}
+
+void setUp() {
+    // Raw mode on the device end, so binary frames pass the line discipline unchanged
+    hostEnd = posix_openpt(O_RDWR | O_NOCTTY);
+    TEST_ASSERT_TRUE(hostEnd >= 0);
+    TEST_ASSERT_EQUAL(0, grantpt(hostEnd));
+    TEST_ASSERT_EQUAL(0, unlockpt(hostEnd));
+    deviceEnd = open(ptsname(hostEnd), O_RDWR | O_NOCTTY);
+    TEST_ASSERT_TRUE(deviceEnd >= 0);
+    termios settings;
+    TEST_ASSERT_EQUAL(0, tcgetattr(deviceEnd, &settings));
+    cfmakeraw(&settings);
+    TEST_ASSERT_EQUAL(0, tcsetattr(deviceEnd, TCSANOW, &settings));
+    serial = fdopen(deviceEnd, "w");
+    TEST_ASSERT_NOT_NULL(serial);
+    hal::setSerialOutput(serial);
+
+    // A few planets on diverging paths
+    snapshot = SimulationSnapshot();
+    snapshot.bodies.reserve(BODY_COUNT + 1);
+    for (int i = 0; i < BODY_COUNT; i++) {
+        snapshot.bodies.add(Real(20.0 * (i + 1)), Real(-10.0 * i), Real(0.3 * i), Real(0.2), Real(1.0), 2.0f, 0xFFFF);
+    }
+    now = hal::millis();
+    text.clear();
+}
+
+void tearDown() {
+    hal::setSerialOutput(nullptr);
+    fclose(serial);  // Closes the device end
+    close(hostEnd);
+}
+
+void test_frames_arrive_intact() {
+    Telemetry telemetry;
+    TelemetryDecoder decoder = makeDecoder();
+    telemetry.setEnabled(true);
+
+    // Spawns, removals and serial text between the frames
+    for (int i = 0; i < 10; i++) {
+        if (i == 3) {
+            snapshot.bodies.add(Real(-40.0), Real(30.0), Real(-0.5), Real(0.1), Real(1.0), 2.0f, 0xF800);
+        }
+        if (i == 6) {
+            snapshot.bodies.remove(0);
+        }
+        if (i == 8) {
+            hal::print("state: saved\n");
+            fflush(serial);
+        }
+        TEST_ASSERT_TRUE(sendFrame(telemetry));
+        receive(decoder);
+        checkBodies(decoder);
+    }
+
+    const TelemetryDecoderStats& stats = decoder.getStats();
+    TEST_ASSERT_EQUAL_UINT32(10, stats.frames);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.keyframes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.crcErrors);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.gaps);
+    TEST_ASSERT_EQUAL_STRING("state: saved\n", text.c_str());
+}
+
+void test_corrupted_frame_is_rejected() {
+    Telemetry telemetry;
+    TelemetryDecoder decoder = makeDecoder();
+    telemetry.setEnabled(true);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(sendFrame(telemetry));
+    }
+    receive(decoder);
+    checkBodies(decoder);
+
+    // Flip a bit in the payload of the next delta: its checksum no longer matches
+    std::vector<uint8_t> frame = captureFrame(telemetry);
+    frame[TelemetryFormat::HEADER_SIZE + 2] ^= 0x10;
+    writeRaw(frame.data(), frame.size());
+    receive(decoder);
+    TEST_ASSERT_TRUE(decoder.getStats().crcErrors >= 1);
+    TEST_ASSERT_EQUAL_UINT32(3, decoder.getStats().frames);
+
+    // The next delta reveals the gap; deltas are skipped until the next keyframe
+    resync(telemetry, decoder);
+    const TelemetryDecoderStats& stats = decoder.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.gaps);
+    TEST_ASSERT_TRUE(stats.skipped >= 1);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.keyframes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.malformed);
+
+    // And stays in sync afterwards
+    TEST_ASSERT_TRUE(sendFrame(telemetry));
+    receive(decoder);
+    checkBodies(decoder);
+}
+
+void test_truncated_frame_is_resynced() {
+    Telemetry telemetry;
+    TelemetryDecoder decoder = makeDecoder();
+    telemetry.setEnabled(true);
+    TEST_ASSERT_TRUE(sendFrame(telemetry));
+    receive(decoder);
+    checkBodies(decoder);
+
+    // Only the first half of a delta goes out: its header claims bytes that belong to later frames
+    std::vector<uint8_t> frame = captureFrame(telemetry);
+    writeRaw(frame.data(), frame.size() / 2);
+    receive(decoder);
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getStats().frames);
+
+    // The checksum fails once the claimed length has arrived, and the scan restarts a byte later
+    resync(telemetry, decoder);
+    const TelemetryDecoderStats& stats = decoder.getStats();
+    TEST_ASSERT_TRUE(stats.crcErrors >= 1);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.gaps);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.keyframes);
+
+    TEST_ASSERT_TRUE(sendFrame(telemetry));
+    receive(decoder);
+    checkBodies(decoder);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_arrive_intact);
+    RUN_TEST(test_corrupted_frame_is_rejected);
+    RUN_TEST(test_truncated_frame_is_resynced);
+    return UNITY_END();
+}
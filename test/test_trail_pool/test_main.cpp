@@ -0,0 +1,356 @@
+/**
+ * Tests of the shared trail pool (include/TrailPool.h)
+ *
+ * Random sequences of adds, swap-and-pop removals, compactions, recorded
+ * points, budget changes and clears run against a simple model that keeps every
+ * trail as its own list of points. After each operation the trails must hold
+ * the model's points, share the budget equally and not overlap in the pool.
+ * Saved states must load back unchanged, and damaged ones must either be
+ * rejected or load as a pool that stays inside its arrays.
+ *
+ *   pio test -e native -f test_trail_pool
+ */
+#include <unity.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+#include "StateFile.h"
+#include "TrailPool.h"
+
+namespace {
+    constexpr int OPERATIONS = 4000;      // Random operations per sequence
+    constexpr int SEQUENCES = 8;          // Sequences (seeds) per test
+    constexpr int MAX_TRAILS = 300;       // Most trails a sequence grows to
+    constexpr int COORDINATE = 40000;     // Coordinates range over +-COORDINATE (past int16, to test clamping)
+    constexpr int CORRUPTIONS = 300;      // Damaged copies of a saved state
+
+    typedef std::pair<int, int> Point;
+    typedef std::vector<Point> ModelTrail;  // Points of a trail, oldest first
+
+    int clamp16(int value) {
+        return std::max(-32768, std::min(32767, value));
+    }
+
+    /**
+     * Get the first point of the pool used by any trail
+     * @param pool Pool
+     * @return Lowest trail start (nullptr without trails)
+     */
+    const int16_t* firstPoint(const TrailPool& pool) {
+        const int16_t* first = nullptr;
+        for (size_t i = 0; i < pool.size(); i++) {
+            if (first == nullptr || pool.getXs(i) < first) {
+                first = pool.getXs(i);
+            }
+        }
+        return first;
+    }
+
+    /**
+     * Bring the model to the trail lengths of the pool, as redistribution does
+     * (a shorter trail keeps its newest points, a longer one repeats its oldest)
+     * @param pool Pool
+     * @param model Model trails
+     */
+    void sync(const TrailPool& pool, std::vector<ModelTrail>& model) {
+        for (size_t i = 0; i < model.size(); i++) {
+            ModelTrail& trail = model[i];
+            size_t length = pool.getLength(i);
+            if (trail.size() > length) {
+                trail.erase(trail.begin(), trail.begin() + (trail.size() - length));
+            } else if (trail.size() < length && !trail.empty()) {
+                trail.insert(trail.begin(), length - trail.size(), trail.front());
+            }
+        }
+    }
+
+    /**
+     * Check that the pool holds the model's trails and keeps its layout invariants
+     * @param pool Pool
+     * @param model Model trails
+     * @param fragmented Whether removals were not compacted yet (shares are then not checked)
+     */
+    void check(const TrailPool& pool, const std::vector<ModelTrail>& model, bool fragmented) {
+        TEST_ASSERT_EQUAL(model.size(), pool.size());
+        size_t total = 0;
+        int shortest = pool.getMaxLength();
+        int longest = 0;
+        std::vector<std::pair<size_t, size_t>> spans;
+        const int16_t* base = firstPoint(pool);
+        for (size_t i = 0; i < model.size(); i++) {
+            int length = pool.getLength(i);
+            TEST_ASSERT_EQUAL(model[i].size(), static_cast<size_t>(length));
+            TEST_ASSERT_TRUE(length <= pool.getMaxLength());
+            TEST_ASSERT_TRUE(length == 0 || pool.getHead(i) < length);
+            for (int age = 0; age < length; age++) {
+                const Point& point = model[i][length - 1 - age];
+                TEST_ASSERT_EQUAL_INT(clamp16(point.first), pool.getX(i, age));
+                TEST_ASSERT_EQUAL_INT(clamp16(point.second), pool.getY(i, age));
+            }
+            size_t offset = pool.getXs(i) - base;
+            TEST_ASSERT_TRUE(offset + length <= pool.getPointCount());
+            spans.push_back({offset, offset + length});
+            total += length;
+            shortest = std::min(shortest, length);
+            longest = std::max(longest, length);
+        }
+
+        // No two trails share a point
+        std::sort(spans.begin(), spans.end());
+        for (size_t i = 1; i < spans.size(); i++) {
+            TEST_ASSERT_TRUE(spans[i - 1].second <= spans[i].first);
+        }
+
+        // Equal shares of the budget, each capped at the maximum length
+        TEST_ASSERT_TRUE(total <= pool.getBudget());
+        if (!fragmented && !model.empty()) {
+            TEST_ASSERT_TRUE(longest - shortest <= 1);
+            TEST_ASSERT_EQUAL(std::min(pool.getBudget(), model.size() * pool.getMaxLength()), total);
+            TEST_ASSERT_EQUAL(total, pool.getPointCount());
+        }
+    }
+
+    /**
+     * Run random operations on a pool and its model, checking after each one
+     * @param seed Seed of the sequence
+     * @param pool Pool (output)
+     * @param model Model trails (output)
+     */
+    void runSequence(uint32_t seed, TrailPool& pool, std::vector<ModelTrail>& model) {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<int> coordinate(-COORDINATE, COORDINATE);
+        std::uniform_int_distribution<int> operation(0, 99);
+        pool.reserve(MAX_TRAILS);
+        bool fragmented = false;
+        for (int n = 0; n < OPERATIONS; n++) {
+            int kind = operation(random);
+            if (kind < 25 && model.size() < static_cast<size_t>(MAX_TRAILS)) {
+                // Adding compacts pending holes first
+                int x = coordinate(random);
+                int y = coordinate(random);
+                pool.add(x, y);
+                model.push_back(ModelTrail());
+                sync(pool, model);
+                model.back().assign(pool.getLength(model.size() - 1), Point(x, y));
+                fragmented = false;
+            } else if (kind < 40 && !model.empty()) {
+                // Swap-and-pop, sometimes several before one compaction
+                size_t index = random() % model.size();
+                pool.remove(index);
+                model[index] = model.back();
+                model.pop_back();
+                fragmented = true;
+                if (random() % 3 == 0) {
+                    pool.compact();
+                    sync(pool, model);
+                    fragmented = false;
+                }
+            } else if (kind == 43) {
+                pool.clear();
+                model.clear();
+                fragmented = false;
+            } else if (kind < 47) {
+                // Any budget that leaves every trail at least one point, with a random maximum length
+                size_t budget = MAX_TRAILS + random() % 4000;
+                int maxLength = 1 + random() % PlanetConstants::TRAIL_LENGTH;
+                pool.setBudget(budget, maxLength);
+                sync(pool, model);
+                fragmented = false;
+            } else if (!model.empty()) {
+                size_t index = random() % model.size();
+                int x = coordinate(random);
+                int y = coordinate(random);
+                pool.record(index, x, y);
+                if (!model[index].empty()) {
+                    model[index].erase(model[index].begin());
+                    model[index].push_back(Point(x, y));
+                }
+            }
+            check(pool, model, fragmented);
+        }
+    }
+
+    /**
+     * Save a pool into a buffer
+     * @param pool Pool
+     * @return Bytes of the saved state
+     */
+    std::vector<uint8_t> save(const TrailPool& pool) {
+        FILE* file = tmpfile();
+        TEST_ASSERT_NOT_NULL(file);
+        StateWriter writer(file);
+        pool.saveState(writer);
+        TEST_ASSERT_TRUE(writer.ok());
+        std::vector<uint8_t> bytes(ftell(file));
+        rewind(file);
+        TEST_ASSERT_EQUAL(bytes.size(), fread(bytes.data(), 1, bytes.size(), file));
+        fclose(file);
+        return bytes;
+    }
+
+    /**
+     * Load a pool from a buffer
+     * @param pool Pool (output)
+     * @param bytes Saved state
+     * @return Result of loadState
+     */
+    bool load(TrailPool& pool, const std::vector<uint8_t>& bytes) {
+        FILE* file = tmpfile();
+        TEST_ASSERT_NOT_NULL(file);
+        fwrite(bytes.data(), 1, bytes.size(), file);
+        rewind(file);
+        StateReader reader(file);
+        bool loaded = pool.loadState(reader, MAX_TRAILS);
+        fclose(file);
+        return loaded;
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_operations_match_model() {
+    for (uint32_t seed = 1; seed <= SEQUENCES; seed++) {
+        TrailPool pool;
+        std::vector<ModelTrail> model;
+        runSequence(seed, pool, model);
+    }
+}
+
+void test_full_trails_append_without_moving_others() {
+    // With room for every trail at full length, adding never touches the trails before it
+    TrailPool pool(100 * PlanetConstants::TRAIL_LENGTH);
+    pool.reserve(100);
+    std::vector<const int16_t*> starts;
+    for (int i = 0; i < 100; i++) {
+        pool.add(i, -i);
+        starts.push_back(pool.getXs(i));
+        TEST_ASSERT_EQUAL_INT(PlanetConstants::TRAIL_LENGTH, pool.getLength(i));
+    }
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(starts[i] == pool.getXs(i));
+        TEST_ASSERT_EQUAL_INT(i, pool.getX(i, PlanetConstants::TRAIL_LENGTH - 1));
+    }
+
+    // One more trail than fits makes the trails share the budget
+    pool.add(1000, 1000);
+    size_t total = 0;
+    for (size_t i = 0; i < pool.size(); i++) {
+        TEST_ASSERT_TRUE(pool.getLength(i) >= PlanetConstants::TRAIL_LENGTH - 1);
+        total += pool.getLength(i);
+    }
+    TEST_ASSERT_EQUAL(pool.getBudget(), total);
+    TEST_ASSERT_EQUAL_INT(1000, pool.getX(100, 0));
+}
+
+void test_refill_after_clear() {
+    // Removing the first of four full trails leaves them out of index order in the pool
+    TrailPool pool(4 * PlanetConstants::TRAIL_LENGTH);
+    for (int i = 0; i < 4; i++) {
+        pool.add(i, i);
+    }
+    pool.remove(0);
+    pool.compact();
+
+    // After a clear, five new trails must still share the pool without overwriting each other
+    pool.clear();
+    std::vector<ModelTrail> model;
+    for (int i = 0; i < 5; i++) {
+        pool.add(10 * i, -10 * i);
+        model.push_back(ModelTrail());
+        sync(pool, model);
+        model.back().assign(pool.getLength(i), Point(10 * i, -10 * i));
+        check(pool, model, false);
+    }
+}
+
+void test_state_round_trip() {
+    for (uint32_t seed = 1; seed <= SEQUENCES; seed++) {
+        TrailPool pool;
+        std::vector<ModelTrail> model;
+        runSequence(seed, pool, model);
+
+        TrailPool loaded;
+        loaded.setBudget(pool.getBudget(), pool.getMaxLength());
+        TEST_ASSERT_TRUE(load(loaded, save(pool)));
+        check(loaded, model, true);
+
+        // The loaded pool keeps working
+        loaded.add(1, 2);
+        model.push_back(ModelTrail());
+        sync(loaded, model);
+        model.back().assign(loaded.getLength(model.size() - 1), Point(1, 2));
+        check(loaded, model, false);
+    }
+}
+
+void test_state_of_another_budget_is_rejected() {
+    TrailPool pool;
+    pool.add(1, 2);
+    TrailPool other(TrailConstants::POOL_POINTS / 2);
+    TEST_ASSERT_FALSE(load(other, save(pool)));
+    TEST_ASSERT_EQUAL(0, other.size());
+}
+
+void test_damaged_state_is_rejected_or_consistent() {
+    TrailPool pool;
+    std::vector<ModelTrail> model;
+    runSequence(SEQUENCES + 1, pool, model);
+    pool.compact();
+    const std::vector<uint8_t> saved = save(pool);
+
+    std::mt19937 random(7);
+    for (int n = 0; n < CORRUPTIONS; n++) {
+        // Flip a few bits, or cut the state short
+        std::vector<uint8_t> bytes = saved;
+        if (n % 10 == 0) {
+            bytes.resize(random() % bytes.size());
+        } else {
+            for (int flips = 1 + random() % 3; flips > 0; flips--) {
+                bytes[random() % bytes.size()] ^= static_cast<uint8_t>(1u << (random() % 8));
+            }
+        }
+
+        TrailPool loaded;
+        loaded.setBudget(pool.getBudget(), pool.getMaxLength());
+        if (!load(loaded, bytes)) {
+            TEST_ASSERT_EQUAL(0, loaded.size());
+            TEST_ASSERT_EQUAL(0, loaded.getPointCount());
+            continue;
+        }
+
+        // Whatever loaded stays inside the pool, and later operations keep it there
+        const int16_t* base = firstPoint(loaded);
+        for (size_t i = 0; i < loaded.size(); i++) {
+            TEST_ASSERT_TRUE(loaded.getLength(i) <= loaded.getMaxLength());
+            TEST_ASSERT_TRUE(static_cast<size_t>(loaded.getXs(i) - base) + loaded.getLength(i) <= loaded.getPointCount());
+        }
+        for (size_t i = 0; i < loaded.size(); i++) {
+            loaded.record(i, 3, 4);
+        }
+        if (loaded.size() > 0) {
+            loaded.remove(0);
+            loaded.compact();
+        }
+        loaded.add(5, 6);
+        TEST_ASSERT_TRUE(loaded.getPointCount() <= loaded.getBudget());
+    }
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_operations_match_model);
+    RUN_TEST(test_full_trails_append_without_moving_others);
+    RUN_TEST(test_refill_after_clear);
+    RUN_TEST(test_state_round_trip);
+    RUN_TEST(test_state_of_another_budget_is_rejected);
+    RUN_TEST(test_damaged_state_is_rejected_or_consistent);
+    return UNITY_END();
+}
@@ -0,0 +1,758 @@
+/**
+ * Micro-benchmarks of the simulation and rendering hot paths (native build only)
+ *
+ * Times the force kernels at N = 10 to 10000 (the pairwise kernel once per
+ * instruction set the CPU supports, and the pairwise and Barnes-Hut kernels
+ * again on thread pools of 2, 4, ... threads), a full engine step, the drawing
+ * passes, the pixel kernels next to the canvas calls they replace, and a
+ * complete frame rendered into the in-memory framebuffer. Every scenario uses
+ * fixed seeds. Reports ns/op, bodies/s and pixels/s as JSON on
+ * stdout (a readable table goes to stderr).
+ *
+ * Build and run from the project root:
+ *   g++ -std=gnu++17 -O2 -DGRAVSIM_SCALAR_FLOAT -Iinclude tools/Benchmark.cpp \
+ *       $(find src -name '*.cpp' ! -name main.cpp) -pthread -o benchmark
+ *   ./benchmark > baseline.json
+ *   ./benchmark --compare baseline.json        # exit code 1 on regressions
+ * (or: pio run -e benchmark && .pio/build/benchmark/program)
+ * pio test -e benchmark runs the raster benchmarks with --check-ratios.
+ *
+ * Options:
+ *   --filter TEXT      Only run benchmarks whose name contains TEXT
+ *   --compare FILE     Compare against a stored result file
+ *   --threshold PCT    Slowdown that counts as a regression (default 10)
+ *   --check-ratios     Fail when a pixel kernel is not faster than the canvas call it
+ *                      replaces by its margin in RATIO_LIMITS (both are timed in the
+ *                      same run, so no stored baseline is needed)
+ *   --ratio-limit R    Check every kernel/canvas pair against R instead
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PhysicsEngine.h"
+#include "Renderer.h"
+#include "Sun.h"
+#include "Random.h"
+#include "SimdGravity.h"
+#include "ThreadPool.h"
+#include "PixelKernels.h"
+
+namespace {
+    constexpr uint32_t SEED = 12345;             // Seed of every scenario
+    constexpr double BATCH_SECONDS = 0.05;       // Target duration of one timed batch
+    constexpr int BATCHES = 5;                   // Timed batches per benchmark (median is reported)
+    constexpr double DEFAULT_THRESHOLD = 10.0;   // Regression threshold (percent)
+    constexpr double MIN_ORBIT = 30.0;           // Innermost orbit of generated planets (pixels)
+    constexpr double MAX_ORBIT = 190.0;          // Outermost orbit of generated planets (pixels)
+    constexpr int DISPLAY_WIDTH = 320;           // Off-screen display size (Core2)
+    constexpr int DISPLAY_HEIGHT = 240;
+    constexpr int TRAIL_FILL_STEPS = 200;        // Steps simulated before trails are drawn
+    constexpr unsigned MAX_THREADS = 16;         // Largest thread pool benchmarked
+    constexpr int RASTER_PRIMITIVES = 1024;      // Primitives drawn per raster benchmark operation
+    constexpr int RASTER_MARGIN = 8;             // Raster positions extend this far past the sprite edges
+
+    /**
+     * Largest kernel/canvas time ratio accepted by --check-ratios for a raster primitive
+     */
+    struct RatioLimit {
+        const char* prefix;   // Benchmark name without its "-kernel" or "-canvas" suffix
+        double limit;         // Largest kernel time over canvas time
+    };
+    // Single pixels are not listed: on the host the canvas call is about as cheap as the
+    // kernel (0.85 to 1.0), so losing the kernel would not show in the ratio
+    const RatioLimit RATIO_LIMITS[] = {
+        {"raster/disc", 0.85},   // 0.5 to 0.72 on the host; falling back to fillCircle gives 1.0
+    };
+
+    const char* scalarName() {
+#if defined(GRAVSIM_SCALAR_FIXED)
+        return "Q10.22";
+#elif defined(GRAVSIM_SCALAR_FLOAT)
+        return "float";
+#else
+        return "double";
+#endif
+    }
+
+    /**
+     * Result of one benchmark
+     */
+    struct Result {
+        std::string name;     // Benchmark name
+        int n;                // Problem size (planets or effects)
+        double nsPerOp;       // Median time per operation
+        double bodiesPerOp;   // Bodies processed per operation (0 if not applicable)
+        double pixelsPerOp;   // Pixels produced per operation (0 if not applicable)
+    };
+
+    /**
+     * Time a batch of an operation
+     * @param op Operation
+     * @param iterations Number of calls
+     * @return Nanoseconds per call
+     */
+    double timeBatch(const std::function<void()>& op, long iterations) {
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        for (long i = 0; i < iterations; i++) {
+            op();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+    }
+
+    /**
+     * Find the number of calls of an operation that takes BATCH_SECONDS
+     * @param op Operation
+     * @return Iterations per batch
+     */
+    long calibrate(const std::function<void()>& op) {
+        op();  // Warm up caches and lazily built structures
+        long iterations = 1;
+        while (true) {
+            double seconds = timeBatch(op, iterations) * iterations * 1e-9;
+            if (seconds >= BATCH_SECONDS || iterations >= (1L << 30)) {
+                return iterations;
+            }
+            iterations = seconds > 0.0 ? std::max(iterations * 2, static_cast<long>(iterations * BATCH_SECONDS / seconds))
+                                       : iterations * 16;
+        }
+    }
+
+    /**
+     * Time operations with their batches interleaved, so that they see the same machine load
+     * (for operations whose times are compared with each other)
+     * @param ops Operations
+     * @return Median nanoseconds per operation of each
+     */
+    std::vector<double> timeInterleaved(const std::vector<std::function<void()>>& ops) {
+        std::vector<long> iterations;
+        for (const std::function<void()>& op : ops) {
+            iterations.push_back(calibrate(op));
+        }
+        std::vector<std::vector<double>> samples(ops.size());
+        for (int batch = 0; batch < BATCHES; batch++) {
+            for (size_t i = 0; i < ops.size(); i++) {
+                samples[i].push_back(timeBatch(ops[i], iterations[i]));
+            }
+        }
+        std::vector<double> medians;
+        for (std::vector<double>& opSamples : samples) {
+            std::sort(opSamples.begin(), opSamples.end());
+            medians.push_back(opSamples[BATCHES / 2]);
+        }
+        return medians;
+    }
+
+    /**
+     * Time an operation: calibrate a batch to BATCH_SECONDS, then take the median of BATCHES batches
+     * @param op Operation
+     * @return Nanoseconds per operation
+     */
+    double timeOperation(const std::function<void()>& op) {
+        return timeInterleaved({op})[0];
+    }
+
+    /**
+     * Count pixels that are not black
+     * @param canvas Canvas
+     * @return Pixel count
+     */
+    double countLitPixels(hal::Canvas& canvas) {
+        const uint16_t* pixels = static_cast<const uint16_t*>(canvas.getBuffer());
+        size_t count = static_cast<size_t>(canvas.width()) * canvas.height();
+        return static_cast<double>(count - std::count(pixels, pixels + count, TFT_BLACK));
+    }
+
+    /**
+     * Random planet on a circular orbit (uniform over the annulus)
+     */
+    void randomOrbit(std::mt19937& generator, double& x, double& y, double& vx, double& vy) {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        double radius = std::sqrt(MIN_ORBIT * MIN_ORBIT + unit(generator) * (MAX_ORBIT * MAX_ORBIT - MIN_ORBIT * MIN_ORBIT));
+        double angle = unit(generator) * 2.0 * M_PI;
+        double speed = std::sqrt(StepUnits::SUN_GM / radius) / StepUnits::VELOCITY;
+        x = radius * std::cos(angle);
+        y = radius * std::sin(angle);
+        vx = -speed * std::sin(angle);
+        vy = speed * std::cos(angle);
+    }
+
+    /**
+     * Fill an engine through its public interface (respects the solver's planet limit)
+     */
+    void addOrbits(PhysicsEngine& engine, int count) {
+        std::mt19937 generator(SEED);
+        Random colors(SEED);
+        for (int i = 0; i < count; i++) {
+            double x, y, vx, vy;
+            randomOrbit(generator, x, y, vx, vy);
+            engine.addPlanet(x, y, vx, vy, Planet::randomPastelColor(colors));
+        }
+    }
+
+    /**
+     * Engine whose planets are set up directly, for kernel sizes beyond the solver limits
+     */
+    PhysicsEngine* makeKernelEngine(int count);
+}
+
+/**
+ * Access to private hot paths (declared a friend by PhysicsEngine and Renderer)
+ */
+struct BenchmarkAccess {
+    static void fillBodies(PhysicsEngine& engine, int count) {
+        std::mt19937 generator(SEED);
+        engine.bodies.reserve(count);
+        for (int i = 0; i < count; i++) {
+            double x, y, vx, vy;
+            randomOrbit(generator, x, y, vx, vy);
+            engine.bodies.add(Real(x), Real(y), Real(vx * StepUnits::VELOCITY), Real(vy * StepUnits::VELOCITY),
+                              Real(StepUnits::PLANET_GM), PlanetConstants::RADIUS, TFT_WHITE);
+        }
+        engine.accelerationX.assign(count, Real(0));
+        engine.accelerationY.assign(count, Real(0));
+        engine.planetsReordered = true;
+    }
+
+    static void sunGravity(PhysicsEngine& engine) {
+        for (size_t i = 0; i < engine.bodies.size(); i++) {
+            engine.calculateSunGravity(i, engine.accelerationX, engine.accelerationY);
+        }
+    }
+
+    static void planetGravity(PhysicsEngine& engine, ForceSolver solver) {
+        std::fill(engine.accelerationX.begin(), engine.accelerationX.end(), Real(0));
+        std::fill(engine.accelerationY.begin(), engine.accelerationY.end(), Real(0));
+        engine.calculatePlanetGravity(solver, engine.accelerationX, engine.accelerationY);
+    }
+
+    static hal::Canvas& canvas(Renderer& renderer) { return *renderer.canvas; }
+    static void drawParticles(Renderer& renderer) { renderer.drawParticles(); }
+    static void drawRipples(Renderer& renderer) { renderer.drawRipples(); }
+    static void updateRipples(Renderer& renderer) { renderer.updateRipples(); }
+};
+
+namespace {
+    PhysicsEngine* makeKernelEngine(int count) {
+        PhysicsEngine* engine = new PhysicsEngine();
+        BenchmarkAccess::fillBodies(*engine, count);
+        return engine;
+    }
+
+    /**
+     * Benchmarks of the force kernels
+     */
+    void benchmarkGravity(std::vector<Result>& results, const std::string& filter) {
+        const int sizes[] = {10, 100, 1000, 10000};
+        const struct {
+            const char* name;
+            ForceSolver solver;
+        } solvers[] = {
+            {"gravity/pairwise", ForceSolver::PAIRWISE},
+            {"gravity/barnes-hut", ForceSolver::BARNES_HUT},
+            {"gravity/cell-list", ForceSolver::CELL_LIST},
+        };
+
+        for (int n : sizes) {
+            if (std::string("gravity/sun").find(filter) != std::string::npos) {
+                PhysicsEngine* engine = makeKernelEngine(n);
+                double ns = timeOperation([engine]() { BenchmarkAccess::sunGravity(*engine); });
+                results.push_back({"gravity/sun", n, ns, static_cast<double>(n), 0.0});
+                delete engine;
+            }
+            for (const auto& solver : solvers) {
+                if (std::string(solver.name).find(filter) == std::string::npos) {
+                    continue;
+                }
+                PhysicsEngine* engine = makeKernelEngine(n);
+                ForceSolver kind = solver.solver;
+                double ns = timeOperation([engine, kind]() { BenchmarkAccess::planetGravity(*engine, kind); });
+                results.push_back({solver.name, n, ns, static_cast<double>(n), 0.0});
+                delete engine;
+            }
+
+            // The pairwise kernel on every instruction set this CPU has (the default above uses the widest)
+            SimdGravity::InstructionSet widest = SimdGravity::detectInstructionSet();
+            for (int set = 0; set <= static_cast<int>(widest); set++) {
+                SimdGravity::InstructionSet instructionSet = static_cast<SimdGravity::InstructionSet>(set);
+                std::string name = std::string("gravity/pairwise-") + SimdGravity::getName(instructionSet);
+                if (name.find(filter) == std::string::npos) {
+                    continue;
+                }
+                SimdGravity::setInstructionSet(instructionSet);
+                PhysicsEngine* engine = makeKernelEngine(n);
+                double ns = timeOperation([engine]() { BenchmarkAccess::planetGravity(*engine, ForceSolver::PAIRWISE); });
+                results.push_back({name, n, ns, static_cast<double>(n), 0.0});
+                delete engine;
+            }
+            SimdGravity::setInstructionSet(widest);
+
+            // Row-parallel pairwise and Barnes-Hut passes on 2, 4, ... threads (at least 2, even on one core)
+            unsigned hardwareThreads = std::max(2u, std::thread::hardware_concurrency());
+            for (unsigned threads = 2; threads <= hardwareThreads && threads <= MAX_THREADS; threads *= 2) {
+                ThreadPool pool(threads);
+                const struct {
+                    const char* name;
+                    ForceSolver solver;
+                } parallelSolvers[] = {
+                    {"gravity/pairwise-t", ForceSolver::PAIRWISE},
+                    {"gravity/barnes-hut-t", ForceSolver::BARNES_HUT},
+                };
+                for (const auto& solver : parallelSolvers) {
+                    std::string name = solver.name + std::to_string(threads);
+                    if (name.find(filter) == std::string::npos) {
+                        continue;
+                    }
+                    PhysicsEngine* engine = makeKernelEngine(n);
+                    engine->setThreadPool(&pool);
+                    ForceSolver kind = solver.solver;
+                    double ns = timeOperation([engine, kind]() { BenchmarkAccess::planetGravity(*engine, kind); });
+                    results.push_back({name, n, ns, static_cast<double>(n), 0.0});
+                    delete engine;
+                }
+            }
+        }
+    }
+
+    /**
+     * Benchmark of a full engine step (integrator, forces and trail recording)
+     */
+    void benchmarkStep(std::vector<Result>& results, const std::string& filter) {
+        if (std::string("engine/step").find(filter) == std::string::npos) {
+            return;
+        }
+        const int sizes[] = {10, 100, 1000};
+        for (int n : sizes) {
+            PhysicsEngine engine;
+            engine.setForceSolver(n <= PlanetConstants::MAX_COUNT ? ForceSolver::PAIRWISE : ForceSolver::BARNES_HUT);
+            addOrbits(engine, n);
+            double ns = timeOperation([&engine]() { engine.update(); });
+            results.push_back({"engine/step", n, ns, static_cast<double>(n), 0.0});
+        }
+    }
+
+    /**
+     * Benchmarks of the drawing passes into an off-screen canvas
+     */
+    void benchmarkDrawing(std::vector<Result>& results, const std::string& filter) {
+        FrameBufferDisplay display(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        const int centerX = DISPLAY_WIDTH / 2;
+        const int centerY = DISPLAY_HEIGHT / 2;
+
+        // Trails of planets that have moved long enough to fill them
+        if (std::string("draw/trail").find(filter) != std::string::npos) {
+            const int sizes[] = {10, 100};
+            for (int n : sizes) {
+                hal::randomSeed(SEED);
+                PhysicsEngine engine;
+                engine.setForceSolver(n <= PlanetConstants::MAX_COUNT ? ForceSolver::PAIRWISE : ForceSolver::BARNES_HUT);
+                addOrbits(engine, n);
+                for (int step = 0; step < TRAIL_FILL_STEPS; step++) {
+                    engine.update();
+                }
+                hal::Canvas canvas(&display);
+                canvas.createSprite(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+                auto op = [&]() {
+                    for (size_t i = 0; i < engine.getPlanetCount(); i++) {
+                        engine.getPlanet(i).drawTrail(canvas, centerX, centerY);
+                    }
+                };
+                op();
+                double pixels = countLitPixels(canvas);
+                double ns = timeOperation(op);
+                results.push_back({"draw/trail", n, ns, static_cast<double>(engine.getPlanetCount()), pixels});
+            }
+        }
+
+        // The sun (body and rays), from the pre-rendered frames and rasterized every time
+        for (const char* name : {"draw/sun", "draw/sun-raster"}) {
+            if (std::string(name).find(filter) == std::string::npos) {
+                continue;
+            }
+            hal::randomSeed(SEED);
+            Sun sun;
+            if (std::string(name) == "draw/sun") {
+                sun.prerender(display);
+            }
+            hal::Canvas canvas(&display);
+            canvas.createSprite(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+            sun.draw(canvas, centerX, centerY);
+            double pixels = countLitPixels(canvas);
+            double ns = timeOperation([&]() { sun.draw(canvas, centerX, centerY); });
+            results.push_back({name, 1, ns, 0.0, pixels});
+        }
+
+        // Firework particles: bursts drawn and advanced over their whole lifetime
+        // (1000 bursts overflow the pool, so the oldest particles are recycled)
+        if (std::string("draw/particles").find(filter) != std::string::npos) {
+            const int bursts[] = {5, 100, 1000};
+            for (int n : bursts) {
+                hal::randomSeed(SEED);
+                Renderer renderer(display);
+                renderer.init();
+                Random colors(SEED);
+                hal::Canvas& canvas = BenchmarkAccess::canvas(renderer);
+                auto op = [&]() {
+                    for (int i = 0; i < n; i++) {
+                        renderer.createFirework(-120.0 + 240.0 * (i % 16) / 15, -80.0 + 160.0 * (i / 16 % 8) / 7,
+                                                Planet::randomPastelColor(colors));
+                    }
+                    for (int frame = 0; frame < FireworkConstants::PARTICLE_LIFETIME; frame++) {
+                        BenchmarkAccess::drawParticles(renderer);
+                    }
+                };
+                canvas.fillScreen(TFT_BLACK);
+                op();
+                double pixels = countLitPixels(canvas);
+                double ns = timeOperation(op);
+                double particles = static_cast<double>(std::min(n * FireworkConstants::PARTICLE_COUNT,
+                                                                FireworkConstants::MAX_PARTICLES));
+                results.push_back({"draw/particles", n, ns, particles * FireworkConstants::PARTICLE_LIFETIME, pixels});
+            }
+        }
+
+        // Ripples (every slot in use, at different radii)
+        if (std::string("draw/ripples").find(filter) != std::string::npos) {
+            hal::randomSeed(SEED);
+            Renderer renderer(display);
+            renderer.init();
+            Random colors(SEED);
+            for (int i = 0; i < RippleConstants::MAX_RIPPLES; i++) {
+                renderer.createRipple(-90.0 + 20.0 * i, 10.0 * (i % 4) - 15.0, Planet::randomPastelColor(colors));
+                BenchmarkAccess::updateRipples(renderer);
+            }
+            hal::Canvas& canvas = BenchmarkAccess::canvas(renderer);
+            canvas.fillScreen(TFT_BLACK);
+            BenchmarkAccess::drawRipples(renderer);
+            double pixels = countLitPixels(canvas);
+            double ns = timeOperation([&]() { BenchmarkAccess::drawRipples(renderer); });
+            results.push_back({"draw/ripples", RippleConstants::MAX_RIPPLES, ns, 0.0, pixels});
+        }
+
+        // Complete frames (clear, trails, planets, sun, HUD, dirty-rectangle push)
+        if (std::string("render/frame").find(filter) != std::string::npos) {
+            const int sizes[] = {10, 100};
+            for (int n : sizes) {
+                hal::randomSeed(SEED);
+                PhysicsEngine engine;
+                engine.setForceSolver(n <= PlanetConstants::MAX_COUNT ? ForceSolver::PAIRWISE : ForceSolver::BARNES_HUT);
+                addOrbits(engine, n);
+                for (int step = 0; step < TRAIL_FILL_STEPS; step++) {
+                    engine.update();
+                }
+                SimulationSnapshot snapshot;
+                snapshot.bodies = engine.getBodies();
+                snapshot.trails = engine.getTrails();
+                snapshot.step = engine.getStepCount();
+                snapshot.publishMicros = hal::micros();
+                snapshot.accumulatorMicros = 0;
+                snapshot.stepMicros = ClockConstants::STEP_MICROS;
+
+                FrameBufferDisplay frameDisplay(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+                Renderer renderer(frameDisplay);
+                renderer.init();
+                auto op = [&]() {
+                    renderer.render(snapshot, false, 0, 0, 0, 0);
+                };
+                op();  // First frame pushes the whole screen
+                uint64_t pushedBefore = frameDisplay.getPushedPixels();
+                long frames = 0;
+                double ns = timeOperation([&]() { op(); frames++; });
+                double pixels = frames > 0 ? static_cast<double>(frameDisplay.getPushedPixels() - pushedBefore) / frames : 0.0;
+                results.push_back({"render/frame", n, ns, static_cast<double>(engine.getPlanetCount()), pixels});
+            }
+        }
+    }
+
+    /**
+     * Benchmarks of the pixel kernels against the canvas primitives they replace
+     * (random positions, some crossing the sprite edges)
+     */
+    void benchmarkRaster(std::vector<Result>& results, const std::string& filter) {
+        FrameBufferDisplay display(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        hal::Canvas canvas(&display);
+        canvas.createSprite(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        pixel::Target target(canvas);
+        std::mt19937 generator(SEED);
+        std::uniform_int_distribution<int> xs(-RASTER_MARGIN, DISPLAY_WIDTH + RASTER_MARGIN);
+        std::uniform_int_distribution<int> ys(-RASTER_MARGIN, DISPLAY_HEIGHT + RASTER_MARGIN);
+        std::vector<int> px(RASTER_PRIMITIVES), py(RASTER_PRIMITIVES);
+        for (int i = 0; i < RASTER_PRIMITIVES; i++) {
+            px[i] = xs(generator);
+            py[i] = ys(generator);
+        }
+
+        typedef std::function<void(int, int)> Draw;
+        // The variants of a primitive are timed interleaved, since --check-ratios compares them
+        auto run = [&](const std::string& primitive, int n, const Draw& drawCanvas, const Draw& drawKernel, const Draw& drawAdd) {
+            const std::pair<const char*, const Draw*> variants[] = {{"-canvas", &drawCanvas}, {"-kernel", &drawKernel}, {"-add", &drawAdd}};
+            std::vector<std::string> names;
+            std::vector<double> pixels;
+            std::vector<std::function<void()>> ops;
+            for (const auto& variant : variants) {
+                std::string name = primitive + variant.first;
+                if (name.find(filter) == std::string::npos) {
+                    continue;
+                }
+                const Draw& draw = *variant.second;
+                auto op = [&px, &py, &draw]() {
+                    for (int i = 0; i < RASTER_PRIMITIVES; i++) {
+                        draw(px[i], py[i]);
+                    }
+                };
+                canvas.fillScreen(TFT_BLACK);
+                op();
+                names.push_back(name);
+                pixels.push_back(countLitPixels(canvas));
+                ops.push_back(op);
+            }
+            std::vector<double> ns = timeInterleaved(ops);
+            for (size_t i = 0; i < ops.size(); i++) {
+                results.push_back({names[i], n, ns[i], static_cast<double>(RASTER_PRIMITIVES), pixels[i]});
+            }
+        };
+
+        const uint16_t color = 0x7BEF;
+        run("raster/pixel", 0,
+            [&](int x, int y) { canvas.drawPixel(x, y, color); },
+            [&](int x, int y) { pixel::drawPixel(target, x, y, color); },
+            [&](int x, int y) { pixel::addPixel(target, x, y, color); });
+        const int radii[] = {1, 2, 6};
+        for (int r : radii) {
+            run("raster/disc", r,
+                [&](int x, int y) { canvas.fillCircle(x, y, r, color); },
+                [&](int x, int y) { pixel::fillDisc(target, x, y, r, color); },
+                [&](int x, int y) { pixel::addDisc(target, x, y, r, color); });
+        }
+    }
+
+    /**
+     * Read results written by printJson (one benchmark per line)
+     * @param path File path
+     * @param baseline Nanoseconds per operation keyed by "name/n" (output)
+     * @return false if the file could not be read
+     */
+    bool readBaseline(const char* path, std::map<std::string, double>& baseline) {
+        FILE* file = std::fopen(path, "r");
+        if (file == nullptr) {
+            return false;
+        }
+        char line[512];
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            char name[128];
+            int n;
+            double ns;
+            const char* entry = std::strstr(line, "{\"name\"");
+            if (entry != nullptr &&
+                std::sscanf(entry, "{\"name\": \"%127[^\"]\", \"n\": %d, \"ns_per_op\": %lf", name, &n, &ns) == 3) {
+                baseline[std::string(name) + "/" + std::to_string(n)] = ns;
+            }
+        }
+        std::fclose(file);
+        return true;
+    }
+
+    void printJson(const std::vector<Result>& results) {
+        std::printf("{\n  \"scalar\": \"%s\",\n  \"benchmarks\": [\n", scalarName());
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            std::printf("    {\"name\": \"%s\", \"n\": %d, \"ns_per_op\": %.1f, \"bodies_per_s\": %.4g, \"pixels_per_s\": %.4g}%s\n",
+                        r.name.c_str(), r.n, r.nsPerOp,
+                        r.bodiesPerOp * 1e9 / r.nsPerOp, r.pixelsPerOp * 1e9 / r.nsPerOp,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+    void printTable(const std::vector<Result>& results) {
+        std::fprintf(stderr, "%-24s %6s %14s %12s %12s\n", "benchmark", "n", "ns/op", "bodies/s", "pixels/s");
+        for (const Result& r : results) {
+            std::fprintf(stderr, "%-24s %6d %14.1f %12.4g %12.4g\n", r.name.c_str(), r.n, r.nsPerOp,
+                         r.bodiesPerOp * 1e9 / r.nsPerOp, r.pixelsPerOp * 1e9 / r.nsPerOp);
+        }
+    }
+
+    /**
+     * Print the speedup of the threaded force passes over the single-threaded ones
+     * (same kernel; near-linear up to the number of cores is the target)
+     * @param results Results of one run
+     */
+    void printScaling(const std::vector<Result>& results) {
+        const struct {
+            const char* single;    // Single-threaded benchmark
+            const char* threaded;  // Threaded benchmark (followed by the thread count)
+        } groups[] = {
+            {"gravity/pairwise", "gravity/pairwise-t"},
+            {"gravity/barnes-hut", "gravity/barnes-hut-t"},
+        };
+        bool header = false;
+        for (const auto& group : groups) {
+            const std::string prefix = group.threaded;
+            for (const Result& single : results) {
+                if (single.name != group.single) {
+                    continue;
+                }
+                for (const Result& r : results) {
+                    if (r.n != single.n || r.name.compare(0, prefix.size(), prefix) != 0) {
+                        continue;
+                    }
+                    if (!header) {
+                        std::fprintf(stderr, "\n%-24s %6s %8s %14s %9s %11s   (%u hardware threads)\n", "scaling", "n",
+                                     "threads", "ns/op", "speedup", "efficiency", std::thread::hardware_concurrency());
+                        header = true;
+                    }
+                    int threads = std::atoi(r.name.c_str() + prefix.size());
+                    double speedup = single.nsPerOp / r.nsPerOp;
+                    std::fprintf(stderr, "%-24s %6d %8d %14.1f %8.2fx %10.0f%%\n", group.single, r.n, threads, r.nsPerOp,
+                                 speedup, speedup / threads * 100.0);
+                }
+            }
+        }
+    }
+
+    /**
+     * Compare results against a baseline and print the changes
+     * @return Number of regressions
+     */
+    int compare(const std::vector<Result>& results, const std::map<std::string, double>& baseline, double threshold) {
+        int regressions = 0;
+        std::fprintf(stderr, "\n%-24s %6s %14s %14s %9s\n", "benchmark", "n", "baseline", "current", "change");
+        for (const Result& r : results) {
+            auto found = baseline.find(r.name + "/" + std::to_string(r.n));
+            if (found == baseline.end()) {
+                std::fprintf(stderr, "%-24s %6d %14s %14.1f %9s\n", r.name.c_str(), r.n, "-", r.nsPerOp, "new");
+                continue;
+            }
+            double change = (r.nsPerOp / found->second - 1.0) * 100.0;
+            bool regressed = change > threshold;
+            regressions += regressed ? 1 : 0;
+            std::fprintf(stderr, "%-24s %6d %14.1f %14.1f %+8.1f%%%s\n", r.name.c_str(), r.n, found->second, r.nsPerOp,
+                         change, regressed ? "  REGRESSION" : "");
+        }
+        return regressions;
+    }
+
+    /**
+     * Compare each pixel kernel with the canvas call it replaces and print the ratios
+     * @param results Results of one run
+     * @param override Limit for every pair instead of RATIO_LIMITS (0 to use the table)
+     * @return Number of pairs over their limit
+     */
+    int checkRatios(const std::vector<Result>& results, double override) {
+        const std::string kernelSuffix = "-kernel";
+        const std::string canvasSuffix = "-canvas";
+        auto prefixOf = [](const std::string& name, const std::string& suffix) {
+            bool matches = name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+            return matches ? name.substr(0, name.size() - suffix.size()) : std::string();
+        };
+        std::map<std::string, double> canvas;
+        for (const Result& r : results) {
+            std::string prefix = prefixOf(r.name, canvasSuffix);
+            if (!prefix.empty()) {
+                canvas[prefix + "/" + std::to_string(r.n)] = r.nsPerOp;
+            }
+        }
+
+        int failures = 0;
+        std::fprintf(stderr, "\n%-24s %6s %14s %14s %9s\n", "kernel/canvas", "n", "canvas", "kernel", "ratio");
+        for (const Result& r : results) {
+            std::string prefix = prefixOf(r.name, kernelSuffix);
+            auto found = canvas.find(prefix + "/" + std::to_string(r.n));
+            if (prefix.empty() || found == canvas.end()) {
+                continue;
+            }
+            double limit = override;
+            for (const RatioLimit& entry : RATIO_LIMITS) {
+                if (limit <= 0.0 && prefix == entry.prefix) {
+                    limit = entry.limit;
+                }
+            }
+            if (limit <= 0.0) {
+                continue;
+            }
+            double ratio = r.nsPerOp / found->second;
+            bool failed = ratio > limit;
+            failures += failed ? 1 : 0;
+            std::fprintf(stderr, "%-24s %6d %14.1f %14.1f %9.2f%s\n", prefix.c_str(), r.n, found->second, r.nsPerOp,
+                         ratio, failed ? "  OVER LIMIT" : "");
+        }
+        return failures;
+    }
+}
+
+/**
+ * Run the benchmarks selected by the command line (the program's main, also called by
+ * test/test_benchmark_compare)
+ * @param argc Number of arguments
+ * @param argv Arguments (argv[0] is the program name)
+ * @return 0 on success, 1 on regressions or kernel/canvas ratios over their limit,
+ *         2 on bad arguments or an unreadable baseline
+ */
+int runBenchmark(int argc, char** argv) {
+    std::string filter;
+    const char* baselinePath = nullptr;
+    double threshold = DEFAULT_THRESHOLD;
+    bool checkingRatios = false;
+    double ratioLimit = 0.0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--check-ratios") == 0) {
+            checkingRatios = true;
+        } else if (std::strcmp(argv[i], "--ratio-limit") == 0 && i + 1 < argc) {
+            checkingRatios = true;
+            ratioLimit = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter TEXT] [--compare FILE] [--threshold PCT] [--check-ratios] [--ratio-limit R]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath != nullptr && !readBaseline(baselinePath, baseline)) {
+        std::fprintf(stderr, "cannot read %s\n", baselinePath);
+        return 2;
+    }
+
+    std::vector<Result> results;
+    benchmarkGravity(results, filter);
+    benchmarkStep(results, filter);
+    benchmarkDrawing(results, filter);
+    benchmarkRaster(results, filter);
+
+    printTable(results);
+    printScaling(results);
+    printJson(results);
+    int failures = 0;
+    if (baselinePath != nullptr) {
+        int regressions = compare(results, baseline, threshold);
+        std::fprintf(stderr, "%d regression(s) over %.0f%%\n", regressions, threshold);
+        failures += regressions;
+    }
+    if (checkingRatios) {
+        int overLimit = checkRatios(results, ratioLimit);
+        std::fprintf(stderr, "%d kernel(s) over their ratio limit\n", overLimit);
+        failures += overLimit;
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+#if !defined(PIO_UNIT_TESTING)
+int main(int argc, char** argv) {
+    return runBenchmark(argc, argv);
+}
+#endif
@@ -0,0 +1,185 @@
+/**
+ * Host-side accuracy comparison of the engine's scalar types
+ *
+ * Runs the engine's gravity kernels and integration step in float, Q10.22 and
+ * Q16.16 fixed point next to a double reference and prints the errors.
+ *
+ * Build and run from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/ScalarAccuracy.cpp -o scalar_accuracy
+ *   ./scalar_accuracy
+ */
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include "GravityKernel.h"
+
+namespace {
+    // Interacting scenario: planets on circular orbits around the sun, close enough to interact
+    // (the system is chaotic, so trajectories are only compared over a short horizon)
+    constexpr int PLANET_COUNT = 10;
+    constexpr double INNER_RADIUS = 25.0;
+    constexpr double RADIUS_SPACING = 15.0;
+    constexpr int STEPS = 8000;
+    constexpr int REPORT_INTERVAL = 2000;
+
+    // Orbit scenario: a single planet around the sun (no chaos, long horizon)
+    constexpr int ORBIT_STEPS = 100000;
+
+    /**
+     * Bodies integrated with one scalar type
+     */
+    template <typename T>
+    struct System {
+        std::vector<T> x, y, vx, vy;
+
+        /**
+         * Constructor
+         * @param count Number of planets
+         * @param innerRadius Orbit radius of the first planet (pixels)
+         */
+        System(int count, double innerRadius) {
+            // Same initial state for every type (converted from double)
+            for (int i = 0; i < count; i++) {
+                double radius = innerRadius + RADIUS_SPACING * i;
+                double angle = 2.399963 * i;  // Golden angle spreads the planets out
+                double speed = std::sqrt(StepUnits::SUN_GM / radius);
+                x.push_back(T(radius * std::cos(angle)));
+                y.push_back(T(radius * std::sin(angle)));
+                vx.push_back(T(-speed * std::sin(angle)));
+                vy.push_back(T(speed * std::cos(angle)));
+            }
+        }
+
+        /**
+         * Advance one step exactly like PhysicsEngine::update and Planet::update
+         */
+        void step() {
+            const T sunGM(StepUnits::SUN_GM);
+            const T planetGM(StepUnits::PLANET_GM);
+            const int count = static_cast<int>(x.size());
+            std::vector<T> ax(count, T(0));
+            std::vector<T> ay(count, T(0));
+
+            for (int i = 0; i < count; i++) {
+                GravityKernel<T>::attract(-x[i], -y[i], sunGM, ax[i], ay[i]);
+            }
+            for (int i = 0; i < count; i++) {
+                for (int j = i + 1; j < count; j++) {
+                    T accelX, accelY;
+                    if (GravityKernel<T>::pair(x[j] - x[i], y[j] - y[i], planetGM, accelX, accelY)) {
+                        ax[i] += accelX;
+                        ay[i] += accelY;
+                        ax[j] -= accelX;
+                        ay[j] -= accelY;
+                    }
+                }
+            }
+            for (int i = 0; i < count; i++) {
+                vx[i] += ax[i];
+                vy[i] += ay[i];
+                x[i] += vx[i];
+                y[i] += vy[i];
+            }
+        }
+    };
+
+    /**
+     * Print the relative error of a single sun acceleration at several distances
+     */
+    template <typename T>
+    void printKernelError(const char* name) {
+        std::printf("%-8s", name);
+        for (double r = 5.0; r <= 160.0; r *= 2.0) {
+            double exactX = 0.0;
+            double exactY = 0.0;
+            GravityKernel<double>::attract(r * 0.6, r * 0.8, StepUnits::SUN_GM, exactX, exactY);
+            T ax(0);
+            T ay(0);
+            GravityKernel<T>::attract(T(r * 0.6), T(r * 0.8), T(StepUnits::SUN_GM), ax, ay);
+            double error = std::hypot(toDouble(ax) - exactX, toDouble(ay) - exactY) / std::hypot(exactX, exactY);
+            std::printf("  %9.2e", error);
+        }
+        std::printf("\n");
+    }
+
+    /**
+     * Position error against the reference (max and RMS over planets, pixels)
+     */
+    template <typename T>
+    void positionError(const System<double>& reference, const System<T>& system, double& maxError, double& rmsError) {
+        const int count = static_cast<int>(reference.x.size());
+        double sum = 0.0;
+        maxError = 0.0;
+        for (int i = 0; i < count; i++) {
+            double error = std::hypot(toDouble(system.x[i]) - reference.x[i], toDouble(system.y[i]) - reference.y[i]);
+            sum += error * error;
+            if (error > maxError) {
+                maxError = error;
+            }
+        }
+        rmsError = std::sqrt(sum / count);
+    }
+
+    /**
+     * Print orbit radius drift and position error of a single planet
+     */
+    template <typename T>
+    void printOrbitError(const char* name, double radius) {
+        System<double> reference(1, radius);
+        System<T> system(1, radius);
+        for (int step = 0; step < ORBIT_STEPS; step++) {
+            reference.step();
+            system.step();
+        }
+        double drift = std::hypot(toDouble(system.x[0]), toDouble(system.y[0])) -
+                       std::hypot(reference.x[0], reference.y[0]);
+        double maxError, rmsError;
+        positionError(reference, system, maxError, rmsError);
+        std::printf("  %-8s radius drift %+9.4f px, position error %9.4f px\n", name, drift, maxError);
+    }
+}
+
+int main() {
+    std::printf("Relative error of one sun acceleration (distance in pixels)\n");
+    std::printf("%-8s", "type");
+    for (double r = 5.0; r <= 160.0; r *= 2.0) {
+        std::printf("  %9.0f", r);
+    }
+    std::printf("\n");
+    printKernelError<float>("float");
+    printKernelError<Q10_22>("Q10.22");
+    printKernelError<Q16_16>("Q16.16");
+
+    std::printf("\nSingle planet after %d steps, against double\n", ORBIT_STEPS);
+    for (double radius = 20.0; radius <= 140.0; radius *= 2.0) {
+        std::printf("r = %.0f px\n", radius);
+        printOrbitError<float>("float", radius);
+        printOrbitError<Q10_22>("Q10.22", radius);
+        printOrbitError<Q16_16>("Q16.16", radius);
+    }
+
+    std::printf("\nPosition error against double after N steps (%d interacting planets, max / RMS pixels)\n", PLANET_COUNT);
+    std::printf("%8s  %21s  %21s  %21s\n", "steps", "float", "Q10.22", "Q16.16");
+
+    System<double> reference(PLANET_COUNT, INNER_RADIUS);
+    System<float> single(PLANET_COUNT, INNER_RADIUS);
+    System<Q10_22> fixed22(PLANET_COUNT, INNER_RADIUS);
+    System<Q16_16> fixed16(PLANET_COUNT, INNER_RADIUS);
+
+    for (int step = 1; step <= STEPS; step++) {
+        reference.step();
+        single.step();
+        fixed22.step();
+        fixed16.step();
+
+        if (step % REPORT_INTERVAL == 0) {
+            double maxFloat, rmsFloat, max22, rms22, max16, rms16;
+            positionError(reference, single, maxFloat, rmsFloat);
+            positionError(reference, fixed22, max22, rms22);
+            positionError(reference, fixed16, max16, rms16);
+            std::printf("%8d  %10.3f / %8.3f  %10.3f / %8.3f  %10.3f / %8.3f\n",
+                        step, maxFloat, rmsFloat, max22, rms22, max16, rms16);
+        }
+    }
+    return 0;
+}
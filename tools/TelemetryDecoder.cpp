@@ -0,0 +1,122 @@
+/**
+ * Host-side decoder of the serial telemetry stream (see include/TelemetryFormat.h)
+ *
+ * Reads the device's serial output from a serial port, a file or stdin, prints
+ * one JSON object per decoded frame on stdout and passes the ordinary serial
+ * text through to stderr. Frames with a bad checksum are skipped; after a gap
+ * in the sequence numbers, deltas are ignored until the next keyframe.
+ *
+ * Build and run from the project root:
+ *   g++ -std=c++17 -O2 -Iinclude tools/TelemetryDecoder.cpp src/TelemetryDecoder.cpp -o telemetry_decoder
+ *   ./telemetry_decoder /dev/ttyUSB0           (send 't' to the device to start the stream)
+ *   .pio/build/native/program 10000 --telemetry | ./telemetry_decoder
+ */
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "TelemetryFormat.h"
+#include "TelemetryDecoder.h"
+
+using namespace TelemetryFormat;
+
+namespace {
+    // Decoder whose frames are printed
+    const TelemetryDecoder* decoder = nullptr;
+
+    // Serial text of the current line
+    std::string text;
+
+    void printIds(const char* name, const std::vector<uint32_t>& ids) {
+        printf(",\"%s\":[", name);
+        for (size_t i = 0; i < ids.size(); i++) {
+            printf("%s%u", i > 0 ? "," : "", ids[i]);
+        }
+        printf("]");
+    }
+
+    /**
+     * Print a decoded frame as one JSON object
+     * @param frame Frame
+     */
+    void printFrame(const TelemetryDecoder::Frame& frame) {
+        printf("{\"seq\":%u,\"type\":\"%s\",\"step\":%u,\"dropped\":%u,\"physics_us\":%u,\"frame_us\":%u",
+               frame.sequence, frame.keyframe ? "key" : "delta", frame.step, frame.dropped,
+               frame.physicsMicros, frame.frameMicros);
+        printIds("spawned", frame.spawned);
+        printIds("removed", frame.removed);
+        printf(",\"bodies\":[");
+        const std::vector<TelemetryDecoder::Body>& bodies = decoder->getBodies();
+        for (size_t i = 0; i < bodies.size(); i++) {
+            const TelemetryDecoder::Body& body = bodies[i];
+            printf("%s[%u,%.4f,%.4f,%.6f,%.6f]", i > 0 ? "," : "", body.id,
+                   body.x / POSITION_SCALE, body.y / POSITION_SCALE,
+                   body.vx / VELOCITY_SCALE, body.vy / VELOCITY_SCALE);
+        }
+        printf("]}\n");
+        fflush(stdout);
+    }
+
+    /**
+     * Pass a byte of serial text through to stderr (a line at a time)
+     * @param byte Byte
+     */
+    void passText(uint8_t byte) {
+        if (byte == '\n') {
+            fprintf(stderr, "%s\n", text.c_str());
+            text.clear();
+        } else if (byte != '\r') {
+            text.push_back(static_cast<char>(byte));
+        }
+    }
+
+    /**
+     * Put a serial port into raw mode at the telemetry line rate
+     * @param fd Port
+     */
+    void configurePort(int fd) {
+        termios settings;
+        if (tcgetattr(fd, &settings) != 0) {
+            return;
+        }
+        cfmakeraw(&settings);
+        cfsetispeed(&settings, B115200);
+        cfsetospeed(&settings, B115200);
+        tcsetattr(fd, TCSANOW, &settings);
+    }
+}
+
+int main(int argc, char** argv) {
+    int fd = STDIN_FILENO;
+    if (argc > 1) {
+        fd = open(argv[1], O_RDWR | O_NOCTTY);
+        if (fd < 0) {
+            fprintf(stderr, "cannot open %s\n", argv[1]);
+            return 2;
+        }
+    }
+    if (isatty(fd)) {
+        configurePort(fd);
+    }
+
+    TelemetryDecoder telemetry(printFrame, passText);
+    decoder = &telemetry;
+    uint8_t chunk[4096];
+    ssize_t received;
+    while ((received = read(fd, chunk, sizeof(chunk))) > 0) {
+        telemetry.feed(chunk, received);
+    }
+    if (!text.empty()) {
+        fprintf(stderr, "%s\n", text.c_str());
+    }
+
+    const TelemetryDecoderStats& stats = telemetry.getStats();
+    fprintf(stderr, "telemetry: %u frames (%u keyframes), %u dropped by the device, "
+            "%u checksum errors, %u malformed, %u gaps, %u deltas skipped\n",
+            stats.frames, stats.keyframes, stats.dropped,
+            stats.crcErrors, stats.malformed, stats.gaps, stats.skipped);
+    return stats.crcErrors + stats.malformed + stats.gaps > 0 ? 1 : 0;
+}